@@ -39,6 +39,12 @@
 #include <QFile>
 #include <QDebug>
 #include <QBuffer>
+
+#ifdef Q_OS_UNIX
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 /*!
     \class QSsh::SftpChannel
 
@@ -68,6 +74,16 @@ namespace QSsh {
 namespace Internal {
 namespace {
     const quint32 ProtocolVersion = 3;
+    const qint64 DefaultHighWaterMark = 2 * 1024 * 1024;
+    const QByteArray LimitsExtension = "limits@openssh.com";
+
+    // Upper bound for what we accept from limits@openssh.com; OpenSSH offers 255 KB.
+    const quint32 MaxNegotiatedDataSize = 1024 * 1024;
+
+    quint32 negotiatedSize(quint64 limit, quint32 defaultSize)
+    {
+        return limit == 0 ? defaultSize : quint32(qBound<quint64>(1024, limit, MaxNegotiatedDataSize));
+    }
 
     QString errorMessage(const QString &serverMessage,
         const QString &alternativeMessage)
@@ -118,6 +134,8 @@ SftpChannel::SftpChannel(quint32 channelId,
     connect(d, SIGNAL(finished(QSsh::SftpJobId,QString)), this,
         SIGNAL(finished(QSsh::SftpJobId,QString)), Qt::QueuedConnection);
     connect(d, SIGNAL(closed()), this, SIGNAL(closed()), Qt::QueuedConnection);
+    connect(d, SIGNAL(bytesWritten(qint64)), this, SIGNAL(bytesWritten(qint64)),
+        Qt::QueuedConnection);
 
     connect(d, &Internal::SftpChannelPrivate::transferPrograss, this,
             [this](quint64 current, quint64 total){emit transferPrograss(current, total);}, Qt::QueuedConnection);
@@ -280,6 +298,53 @@ SftpJobId SftpChannel::downloadDir(const QString &remoteDirPath,
     return downloadDirOp->jobId;
 }
 
+qint64 SftpChannel::bytesToWrite() const
+{
+    return d->bytesToWrite();
+}
+
+void SftpChannel::setWriteBufferHighWaterMark(qint64 bytes)
+{
+    d->setWriteBufferHighWaterMark(bytes);
+}
+
+qint64 SftpChannel::writeBufferHighWaterMark() const
+{
+    return d->writeBufferHighWaterMark();
+}
+
+void SftpChannel::setPriority(int priority)
+{
+    d->setPriority(priority);
+}
+
+int SftpChannel::priority() const
+{
+    return d->priority();
+}
+
+void SftpChannel::setMinimumRequestsInFlight(int count)
+{
+    d->m_minRequestsInFlight = qMax(count, 1);
+    d->m_maxRequestsInFlight = qMax(d->m_maxRequestsInFlight, d->m_minRequestsInFlight);
+}
+
+int SftpChannel::minimumRequestsInFlight() const
+{
+    return d->m_minRequestsInFlight;
+}
+
+void SftpChannel::setMaximumRequestsInFlight(int count)
+{
+    d->m_maxRequestsInFlight = qMax(count, 1);
+    d->m_minRequestsInFlight = qMin(d->m_minRequestsInFlight, d->m_maxRequestsInFlight);
+}
+
+int SftpChannel::maximumRequestsInFlight() const
+{
+    return d->m_maxRequestsInFlight;
+}
+
 SftpChannel::~SftpChannel()
 {
     delete d;
@@ -294,8 +359,16 @@ namespace Internal {
 SftpChannelPrivate::SftpChannelPrivate(quint32 channelId,
     SshSendFacility &sendFacility, SftpChannel *sftp)
     : AbstractSshChannel(channelId, sendFacility),
-      m_nextJobId(0), m_sftpState(Inactive), m_sftp(sftp)
+      m_nextJobId(0), m_sftpState(Inactive), m_sftp(sftp),
+      m_minRequestsInFlight(SftpRequestPipeline::DefaultMinDepth),
+      m_maxRequestsInFlight(SftpRequestPipeline::DefaultMaxDepth),
+      m_limitsRequestId(SftpInvalidJob), m_maxReadSize(AbstractSftpPacket::MaxDataSize),
+      m_maxWriteSize(AbstractSftpPacket::MaxDataSize),
+      m_maxPacketSize(AbstractSftpPacket::MaxPacketSize)
 {
+    m_requestClock.start();
+    setWriteBufferHighWaterMark(DefaultHighWaterMark);
+    connect(this, SIGNAL(bytesWritten(qint64)), SLOT(sendDeferredWriteRequests()));
 }
 
 SftpJobId SftpChannelPrivate::createJob(const AbstractSftpOperation::Ptr &job)
@@ -336,7 +409,7 @@ void SftpChannelPrivate::handleChannelDataInternal(const QByteArray &data)
     if (channelState() == CloseRequested)
         return;
 
-    m_incomingData += data;
+    m_incomingData.append(data);
     m_incomingPacket.consumeData(m_incomingData);
     while (m_incomingPacket.isComplete()) {
         handleCurrentPacket();
@@ -349,7 +422,7 @@ void SftpChannelPrivate::handleChannelExtendedDataInternal(quint32 type,
     const QByteArray &data)
 {
     qWarning("Unexpected extended data '%s' of type %d on SFTP channel.",
-        data.data(), type);
+        QByteArray(data.constData(), data.size()).constData(), type);
 }
 
 void SftpChannelPrivate::handleExitStatus(const SshChannelExitStatus &exitStatus)
@@ -392,6 +465,9 @@ void SftpChannelPrivate::handleCurrentPacket()
     case SSH_FXP_ATTRS:
         handleAttrs();
         break;
+    case SSH_FXP_EXTENDED_REPLY:
+        handleExtendedReply();
+        break;
     default:
         throw SshServerException(SSH_DISCONNECT_PROTOCOL_ERROR,
             "Unexpected packet.",
@@ -410,15 +486,51 @@ void SftpChannelPrivate::handleServerVersion()
 #ifdef CREATOR_SSH_DEBUG
     qDebug("sftp init received");
 #endif
-    const quint32 serverVersion = m_incomingPacket.extractServerVersion();
-    if (serverVersion != ProtocolVersion) {
+    const SftpServerVersion serverVersion = m_incomingPacket.asServerVersion();
+    if (serverVersion.version != ProtocolVersion) {
         emit initializationFailed(tr("Protocol version mismatch: Expected %1, got %2")
-            .arg(serverVersion).arg(ProtocolVersion));
+            .arg(serverVersion.version).arg(ProtocolVersion));
         closeChannel();
+        return;
+    }
+
+    // Transfers are sized by the limits, so ask for them before accepting jobs.
+    m_serverExtensions = serverVersion.extensions;
+    if (m_serverExtensions.contains(LimitsExtension)) {
+        m_limitsRequestId = ++m_nextJobId;
+        sendData(m_outgoingPacket.generateLimitsRequest(m_limitsRequestId).rawData());
+        m_sftpState = LimitsRequested;
     } else {
-        m_sftpState = Initialized;
-        emit initialized();
+        finishInitialization();
+    }
+}
+
+void SftpChannelPrivate::handleExtendedReply()
+{
+    if (m_sftpState != LimitsRequested || m_incomingPacket.requestId() != m_limitsRequestId) {
+        throw SSH_SERVER_EXCEPTION(SSH_DISCONNECT_PROTOCOL_ERROR,
+            "Unexpected SSH_FXP_EXTENDED_REPLY packet.");
     }
+
+    const SftpLimitsResponse limits = m_incomingPacket.asLimitsResponse();
+    m_maxPacketSize = negotiatedSize(limits.maxPacketLength, m_maxPacketSize);
+    m_maxReadSize = negotiatedSize(limits.maxReadLength, m_maxReadSize);
+    m_maxWriteSize = negotiatedSize(limits.maxWriteLength, m_maxWriteSize);
+
+    // Replies to reads carry up to 13 bytes of header in addition to the data.
+    m_incomingPacket.setMaxPacketSize(qMax(AbstractSftpPacket::MaxPacketSize,
+        m_maxReadSize + 1024));
+#ifdef CREATOR_SSH_DEBUG
+    qDebug("sftp limits: packet %u, read %u, write %u", m_maxPacketSize, m_maxReadSize,
+        m_maxWriteSize);
+#endif
+    finishInitialization();
+}
+
+void SftpChannelPrivate::finishInitialization()
+{
+    m_sftpState = Initialized;
+    emit initialized();
 }
 
 void SftpChannelPrivate::handleHandle()
@@ -501,6 +613,10 @@ void SftpChannelPrivate::handleStatus()
 #ifdef CREATOR_SSH_DEBUG
     qDebug("%s: status = %d", Q_FUNC_INFO, response.status);
 #endif
+    if (m_sftpState == LimitsRequested && response.requestId == m_limitsRequestId) {
+        finishInitialization(); // Keep the default sizes.
+        return;
+    }
     JobMap::Iterator it = lookupJob(response.requestId);
     switch (it.value()->type()) {
     case AbstractSftpOperation::ListDir:
@@ -686,6 +802,8 @@ void SftpChannelPrivate::handleGetStatus(const JobMap::Iterator &it,
                 tr("Failed to retrieve information on the remote file ('stat' failed).")));
             sendTransferCloseHandle(op, response.requestId);
         } else {
+            quint64 offset;
+            op->offsets.take(response.requestId, &offset);
             if ((response.status != SSH_FX_EOF || response.requestId != op->eofId)
                 && !op->hasError)
                 reportRequestError(op, errorMessage(response.errorString,
@@ -744,14 +862,18 @@ void SftpChannelPrivate::handlePutStatus(const JobMap::Iterator &it,
         break;
     }
     case SftpUploadFile::Open:
+        --job->pendingWrites;
         if (job->hasError || (job->parentJob && job->parentJob->hasError)) {
             job->hasError = true;
             finishTransferRequest(it);
-            return;
-        }
-
-        if (response.status == SSH_FX_OK) {
-            sendWriteRequest(it);
+        } else if (response.status == SSH_FX_OK) {
+            job->pipeline.replyReceived(response.requestId, requestTime());
+            if (job->inFlightCount > job->pipeline.depth()) {
+                removeTransferRequest(it);
+            } else {
+                sendWriteRequest(it);
+                growWriteRequests(job);
+            }
         } else {
             if (job->parentJob)
                 job->parentJob->setError();
@@ -759,6 +881,11 @@ void SftpChannelPrivate::handlePutStatus(const JobMap::Iterator &it,
                 tr("Failed to write remote file.")));
             finishTransferRequest(it);
         }
+
+        // Waiting requests may send a partial chunk once nothing is outstanding,
+        // and must be finished after an error.
+        if (job->pendingWrites == 0 || job->hasError)
+            sendWaitingWriteRequests();
         break;
     case SftpUploadFile::CloseRequested:
         Q_ASSERT(job->inFlightCount == 1);
@@ -842,38 +969,27 @@ void SftpChannelPrivate::handleReadData()
     }
 
     SftpDownload::Ptr op = it.value().staticCast<SftpDownload>();
+    quint64 offset;
+    if (!op->offsets.take(response.requestId, &offset)) {
+        throw SSH_SERVER_EXCEPTION(SSH_DISCONNECT_PROTOCOL_ERROR,
+            "Unexpected SSH_FXP_DATA packet.");
+    }
     if (op->hasError) {
         finishTransferRequest(it);
         return;
     }
 
-    if (!op->localFile->isOpen()) {
-        QFile *fileDevice = qobject_cast<QFile*>(op->localFile.data());
-        if (fileDevice){
-            if (!Internal::openFile(fileDevice, op->mode)) {
-                reportRequestError(op, tr("Cannot open file ") + fileDevice->fileName());
-                finishTransferRequest(it);
-                return;
-            }
-        } else {
-            reportRequestError(op, tr("File to upload is not open"));
-            finishTransferRequest(it);
-            return;
-        }
-    }
-
-    if (!op->localFile->seek(op->offsets[response.requestId])) {
-        reportRequestError(op, op->localFile->errorString());
+    if (!op->localFilePrepared && !prepareLocalFile(op)) {
         finishTransferRequest(it);
         return;
     }
 
-    if (op->localFile->write(response.data) != response.data.size()) {
-        reportRequestError(op, op->localFile->errorString());
+    if (!writeToLocalFile(op, offset, response.data)) {
         finishTransferRequest(it);
         return;
     }
 
+    op->pipeline.replyReceived(response.requestId, requestTime());
     emit transferPrograss(op->offset, op->fileSize);
     if (op->offset >= op->fileSize && op->fileSize != 0)
     {
@@ -881,12 +997,90 @@ void SftpChannelPrivate::handleReadData()
         //qDebug() << msg;
         finishTransferRequest(it);
     }
+    else if (op->inFlightCount > op->pipeline.depth())
+    {
+        removeTransferRequest(it);
+    }
     else
     {
         //QString msg = tr("SEND Name: %1 Result: op->offset: %2 op->fileSize: %3").arg(op->remotePath).arg(op->offset).arg(op->fileSize);
         //qDebug() << msg;
         sendReadRequest(op, response.requestId);
+        growReadRequests(op);
+    }
+}
+
+bool SftpChannelPrivate::prepareLocalFile(const SftpDownload::Ptr &op)
+{
+    op->localFilePrepared = true;
+    QFile * const fileDevice = qobject_cast<QFile *>(op->localFile.data());
+    if (!op->localFile->isOpen()) {
+        if (fileDevice){
+            if (!Internal::openFile(fileDevice, op->mode)) {
+                reportRequestError(op, tr("Cannot open file ") + fileDevice->fileName());
+                return false;
+            }
+        } else {
+            reportRequestError(op, tr("File to upload is not open"));
+            return false;
+        }
     }
+
+#ifdef Q_OS_UNIX
+    // Write the chunks straight to their offsets, bypassing QFile's seek and buffer.
+    // In append mode, the system would ignore the offsets.
+    if (!fileDevice || (fileDevice->openMode() & QIODevice::Append) || !fileDevice->flush())
+        return true;
+    op->fileDescriptor = fileDevice->handle();
+#ifdef Q_OS_LINUX
+    // Reserve the space up front, so that the file does not get fragmented by the
+    // out-of-order writes and a full disk is noticed right away. Unlike
+    // posix_fallocate(), FALLOC_FL_KEEP_SIZE leaves the visible file size alone,
+    // so a download that ends early does not leave zeros behind.
+    if (op->fileDescriptor != -1 && op->fileSize > 0
+            && fallocate(op->fileDescriptor, FALLOC_FL_KEEP_SIZE, 0, op->fileSize) == -1
+            && errno == ENOSPC) {
+        reportRequestError(op, qt_error_string(errno));
+        return false;
+    }
+#endif
+#endif
+    return true;
+}
+
+bool SftpChannelPrivate::writeToLocalFile(const SftpDownload::Ptr &op, quint64 offset,
+    const QByteArray &data)
+{
+#ifdef Q_OS_UNIX
+    if (op->fileDescriptor != -1) {
+        const char *buffer = data.constData();
+        size_t bytesLeft = data.size();
+        while (bytesLeft > 0) {
+            const ssize_t written = pwrite(op->fileDescriptor, buffer, bytesLeft, offset);
+            if (written == -1 && errno == EINTR)
+                continue;
+            if (written <= 0) {
+                reportRequestError(op, qt_error_string(errno));
+                return false;
+            }
+            buffer += written;
+            bytesLeft -= written;
+            offset += written;
+        }
+        return true;
+    }
+#endif
+
+    if (!op->localFile->seek(offset)) {
+        reportRequestError(op, op->localFile->errorString());
+        return false;
+    }
+
+    if (op->localFile->write(data) != data.size()) {
+        reportRequestError(op, op->localFile->errorString());
+        return false;
+    }
+    return true;
 }
 
 void SftpChannelPrivate::handleAttrs()
@@ -1007,6 +1201,8 @@ void SftpChannelPrivate::closeHook()
     for (JobMap::ConstIterator it = m_jobs.constBegin(); it != m_jobs.constEnd(); ++it)
         emit finished(it.key(), tr("SFTP channel closed unexpectedly."));
     m_jobs.clear();
+    m_deferredWriteRequests.clear();
+    m_waitingWriteRequests.clear();
     m_incomingData.clear();
     m_incomingPacket.clear();
     emit closed();
@@ -1034,12 +1230,13 @@ void SftpChannelPrivate::sendReadRequest(const SftpDownload::Ptr &job,
     quint32 requestId)
 {
     Q_ASSERT(job->eofId == SftpInvalidJob);
-    quint32 dataSize = AbstractSftpPacket::MaxDataSize;
+    quint32 dataSize = job->chunkSize;
     if (job->size)
         dataSize = job->size + 1;
     sendData(m_outgoingPacket.generateReadFile(job->remoteHandle, job->offset,
         dataSize, requestId).rawData());
-    job->offsets[requestId] = job->offset;
+    job->pipeline.requestSent(requestId, requestTime());
+    job->offsets.append(requestId, job->offset);
     job->offset += dataSize;
     if (job->offset >= job->fileSize)
         job->eofId = requestId;
@@ -1140,7 +1337,19 @@ void SftpChannelPrivate::removeTransferRequest(const JobMap::Iterator &it)
 void SftpChannelPrivate::sendWriteRequest(const JobMap::Iterator &it)
 {
     SftpUploadFile::Ptr job = it.value().staticCast<SftpUploadFile>();
-    QByteArray data = job->localFile->read(AbstractSftpPacket::MaxDataSize);
+
+    // Don't read more of the local file while the network cannot keep up.
+    if (mustDeferWriteRequest(job->chunkSize)) {
+        m_deferredWriteRequests << it.key();
+        return;
+    }
+
+    if (!job->canSendChunk()) {
+        m_waitingWriteRequests << it.key();
+        return;
+    }
+
+    const QByteArray data = job->readChunk();
 
     QFileDevice *fileDevice = qobject_cast<QFileDevice*>(job->localFile.data());
     if (fileDevice && fileDevice->error() != QFileDevice::NoError) {
@@ -1149,28 +1358,111 @@ void SftpChannelPrivate::sendWriteRequest(const JobMap::Iterator &it)
         reportRequestError(job, tr("Error reading local file: %1")
             .arg(job->localFile->errorString()));
         finishTransferRequest(it);
+        sendWaitingWriteRequests();
     } else if (data.isEmpty()) {
+        job->endReached = true;
         finishTransferRequest(it);
     } else {
         sendData(m_outgoingPacket.generateWriteFile(job->remoteHandle,
             job->offset, data, it.key()).rawData());
-        job->offset += AbstractSftpPacket::MaxDataSize;
-        emit transferPrograss(job->offset, job->localFile->size());
+        job->pipeline.requestSent(it.key(), requestTime());
+        ++job->pendingWrites;
+        job->offset += data.size(); // Sequential devices may return less than asked for.
+        emit transferPrograss(job->offset, job->fileSize);
+    }
+}
+
+// A request waits if its chunk would take the unwritten data past the high-water
+// mark. With nothing unwritten, there will be no bytesWritten() to resume it, so
+// it is sent even if the chunk alone exceeds the mark.
+bool SftpChannelPrivate::mustDeferWriteRequest(quint32 chunkSize) const
+{
+    const qint64 highWaterMark = writeBufferHighWaterMark();
+    const qint64 unwritten = bytesToWrite();
+    return highWaterMark > 0 && unwritten > 0 && unwritten + chunkSize > highWaterMark;
+}
+
+void SftpChannelPrivate::sendDeferredWriteRequests()
+{
+    while (!m_deferredWriteRequests.isEmpty()) {
+        const JobMap::Iterator it = m_jobs.find(m_deferredWriteRequests.first());
+        if (it == m_jobs.end()) {
+            m_deferredWriteRequests.removeFirst();
+            continue;
+        }
+        SftpUploadFile::Ptr job = it.value().staticCast<SftpUploadFile>();
+        if (job->hasError || (job->parentJob && job->parentJob->hasError)) {
+            m_deferredWriteRequests.removeFirst();
+            job->hasError = true;
+            finishTransferRequest(it);
+        } else if (mustDeferWriteRequest(job->chunkSize)) {
+            break;
+        } else {
+            m_deferredWriteRequests.removeFirst();
+            sendWriteRequest(it);
+        }
     }
 }
 
+// Requests of streaming uploads that have no data to send yet are retried when
+// their source has more data or has finished.
+void SftpChannelPrivate::sendWaitingWriteRequests()
+{
+    const QList<SftpJobId> requests = m_waitingWriteRequests;
+    m_waitingWriteRequests.clear();
+    foreach (const SftpJobId requestId, requests) {
+        const JobMap::Iterator it = m_jobs.find(requestId);
+        if (it == m_jobs.end())
+            continue;
+        SftpUploadFile::Ptr job = it.value().staticCast<SftpUploadFile>();
+        if (job->hasError || (job->parentJob && job->parentJob->hasError)) {
+            job->hasError = true;
+            finishTransferRequest(it);
+        } else {
+            sendWriteRequest(it);
+        }
+    }
+}
+
+void SftpChannelPrivate::handleUploadSourceFinished()
+{
+    for (JobMap::ConstIterator it = m_jobs.constBegin(); it != m_jobs.constEnd(); ++it) {
+        if (it.value()->type() != AbstractSftpOperation::UploadFile)
+            continue;
+        SftpUploadFile::Ptr job = it.value().staticCast<SftpUploadFile>();
+        if (job->localFile.data() == sender())
+            job->sourceFinishedSignaled = true;
+    }
+    sendWaitingWriteRequests();
+}
+
 void SftpChannelPrivate::spawnWriteRequests(const JobMap::Iterator &it)
 {
     SftpUploadFile::Ptr op = it.value().staticCast<SftpUploadFile>();
-    op->calculateInFlightCount(AbstractSftpPacket::MaxDataSize);
+    prepareTransfer(op);
+    if (op->streaming) {
+        connect(op->localFile.data(), SIGNAL(readyRead()),
+            SLOT(sendWaitingWriteRequests()), Qt::UniqueConnection);
+        connect(op->localFile.data(), SIGNAL(readChannelFinished()),
+            SLOT(handleUploadSourceFinished()), Qt::UniqueConnection);
+        connect(op->localFile.data(), SIGNAL(aboutToClose()),
+            SLOT(handleUploadSourceFinished()), Qt::UniqueConnection);
+    } else if (QFile * const file = qobject_cast<QFile *>(op->localFile.data())) {
+        op->mappedFile.open(file);
+    }
     sendWriteRequest(it);
     for (int i = 1; !op->hasError && i < op->inFlightCount; ++i)
         sendWriteRequest(m_jobs.insert(++m_nextJobId, op));
+
+    // The size of sequential sources is unknown, so the pipeline is filled until
+    // the end is seen. Requests of streaming uploads wait for data as needed.
+    if (op->localFile->isSequential())
+        growWriteRequests(op);
 }
 
 void SftpChannelPrivate::spawnReadRequests(const SftpDownload::Ptr &job)
 {
-    job->calculateInFlightCount(AbstractSftpPacket::MaxDataSize);
+    prepareTransfer(job);
     sendReadRequest(job, job->jobId);
     for (int i = 1; i < job->inFlightCount; ++i) {
         const quint32 requestId = ++m_nextJobId;
@@ -1179,5 +1471,45 @@ void SftpChannelPrivate::spawnReadRequests(const SftpDownload::Ptr &job)
     }
 }
 
+// Adds requests while the pipeline wants more of them and the file has more data.
+void SftpChannelPrivate::growReadRequests(const SftpDownload::Ptr &job)
+{
+    while (job->inFlightCount < job->pipeline.depth() && job->eofId == SftpInvalidJob)
+        sendReadRequest(job, addTransferRequest(job).key());
+}
+
+void SftpChannelPrivate::growWriteRequests(const SftpUploadFile::Ptr &job)
+{
+    while (!job->hasError && job->inFlightCount < job->pipeline.depth()
+           && !job->atEnd()) {
+        sendWriteRequest(addTransferRequest(job));
+    }
+}
+
+void SftpChannelPrivate::prepareTransfer(const AbstractSftpTransfer::Ptr &job)
+{
+    if (job->type() == AbstractSftpOperation::Download) {
+        job->chunkSize = m_maxReadSize;
+    } else {
+        // A WRITE request has 25 bytes of fixed overhead (length, type, request id,
+        // handle length, offset, data length) plus the handle. Requests that do not
+        // fit into a single SSH packet are cut to fill whole packets.
+        const quint32 overhead = 25 + job->remoteHandle.size();
+        quint32 requestSize = qMin(m_maxWriteSize + overhead, m_maxPacketSize);
+        if (requestSize > remoteMaxDataSize())
+            requestSize -= requestSize % remoteMaxDataSize();
+        job->chunkSize = requestSize - overhead;
+    }
+    job->pipeline.setDepthLimits(m_minRequestsInFlight, m_maxRequestsInFlight);
+    job->calculateInFlightCount();
+}
+
+SftpChannelPrivate::JobMap::Iterator SftpChannelPrivate::addTransferRequest(
+    const AbstractSftpTransfer::Ptr &job)
+{
+    ++job->inFlightCount;
+    return m_jobs.insert(++m_nextJobId, job);
+}
+
 } // namespace Internal
 } // namespace QSsh
@@ -73,6 +73,10 @@ public:
         const QString &newPath);
     SftpJobId createFile(const QString &filePath, SftpOverwriteMode mode);
     SftpJobId createLink(const QString &filePath, const QString &target);
+    /*
+     * Sequential devices such as sockets and processes are uploaded as their data
+     * arrives, until they emit readChannelFinished() or are closed.
+     */
     SftpJobId uploadFile(QSharedPointer<QIODevice> localFile,
         const QString &remoteFilePath, SftpOverwriteMode mode);
     SftpJobId uploadFile(const QString &localFilePath,
@@ -89,6 +93,34 @@ public:
     ~SftpChannel();
 
     SftpJobId downloadFile(const QString &remoteFilePath, QSharedPointer<QIODevice> localFile, quint32 size);
+
+    // Bytes of SFTP requests that have not been written to the network yet.
+    qint64 bytesToWrite() const;
+
+    /*
+     * Uploads stop reading from their local files while another chunk would take
+     * bytesToWrite() past this value and continue once bytesWritten() has been
+     * emitted. A chunk is always sent if nothing else is waiting to be written.
+     * 0 means no limit; the default is 2 MB.
+     */
+    void setWriteBufferHighWaterMark(qint64 bytes);
+    qint64 writeBufferHighWaterMark() const;
+
+    // Share of the connection's outgoing bandwidth relative to other channels; default 1.
+    void setPriority(int priority);
+    int priority() const;
+
+    /*
+     * Limits for the number of READ or WRITE requests a transfer keeps in flight.
+     * In between, the number adapts to the measured round-trip time and throughput.
+     * Equal limits give a fixed number. Affects transfers started afterwards;
+     * the defaults are 1 and 512.
+     */
+    void setMinimumRequestsInFlight(int count);
+    int minimumRequestsInFlight() const;
+    void setMaximumRequestsInFlight(int count);
+    int maximumRequestsInFlight() const;
+
 signals:
     void initialized();
     void initializationFailed(const QString &reason);
@@ -101,6 +133,7 @@ signals:
     void dataAvailable(QSsh::SftpJobId job, const QString &data);
 
     void transferPrograss(quint64 currentSize, quint64 totleSize);
+    void bytesWritten(qint64 bytes);
     /*
      * This signal is emitted as a result of:
      *     - statFile() (with the list having exactly one element)
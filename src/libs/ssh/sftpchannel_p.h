@@ -36,8 +36,11 @@
 #include "sftpoperation_p.h"
 #include "sftpoutgoingpacket_p.h"
 #include "sshchannel_p.h"
+#include "sshreceivebuffer_p.h"
 
 #include <QByteArray>
+#include <QElapsedTimer>
+#include <QList>
 #include <QMap>
 
 namespace QSsh {
@@ -50,7 +53,7 @@ class SftpChannelPrivate : public AbstractSshChannel
     friend class QSsh::SftpChannel;
 public:
 
-    enum SftpState { Inactive, SubsystemRequested, InitSent, Initialized };
+    enum SftpState { Inactive, SubsystemRequested, InitSent, LimitsRequested, Initialized };
 
     virtual void handleChannelSuccess();
     virtual void handleChannelFailure();
@@ -82,10 +85,14 @@ private:
 
     void handleCurrentPacket();
     void handleServerVersion();
+    void handleExtendedReply();
+    void finishInitialization();
     void handleHandle();
     void handleStatus();
     void handleName();
     void handleReadData();
+    bool prepareLocalFile(const SftpDownload::Ptr &op);
+    bool writeToLocalFile(const SftpDownload::Ptr &op, quint64 offset, const QByteArray &data);
     void handleAttrs();
 
     void handleDownloadDir(SftpListDir::Ptr op, const QList<SftpFileInfo> & fileInfoList);
@@ -108,8 +115,17 @@ private:
 
     void spawnReadRequests(const SftpDownload::Ptr &job);
     void spawnWriteRequests(const JobMap::Iterator &it);
+    void growReadRequests(const SftpDownload::Ptr &job);
+    void growWriteRequests(const SftpUploadFile::Ptr &job);
+    void prepareTransfer(const AbstractSftpTransfer::Ptr &job);
+    JobMap::Iterator addTransferRequest(const AbstractSftpTransfer::Ptr &job);
+    qint64 requestTime() const { return m_requestClock.nsecsElapsed() / 1000; }
     void sendReadRequest(const SftpDownload::Ptr &job, quint32 requestId);
     void sendWriteRequest(const JobMap::Iterator &it);
+    bool mustDeferWriteRequest(quint32 chunkSize) const;
+    Q_SLOT void sendDeferredWriteRequests();
+    Q_SLOT void sendWaitingWriteRequests();
+    Q_SLOT void handleUploadSourceFinished();
     void finishTransferRequest(const JobMap::Iterator &it);
     void removeTransferRequest(const JobMap::Iterator &it);
     void reportRequestError(const AbstractSftpOperationWithHandle::Ptr &job,
@@ -121,12 +137,24 @@ private:
 
     JobMap::Iterator lookupJob(SftpJobId id);
     JobMap m_jobs;
+    QList<SftpJobId> m_deferredWriteRequests; // Uploads waiting for the network.
+    QList<SftpJobId> m_waitingWriteRequests; // Streaming uploads waiting for data.
     SftpOutgoingPacket m_outgoingPacket;
     SftpIncomingPacket m_incomingPacket;
-    QByteArray m_incomingData;
+    SshReceiveBuffer m_incomingData;
     SftpJobId m_nextJobId;
     SftpState m_sftpState;
     SftpChannel *m_sftp;
+    QElapsedTimer m_requestClock;
+    int m_minRequestsInFlight;
+    int m_maxRequestsInFlight;
+
+    // From SSH_FXP_VERSION and limits@openssh.com.
+    QMap<QByteArray, QByteArray> m_serverExtensions;
+    SftpJobId m_limitsRequestId;
+    quint32 m_maxReadSize;
+    quint32 m_maxWriteSize;
+    quint32 m_maxPacketSize; // Of packets to the server.
 };
 
 } // namespace Internal
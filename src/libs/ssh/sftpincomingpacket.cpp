@@ -33,42 +33,39 @@
 #include "sshexception_p.h"
 #include "sshpacketparser_p.h"
 
+#include <QtEndian>
+
 namespace QSsh {
 namespace Internal {
 
-SftpIncomingPacket::SftpIncomingPacket() : m_length(0)
+SftpIncomingPacket::SftpIncomingPacket() : m_length(0), m_maxPacketSize(MaxPacketSize)
 {
 }
 
-void SftpIncomingPacket::consumeData(QByteArray &newData)
+void SftpIncomingPacket::consumeData(SshReceiveBuffer &buffer)
 {
 #ifdef CREATOR_SSH_DEBUG
-    qDebug("%s: current data size = %d, new data size = %d", Q_FUNC_INFO,
-        m_data.size(), newData.size());
+    qDebug("%s: current data size = %d, buffered data size = %d", Q_FUNC_INFO,
+        m_data.size(), buffer.size());
 #endif
 
-    if (isComplete() || dataSize() + newData.size() < sizeof m_length)
+    if (isComplete() || static_cast<quint32>(buffer.size()) < sizeof m_length)
         return;
 
-    if (dataSize() < sizeof m_length) {
-        moveFirstBytes(m_data, newData, sizeof m_length - m_data.size());
-        m_length = SshPacketParser::asUint32(m_data, static_cast<quint32>(0));
-        if (m_length < static_cast<quint32>(TypeOffset + 1)
-            || m_length > MaxPacketSize) {
-            throw SSH_SERVER_EXCEPTION(SSH_DISCONNECT_PROTOCOL_ERROR,
-                "Invalid length field in SFTP packet.");
-        }
+    const quint32 length
+        = qFromBigEndian<quint32>(reinterpret_cast<const uchar *>(buffer.constData()));
+    if (length < static_cast<quint32>(TypeOffset + 1) || length > m_maxPacketSize) {
+        throw SSH_SERVER_EXCEPTION(SSH_DISCONNECT_PROTOCOL_ERROR,
+            "Invalid length field in SFTP packet.");
     }
+    const quint32 packetSize = length + 4;
+    if (static_cast<quint32>(buffer.size()) < packetSize)
+        return;
 
-    moveFirstBytes(m_data, newData,
-        qMin<quint32>(m_length - dataSize() + 4, newData.size()));
-}
-
-void SftpIncomingPacket::moveFirstBytes(QByteArray &target, QByteArray &source,
-    int n)
-{
-    target.append(source.left(n));
-    source.remove(0, n);
+    // Refer to the packet where it is instead of copying it out of the buffer.
+    m_data = QByteArray::fromRawData(buffer.data(), packetSize);
+    m_length = length;
+    buffer.consume(packetSize);
 }
 
 bool SftpIncomingPacket::isComplete() const
@@ -82,12 +79,19 @@ void SftpIncomingPacket::clear()
     m_length = 0;
 }
 
-quint32 SftpIncomingPacket::extractServerVersion() const
+SftpServerVersion SftpIncomingPacket::asServerVersion() const
 {
     Q_ASSERT(isComplete());
     Q_ASSERT(type() == SSH_FXP_VERSION);
     try {
-        return SshPacketParser::asUint32(m_data, TypeOffset + 1);
+        SftpServerVersion serverVersion;
+        quint32 offset = TypeOffset + 1;
+        serverVersion.version = SshPacketParser::asUint32(m_data, &offset);
+        while (offset < dataSize()) {
+            const QByteArray name = SshPacketParser::asString(m_data, &offset);
+            serverVersion.extensions.insert(name, SshPacketParser::asString(m_data, &offset));
+        }
+        return serverVersion;
     } catch (SshPacketParseException &) {
         throw SSH_SERVER_EXCEPTION(SSH_DISCONNECT_PROTOCOL_ERROR,
             "Invalid SSH_FXP_VERSION packet.");
@@ -162,6 +166,25 @@ SftpDataResponse SftpIncomingPacket::asDataResponse() const
     }
 }
 
+SftpLimitsResponse SftpIncomingPacket::asLimitsResponse() const
+{
+    Q_ASSERT(isComplete());
+    Q_ASSERT(type() == SSH_FXP_EXTENDED_REPLY);
+    try {
+        SftpLimitsResponse response;
+        quint32 offset = RequestIdOffset;
+        response.requestId = SshPacketParser::asUint32(m_data, &offset);
+        response.maxPacketLength = SshPacketParser::asUint64(m_data, &offset);
+        response.maxReadLength = SshPacketParser::asUint64(m_data, &offset);
+        response.maxWriteLength = SshPacketParser::asUint64(m_data, &offset);
+        response.maxOpenHandles = SshPacketParser::asUint64(m_data, &offset);
+        return response;
+    } catch (SshPacketParseException &) {
+        throw SSH_SERVER_EXCEPTION(SSH_DISCONNECT_PROTOCOL_ERROR,
+            "Invalid limits@openssh.com reply.");
+    }
+}
+
 SftpAttrsResponse SftpIncomingPacket::asAttrsResponse() const
 {
     Q_ASSERT(isComplete());
@@ -32,10 +32,27 @@
 #define SFTPINCOMINGPACKET_P_H
 
 #include "sftppacket_p.h"
+#include "sshreceivebuffer_p.h"
+
+#include <QMap>
 
 namespace QSsh {
 namespace Internal {
 
+struct SftpServerVersion {
+    quint32 version;
+    QMap<QByteArray, QByteArray> extensions; // Name -> data
+};
+
+// Reply to limits@openssh.com. A value of 0 means "no limit given".
+struct SftpLimitsResponse {
+    quint32 requestId;
+    quint64 maxPacketLength;
+    quint64 maxReadLength;
+    quint64 maxWriteLength;
+    quint64 maxOpenHandles;
+};
+
 struct SftpHandleResponse {
     quint32 requestId;
     QByteArray handle;
@@ -87,23 +104,27 @@ class SftpIncomingPacket : public AbstractSftpPacket
 public:
     SftpIncomingPacket();
 
-    void consumeData(QByteArray &data);
+    void consumeData(SshReceiveBuffer &buffer);
     void clear();
     bool isComplete() const;
-    quint32 extractServerVersion() const;
+
+    // Packets longer than this are rejected; the default is MaxPacketSize.
+    void setMaxPacketSize(quint32 size) { m_maxPacketSize = size; }
+
+    SftpServerVersion asServerVersion() const;
     SftpHandleResponse asHandleResponse() const;
     SftpStatusResponse asStatusResponse() const;
     SftpNameResponse asNameResponse() const;
     SftpDataResponse asDataResponse() const;
     SftpAttrsResponse asAttrsResponse() const;
+    SftpLimitsResponse asLimitsResponse() const;
 
 private:
-    void moveFirstBytes(QByteArray &target, QByteArray &source, int n);
-
     SftpFileAttributes asFileAttributes(quint32 &offset) const;
     SftpFile asFile(quint32 &offset) const;
 
     quint32 m_length;
+    quint32 m_maxPacketSize;
 };
 
 } // namespace Internal
@@ -0,0 +1,100 @@
+/**************************************************************************
+**
+** This file is part of Qt Creator
+**
+** Copyright (c) 2012 Nokia Corporation and/or its subsidiary(-ies).
+**
+** Contact: http://www.qt-project.org/
+**
+**
+** GNU Lesser General Public License Usage
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.LGPL included in the packaging of this file.
+** Please review the following information to ensure the GNU Lesser General
+** Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights. These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** Other Usage
+**
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and Nokia.
+**
+**
+**************************************************************************/
+
+#include "sftpmappedfile_p.h"
+
+#include <QFile>
+
+namespace QSsh {
+namespace Internal {
+
+SftpMappedFile::SftpMappedFile()
+    : m_file(0), m_size(0), m_position(0), m_window(0), m_windowStart(0), m_windowSize(0)
+{
+}
+
+SftpMappedFile::~SftpMappedFile()
+{
+    unmapWindow();
+}
+
+bool SftpMappedFile::open(QFile *file)
+{
+    close();
+    if (!file->isOpen() || !file->isReadable() || file->isSequential())
+        return false;
+    m_size = file->size();
+    m_position = file->pos();
+    if (m_position >= m_size)
+        return false;
+    m_file = file;
+    return true;
+}
+
+QByteArray SftpMappedFile::read(qint64 maxSize)
+{
+    if (!m_file || atEnd())
+        return QByteArray();
+
+    const qint64 size = qMin(maxSize, m_size - m_position);
+    if (m_position + size > m_windowStart + m_windowSize || m_position < m_windowStart) {
+        unmapWindow();
+        m_windowStart = m_position;
+        m_windowSize = qMin(WindowSize, m_size - m_position);
+        m_window = m_file->map(m_windowStart, m_windowSize);
+        if (!m_window) {
+            m_windowSize = 0;
+            m_file->seek(m_position);
+            close();
+            return QByteArray();
+        }
+    }
+
+    const char * const data = reinterpret_cast<const char *>(m_window) + m_position - m_windowStart;
+    m_position += size;
+    return QByteArray::fromRawData(data, int(size));
+}
+
+void SftpMappedFile::close()
+{
+    unmapWindow();
+    m_file = 0;
+}
+
+void SftpMappedFile::unmapWindow()
+{
+    if (m_window)
+        m_file->unmap(m_window);
+    m_window = 0;
+    m_windowStart = m_windowSize = 0;
+}
+
+} // namespace Internal
+} // namespace QSsh
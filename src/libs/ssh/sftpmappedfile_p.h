@@ -0,0 +1,84 @@
+/**************************************************************************
+**
+** This file is part of Qt Creator
+**
+** Copyright (c) 2012 Nokia Corporation and/or its subsidiary(-ies).
+**
+** Contact: http://www.qt-project.org/
+**
+**
+** GNU Lesser General Public License Usage
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.LGPL included in the packaging of this file.
+** Please review the following information to ensure the GNU Lesser General
+** Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights. These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** Other Usage
+**
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and Nokia.
+**
+**
+**************************************************************************/
+
+#ifndef SFTPMAPPEDFILE_P_H
+#define SFTPMAPPEDFILE_P_H
+
+#include <QByteArray>
+
+QT_BEGIN_NAMESPACE
+class QFile;
+QT_END_NAMESPACE
+
+namespace QSsh {
+namespace Internal {
+
+/*
+ * Reads a local file through read-only memory maps of a window starting at the
+ * current position, so that data goes from the page cache straight into the
+ * packets instead of being copied into a buffer by read() first.
+ * The file must not be truncated by others while it is mapped.
+ */
+class SftpMappedFile
+{
+public:
+    SftpMappedFile();
+    ~SftpMappedFile();
+
+    // Starts at the file's current position. Returns false if the file cannot be mapped.
+    bool open(QFile *file);
+    bool isOpen() const { return m_file != 0; }
+
+    // The result refers to the mapped memory and is valid until the next call.
+    // On failure, the file is closed, and the file's own position is set to where
+    // reading should continue. An empty result means the end has been reached.
+    QByteArray read(qint64 maxSize);
+    bool atEnd() const { return m_position >= m_size; }
+
+    static const qint64 WindowSize = 64 * 1024 * 1024;
+
+private:
+    Q_DISABLE_COPY(SftpMappedFile)
+
+    void close();
+    void unmapWindow();
+
+    QFile *m_file;
+    qint64 m_size;
+    qint64 m_position;
+    uchar *m_window;
+    qint64 m_windowStart;
+    qint64 m_windowSize;
+};
+
+} // namespace Internal
+} // namespace QSsh
+
+#endif // SFTPMAPPEDFILE_P_H
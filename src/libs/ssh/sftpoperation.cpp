@@ -146,37 +146,65 @@ SftpOutgoingPacket & SftpCreateFile::initialPacket(SftpOutgoingPacket &packet)
 }
 
 
-const int AbstractSftpTransfer::MaxInFlightCount = 10; // Experimentally found to be enough.
-
 AbstractSftpTransfer::AbstractSftpTransfer(SftpJobId jobId, const QString &remotePath,
     const QSharedPointer<QIODevice> &localFile)
     : AbstractSftpOperationWithHandle(jobId, remotePath),
-      localFile(localFile), fileSize(0), offset(0), inFlightCount(0),
-      statRequested(false)
+      localFile(localFile), fileSize(0), offset(0), chunkSize(AbstractSftpPacket::MaxDataSize),
+      inFlightCount(0), statRequested(false)
 {
 }
 
 AbstractSftpTransfer::~AbstractSftpTransfer() {}
 
-void AbstractSftpTransfer::calculateInFlightCount(quint32 chunkSize)
+void AbstractSftpTransfer::calculateInFlightCount()
 {
     if (fileSize == 0) {
         inFlightCount = 1;
     } else {
-        inFlightCount = fileSize / chunkSize;
-        if (fileSize % chunkSize)
-            ++inFlightCount;
-        if (inFlightCount > MaxInFlightCount)
-            inFlightCount = MaxInFlightCount;
+        inFlightCount = qMin<quint64>((fileSize + chunkSize - 1) / chunkSize, pipeline.depth());
+    }
+}
+
+
+void SftpOffsetRing::append(quint32 requestId, quint64 offset)
+{
+    if (m_count == m_entries.size()) {
+        QVector<Entry> entries(qMax(16, m_entries.size() * 2));
+        for (int i = 0; i < m_count; ++i)
+            entries[i] = m_entries.at((m_head + i) & (m_entries.size() - 1));
+        m_entries = entries;
+        m_head = 0;
     }
+    const Entry entry = { requestId, offset };
+    m_entries[(m_head + m_count) & (m_entries.size() - 1)] = entry;
+    ++m_count;
+}
+
+bool SftpOffsetRing::take(quint32 requestId, quint64 *offset)
+{
+    const int mask = m_entries.size() - 1;
+    for (int i = 0; i < m_count; ++i) {
+        if (m_entries.at((m_head + i) & mask).requestId != requestId)
+            continue;
+        *offset = m_entries.at((m_head + i) & mask).offset;
+
+        // Close the gap, keeping the order of the others.
+        for (int j = i; j > 0; --j)
+            m_entries[(m_head + j) & mask] = m_entries.at((m_head + j - 1) & mask);
+        m_head = (m_head + 1) & mask;
+        --m_count;
+        return true;
+    }
+    return false;
 }
 
 
 SftpDownload::SftpDownload(SftpJobId jobId, const QString &remotePath,
     const QSharedPointer<QIODevice> &localFile, SftpOverwriteMode mode, quint32 reqsize,
     const QSharedPointer<QSsh::Internal::SftpDownloadDir> &parentJob)
-    : AbstractSftpTransfer(jobId, remotePath, localFile), eofId(SftpInvalidJob), mode(mode),
-      parentJob(parentJob), size(reqsize)
+    : AbstractSftpTransfer(jobId, remotePath, localFile), fileDescriptor(-1),
+      localFilePrepared(false), eofId(SftpInvalidJob), mode(mode), parentJob(parentJob),
+      size(reqsize)
 {
 
 }
@@ -192,9 +220,46 @@ SftpUploadFile::SftpUploadFile(SftpJobId jobId, const QString &remotePath,
     const QSharedPointer<QIODevice> &localFile, SftpOverwriteMode mode,
     const SftpUploadDir::Ptr &parentJob)
     : AbstractSftpTransfer(jobId, remotePath, localFile),
-      parentJob(parentJob), mode(mode)
+      parentJob(parentJob), mode(mode),
+      // QFile does not emit readyRead() for pipes; reading from them blocks instead.
+      streaming(localFile->isSequential() && !qobject_cast<QFileDevice *>(localFile.data())),
+      sourceFinishedSignaled(false), endReached(false), pendingWrites(0)
+{
+    fileSize = localFile->isSequential() ? 0 : localFile->size();
+}
+
+QByteArray SftpUploadFile::readChunk()
+{
+    if (mappedFile.isOpen()) {
+        const QByteArray data = mappedFile.read(chunkSize);
+        if (!data.isEmpty() || mappedFile.isOpen())
+            return data;
+    }
+    return localFile->read(chunkSize);
+}
+
+bool SftpUploadFile::atEnd() const
+{
+    if (endReached)
+        return true;
+    if (streaming)
+        return sourceFinished() && localFile->bytesAvailable() <= 0;
+    if (localFile->isSequential())
+        return false; // Only a read can tell.
+    return mappedFile.isOpen() ? mappedFile.atEnd() : localFile->atEnd();
+}
+
+bool SftpUploadFile::sourceFinished() const
+{
+    return !streaming || sourceFinishedSignaled || !localFile->isOpen();
+}
+
+bool SftpUploadFile::canSendChunk() const
 {
-    fileSize = localFile->size();
+    if (sourceFinished())
+        return true;
+    const qint64 available = localFile->bytesAvailable();
+    return available >= chunkSize || (available > 0 && pendingWrites == 0);
 }
 
 SftpOutgoingPacket &SftpUploadFile::initialPacket(SftpOutgoingPacket &packet)
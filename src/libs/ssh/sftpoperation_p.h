@@ -32,11 +32,14 @@
 #define SFTPOPERATION_P_H
 
 #include "sftpdefs.h"
+#include "sftpmappedfile_p.h"
+#include "sftprequestpipeline_p.h"
 
 #include <QByteArray>
 #include <QList>
 #include <QMap>
 #include <QSharedPointer>
+#include <QVector>
 
 QT_BEGIN_NAMESPACE
 class QIODevice;
@@ -186,17 +189,42 @@ struct AbstractSftpTransfer : public AbstractSftpOperationWithHandle
     AbstractSftpTransfer(SftpJobId jobId, const QString &remotePath,
         const QSharedPointer<QIODevice> &localFile);
     ~AbstractSftpTransfer();
-    void calculateInFlightCount(quint32 chunkSize);
-
-    static const int MaxInFlightCount;
+    void calculateInFlightCount();
 
     const QSharedPointer<QIODevice> localFile;
     quint64 fileSize;
     quint64 offset;
+    quint32 chunkSize; // Data per READ or WRITE request.
     int inFlightCount;
+    SftpRequestPipeline pipeline;
     bool statRequested;
 };
 
+/*
+ * The offsets of a download's READ requests in flight, in the order they were
+ * sent. Servers answer in that order, so take() almost always finds the oldest
+ * entry right away.
+ */
+class SftpOffsetRing
+{
+public:
+    SftpOffsetRing() : m_head(0), m_count(0) {}
+
+    void append(quint32 requestId, quint64 offset);
+    bool take(quint32 requestId, quint64 *offset);
+
+private:
+    struct Entry
+    {
+        quint32 requestId;
+        quint64 offset;
+    };
+
+    QVector<Entry> m_entries; // The size is a power of two.
+    int m_head;
+    int m_count;
+};
+
 struct SftpDownload : public AbstractSftpTransfer
 {
     typedef QSharedPointer<SftpDownload> Ptr;
@@ -206,7 +234,9 @@ struct SftpDownload : public AbstractSftpTransfer
     virtual Type type() const { return Download; }
     virtual SftpOutgoingPacket &initialPacket(SftpOutgoingPacket &packet);
 
-    QMap<quint32, quint64> offsets;
+    SftpOffsetRing offsets;
+    int fileDescriptor; // For writing at an offset without seeking; -1 if not possible.
+    bool localFilePrepared;
     SftpJobId eofId;
     SftpOverwriteMode mode;
     const QSharedPointer<QSsh::Internal::SftpDownloadDir> parentJob;
@@ -223,8 +253,23 @@ struct SftpUploadFile : public AbstractSftpTransfer
     virtual Type type() const { return UploadFile; }
     virtual SftpOutgoingPacket &initialPacket(SftpOutgoingPacket &packet);
 
+    // Reads the next chunk through the memory map if there is one. The data is
+    // valid until the next call.
+    QByteArray readChunk();
+    bool atEnd() const;
+
+    // A streaming source is read as its data arrives, so a request may have to
+    // wait for it. Partial chunks are only sent if no WRITE request is outstanding.
+    bool sourceFinished() const;
+    bool canSendChunk() const;
+
     const QSharedPointer<SftpUploadDir> parentJob;
     SftpOverwriteMode mode;
+    const bool streaming; // Sequential source that signals new data.
+    bool sourceFinishedSignaled;
+    bool endReached; // A read returned no more data.
+    int pendingWrites; // WRITE requests the server has not answered yet.
+    SftpMappedFile mappedFile; // Refers to localFile, so it must be destroyed first.
 };
 
 // Composite operation.
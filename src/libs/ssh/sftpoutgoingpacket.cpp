@@ -146,6 +146,12 @@ SftpOutgoingPacket &SftpOutgoingPacket::generateWriteFile(const QByteArray &hand
         .appendInt64(offset).appendString(data).finalize();
 }
 
+SftpOutgoingPacket &SftpOutgoingPacket::generateLimitsRequest(quint32 requestId)
+{
+    return init(SSH_FXP_EXTENDED, requestId).appendString(QByteArray("limits@openssh.com"))
+        .finalize();
+}
+
 SftpOutgoingPacket &SftpOutgoingPacket::generateCreateLink(const QString &filePath,
     const QString &target, quint32 requestId)
 {
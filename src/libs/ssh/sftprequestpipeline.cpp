@@ -0,0 +1,100 @@
+/**************************************************************************
+**
+** This file is part of Qt Creator
+**
+** Copyright (c) 2012 Nokia Corporation and/or its subsidiary(-ies).
+**
+** Contact: http://www.qt-project.org/
+**
+**
+** GNU Lesser General Public License Usage
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.LGPL included in the packaging of this file.
+** Please review the following information to ensure the GNU Lesser General
+** Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights. These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** Other Usage
+**
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and Nokia.
+**
+**
+**************************************************************************/
+
+#include "sftprequestpipeline_p.h"
+
+namespace QSsh {
+namespace Internal {
+
+SftpRequestPipeline::SftpRequestPipeline()
+    : m_minDepth(DefaultMinDepth), m_maxDepth(DefaultMaxDepth), m_depth(InitialDepth),
+      m_timing(false), m_timedRequest(0), m_timedSince(0), m_roundReplies(0),
+      m_minRoundTripTime(0), m_probing(true), m_justCut(false)
+{
+}
+
+void SftpRequestPipeline::setDepthLimits(int minDepth, int maxDepth)
+{
+    m_minDepth = qMax(minDepth, 1);
+    m_maxDepth = qMax(maxDepth, m_minDepth);
+    m_depth = qBound(m_minDepth, m_depth, m_maxDepth);
+}
+
+void SftpRequestPipeline::requestSent(quint32 requestId, qint64 now)
+{
+    if (m_timing)
+        return;
+    m_timing = true;
+    m_timedRequest = requestId;
+    m_timedSince = now;
+    m_roundReplies = 0;
+}
+
+void SftpRequestPipeline::replyReceived(quint32 requestId, qint64 now)
+{
+    ++m_roundReplies;
+    if (!m_timing || requestId != m_timedRequest)
+        return;
+    m_timing = false;
+    adapt(qMax<qint64>(now - m_timedSince, 1));
+}
+
+void SftpRequestPipeline::adapt(qint64 roundTripTime)
+{
+    if (m_minRoundTripTime == 0 || roundTripTime < m_minRoundTripTime)
+        m_minRoundTripTime = roundTripTime;
+
+    if (roundTripTime * 2 < m_minRoundTripTime * 3) {
+        m_justCut = false;
+        if (m_roundReplies * 2 >= m_depth) {
+            const int increment = m_probing ? m_depth : m_depth / 8 + 1;
+            m_depth = qMin(m_depth + increment, m_maxDepth);
+        }
+    } else if (roundTripTime >= m_minRoundTripTime * 2) {
+        if (m_justCut) {
+            m_minRoundTripTime = roundTripTime;
+            m_probing = true;
+            m_justCut = false;
+            return;
+        }
+
+        // The replies of one round trip were carried in roundTripTime; without
+        // queuing, a quarter more than that keeps the path busy.
+        const qint64 needed = m_roundReplies * m_minRoundTripTime * 5 / (roundTripTime * 4) + 1;
+        if (needed < m_depth) {
+            m_depth = qMax(int(needed), m_minDepth);
+            m_probing = false;
+            m_justCut = true;
+        }
+    }
+}
+
+} // namespace Internal
+} // namespace QSsh
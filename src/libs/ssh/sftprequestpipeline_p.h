@@ -0,0 +1,87 @@
+/**************************************************************************
+**
+** This file is part of Qt Creator
+**
+** Copyright (c) 2012 Nokia Corporation and/or its subsidiary(-ies).
+**
+** Contact: http://www.qt-project.org/
+**
+**
+** GNU Lesser General Public License Usage
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.LGPL included in the packaging of this file.
+** Please review the following information to ensure the GNU Lesser General
+** Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights. These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** Other Usage
+**
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and Nokia.
+**
+**
+**************************************************************************/
+
+#ifndef SFTPREQUESTPIPELINE_P_H
+#define SFTPREQUESTPIPELINE_P_H
+
+#include <QtGlobal>
+
+namespace QSsh {
+namespace Internal {
+
+/*
+ * Decides how many read or write requests of one transfer are kept in flight.
+ * One request per round trip is timed. If its round-trip time is close to the
+ * lowest one seen, requests do not queue up anywhere, so the depth grows
+ * (provided the requests actually kept the pipeline busy): It doubles until
+ * queuing is first seen and then grows by an eighth. If the round-trip time is
+ * at least twice the lowest one, the depth is cut to what carries the measured
+ * throughput with some headroom. Queuing that does not go away after a cut is
+ * taken as a change of the path, and the round-trip time is measured anew.
+ * All times are in microseconds on an arbitrary monotonic clock.
+ */
+class SftpRequestPipeline
+{
+public:
+    SftpRequestPipeline();
+
+    // With minDepth == maxDepth, the depth is fixed.
+    void setDepthLimits(int minDepth, int maxDepth);
+    int depth() const { return m_depth; }
+
+    void requestSent(quint32 requestId, qint64 now);
+    void replyReceived(quint32 requestId, qint64 now);
+
+    // The lowest value seen, 0 if there has been no sample yet.
+    qint64 roundTripTime() const { return m_minRoundTripTime; }
+
+    static const int InitialDepth = 10;
+    static const int DefaultMinDepth = 1;
+    static const int DefaultMaxDepth = 512;
+
+private:
+    void adapt(qint64 roundTripTime);
+
+    int m_minDepth;
+    int m_maxDepth;
+    int m_depth;
+    bool m_timing;
+    quint32 m_timedRequest;
+    qint64 m_timedSince;
+    int m_roundReplies;
+    qint64 m_minRoundTripTime;
+    bool m_probing; // Doubling until the first cut.
+    bool m_justCut;
+};
+
+} // namespace Internal
+} // namespace QSsh
+
+#endif // SFTPREQUESTPIPELINE_P_H
@@ -0,0 +1,90 @@
+# The sources of the QSsh library. Besides ssh.pro, this is included by programs
+# that build the library's internals into themselves, like the benchmarks.
+
+INCLUDEPATH += C:/Botan/include/botan-2
+LIBS += C:/Botan/lib/botan.lib
+
+# zlib, for zlib@openssh.com compression. On Windows, Qt's own copy is used.
+win32: INCLUDEPATH += $$[QT_INSTALL_HEADERS]/QtZlib
+else: LIBS += -lz
+
+SOURCES += $$PWD/sshsendfacility.cpp \
+    $$PWD/sshsendqueue.cpp \
+    $$PWD/sshtimerwheel.cpp \
+    $$PWD/sshremoteprocess.cpp \
+    $$PWD/sshpacketparser.cpp \
+    $$PWD/sshpacket.cpp \
+    $$PWD/sshrandompool.cpp \
+    $$PWD/sshreadqueue.cpp \
+    $$PWD/sshreceivebuffer.cpp \
+    $$PWD/sshreceivewindow.cpp \
+    $$PWD/sshoutgoingpacket.cpp \
+    $$PWD/sshkeyencoding.cpp \
+    $$PWD/sshkeygenerator.cpp \
+    $$PWD/sshkeyexchange.cpp \
+    $$PWD/sshincomingpacket.cpp \
+    $$PWD/sshcryptofacility.cpp \
+    $$PWD/sshconnection.cpp \
+    $$PWD/sshchannelmanager.cpp \
+    $$PWD/sshchannel.cpp \
+    $$PWD/sshchannelscheduler.cpp \
+    $$PWD/sshcapabilities.cpp \
+    $$PWD/sshcompressionfacility.cpp \
+    $$PWD/sftppacket.cpp \
+    $$PWD/sftpmappedfile.cpp \
+    $$PWD/sftprequestpipeline.cpp \
+    $$PWD/sftpoutgoingpacket.cpp \
+    $$PWD/sftpoperation.cpp \
+    $$PWD/sftpincomingpacket.cpp \
+    $$PWD/sftpdefs.cpp \
+    $$PWD/sftpchannel.cpp \
+    $$PWD/sshremoteprocessrunner.cpp \
+    $$PWD/sshconnectionmanager.cpp \
+    $$PWD/sshkeypasswordretriever.cpp \
+    $$PWD/sftpfilesystemmodel.cpp
+
+HEADERS += $$PWD/sshsendfacility_p.h \
+    $$PWD/sshsendqueue_p.h \
+    $$PWD/sshtimerwheel_p.h \
+    $$PWD/sshremoteprocess.h \
+    $$PWD/sshremoteprocess_p.h \
+    $$PWD/sshpacketparser_p.h \
+    $$PWD/sshpacket_p.h \
+    $$PWD/sshrandompool_p.h \
+    $$PWD/sshreadqueue_p.h \
+    $$PWD/sshreceivebuffer_p.h \
+    $$PWD/sshreceivewindow_p.h \
+    $$PWD/sshoutgoingpacket_p.h \
+    $$PWD/sshkeyencoding_p.h \
+    $$PWD/sshkeygenerator.h \
+    $$PWD/sshkeyexchange_p.h \
+    $$PWD/sshincomingpacket_p.h \
+    $$PWD/sshexception_p.h \
+    $$PWD/ssherrors.h \
+    $$PWD/sshcryptofacility_p.h \
+    $$PWD/sshconnection.h \
+    $$PWD/sshconnection_p.h \
+    $$PWD/sshchannelmanager_p.h \
+    $$PWD/sshchannel_p.h \
+    $$PWD/sshchannelscheduler_p.h \
+    $$PWD/sshcapabilities_p.h \
+    $$PWD/sshcompressionfacility_p.h \
+    $$PWD/sshcopycount_p.h \
+    $$PWD/sshbotanconversions_p.h \
+    $$PWD/sftppacket_p.h \
+    $$PWD/sftpmappedfile_p.h \
+    $$PWD/sftprequestpipeline_p.h \
+    $$PWD/sftpoutgoingpacket_p.h \
+    $$PWD/sftpoperation_p.h \
+    $$PWD/sftpincomingpacket_p.h \
+    $$PWD/sftpdefs.h \
+    $$PWD/sftpchannel.h \
+    $$PWD/sftpchannel_p.h \
+    $$PWD/sshremoteprocessrunner.h \
+    $$PWD/sshconnectionmanager.h \
+    $$PWD/sshpseudoterminal.h \
+    $$PWD/sshkeypasswordretriever_p.h \
+    $$PWD/sftpfilesystemmodel.h \
+    $$PWD/ssh_global.h
+
+RESOURCES += $$PWD/res.qrc
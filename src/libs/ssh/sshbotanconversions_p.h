@@ -58,68 +58,136 @@ inline QByteArray convertByteArray(const std::vector<uint8_t> &v)
     return QByteArray(reinterpret_cast<const char *>(v.data()), v.size());
 }
 
+inline bool isCurve25519KeyExchangeAlgo(const QByteArray &rfcAlgoName)
+{
+    return rfcAlgoName == SshCapabilities::Curve25519Sha256
+        || rfcAlgoName == SshCapabilities::Curve25519Sha256LibSsh;
+}
+
+// With these, the public values are exchanged as strings rather than mpints.
+inline bool isEcdhKeyExchangeAlgo(const QByteArray &rfcAlgoName)
+{
+    return rfcAlgoName == SshCapabilities::EcdhNistp256
+        || isCurve25519KeyExchangeAlgo(rfcAlgoName);
+}
+
+// Not applicable to curve25519, for which there is no group object.
 inline const char *botanKeyExchangeAlgoName(const QByteArray &rfcAlgoName)
 {
     Q_ASSERT(rfcAlgoName == SshCapabilities::DiffieHellmanGroup1Sha1
-        || rfcAlgoName == SshCapabilities::DiffieHellmanGroup14Sha1);
+        || rfcAlgoName == SshCapabilities::DiffieHellmanGroup14Sha1
+             || rfcAlgoName == SshCapabilities::EcdhNistp256);
+    if (rfcAlgoName == SshCapabilities::EcdhNistp256)
+        return "secp256r1";
     return rfcAlgoName == SshCapabilities::DiffieHellmanGroup1Sha1
         ? "modp/ietf/1024" : "modp/ietf/2048";
 }
 
+// AEAD ciphers authenticate the packet themselves; no separate MAC is used with them.
+inline bool isAeadCryptAlgo(const QByteArray &rfcAlgoName)
+{
+    return rfcAlgoName == SshCapabilities::CryptAlgoAes128Gcm
+        || rfcAlgoName == SshCapabilities::CryptAlgoAes256Gcm
+        || rfcAlgoName == SshCapabilities::CryptAlgoChaCha20Poly1305;
+}
+
+// Not applicable to chacha20-poly1305, which is based on a stream cipher.
 inline const char *botanCryptAlgoName(const QByteArray &rfcAlgoName)
 {
     Q_ASSERT(rfcAlgoName == SshCapabilities::CryptAlgo3Des
         || rfcAlgoName == SshCapabilities::CryptAlgoAes128
-             || rfcAlgoName == SshCapabilities::CryptAlgoAes128ctr);
-    return rfcAlgoName == SshCapabilities::CryptAlgo3Des
-        ? "TripleDES" : "AES-128";
+             || rfcAlgoName == SshCapabilities::CryptAlgoAes128ctr
+             || rfcAlgoName == SshCapabilities::CryptAlgoAes128Gcm
+             || rfcAlgoName == SshCapabilities::CryptAlgoAes256Gcm);
+    if (rfcAlgoName == SshCapabilities::CryptAlgo3Des)
+        return "TripleDES";
+    if (rfcAlgoName == SshCapabilities::CryptAlgoAes256Gcm)
+        return "AES-256";
+    return "AES-128";
 }
 
-inline const char *botanAlgoNameParameter(const QByteArray &rfcAlgoName)
+inline const char *botanCipherModeName(const QByteArray &rfcAlgoName)
 {
     Q_ASSERT(rfcAlgoName == SshCapabilities::CryptAlgo3Des
         || rfcAlgoName == SshCapabilities::CryptAlgoAes128
-             || rfcAlgoName == SshCapabilities::CryptAlgoAes128ctr);
+             || rfcAlgoName == SshCapabilities::CryptAlgoAes128ctr
+             || rfcAlgoName == SshCapabilities::CryptAlgoAes128Gcm
+             || rfcAlgoName == SshCapabilities::CryptAlgoAes256Gcm);
     if (rfcAlgoName == SshCapabilities::CryptAlgo3Des)
-    {
-        return "TripleDES";
-    }
-    else if (rfcAlgoName == SshCapabilities::CryptAlgoAes128)
-    {
-        return "AES-128/CBC";
-    }
-    else if (rfcAlgoName == SshCapabilities::CryptAlgoAes128ctr)
-    {
-        return "AES-128/CTR";
-    }
-
-    return "";
+        return "TripleDES/CBC/NoPadding";
+    if (rfcAlgoName == SshCapabilities::CryptAlgoAes128)
+        return "AES-128/CBC/NoPadding";
+    if (rfcAlgoName == SshCapabilities::CryptAlgoAes128Gcm)
+        return "AES-128/GCM";
+    if (rfcAlgoName == SshCapabilities::CryptAlgoAes256Gcm)
+        return "AES-256/GCM";
+    return "AES-128/CTR";
 }
 
+inline const char *botanChaChaName() { return "ChaCha(20)"; }
+inline const char *botanPoly1305Name() { return "Poly1305"; }
+
 inline const char *botanEmsaAlgoName(const QByteArray &rfcAlgoName)
 {
     Q_ASSERT(rfcAlgoName == SshCapabilities::PubKeyDss
-        || rfcAlgoName == SshCapabilities::PubKeyRsa);
+        || rfcAlgoName == SshCapabilities::PubKeyRsa
+             || rfcAlgoName == SshCapabilities::PubKeyEd25519
+             || rfcAlgoName == SshCapabilities::PubKeyEcdsaNistp256);
+    if (rfcAlgoName == SshCapabilities::PubKeyEd25519)
+        return "Pure";
+    if (rfcAlgoName == SshCapabilities::PubKeyEcdsaNistp256)
+        return "EMSA1(SHA-256)";
     return rfcAlgoName == SshCapabilities::PubKeyDss
         ? "EMSA1(SHA-1)" : "EMSA3(SHA-1)";
 }
 
 inline const char *botanSha1Name() { return "SHA-1"; }
 
+// The hash used for the exchange hash H and for key derivation.
+inline const char *botanKeyExchangeHashName(const QByteArray &rfcAlgoName)
+{
+    return isEcdhKeyExchangeAlgo(rfcAlgoName) ? "SHA-256" : botanSha1Name();
+}
+
 inline const char *botanHMacAlgoName(const QByteArray &rfcAlgoName)
 {
-    Q_ASSERT(rfcAlgoName == SshCapabilities::HMacSha1);
-    Q_UNUSED(rfcAlgoName);
+    Q_ASSERT(rfcAlgoName == SshCapabilities::HMacSha1
+        || rfcAlgoName == SshCapabilities::HMacSha256
+             || rfcAlgoName == SshCapabilities::HMacSha512
+             || rfcAlgoName == SshCapabilities::HMacSha1Etm
+             || rfcAlgoName == SshCapabilities::HMacSha256Etm
+             || rfcAlgoName == SshCapabilities::HMacSha512Etm);
+    if (rfcAlgoName == SshCapabilities::HMacSha256
+            || rfcAlgoName == SshCapabilities::HMacSha256Etm) {
+        return "SHA-256";
+    }
+    if (rfcAlgoName == SshCapabilities::HMacSha512
+            || rfcAlgoName == SshCapabilities::HMacSha512Etm) {
+        return "SHA-512";
+    }
     return botanSha1Name();
 }
 
+// Key and MAC length are both the size of the hash.
 inline quint32 botanHMacKeyLen(const QByteArray &rfcAlgoName)
 {
-    Q_ASSERT(rfcAlgoName == SshCapabilities::HMacSha1);
-    Q_UNUSED(rfcAlgoName);
+    const QByteArray hashName = botanHMacAlgoName(rfcAlgoName);
+    if (hashName == "SHA-256")
+        return 32;
+    if (hashName == "SHA-512")
+        return 64;
     return 20;
 }
 
+// With encrypt-then-MAC, the length field is sent in the clear and the MAC
+// is computed over the encrypted packet.
+inline bool isEncryptThenMacAlgo(const QByteArray &rfcAlgoName)
+{
+    return rfcAlgoName == SshCapabilities::HMacSha1Etm
+        || rfcAlgoName == SshCapabilities::HMacSha256Etm
+        || rfcAlgoName == SshCapabilities::HMacSha512Etm;
+}
+
 } // namespace Internal
 } // namespace QSsh
 
@@ -52,31 +52,60 @@ namespace {
 
 const QByteArray SshCapabilities::DiffieHellmanGroup1Sha1("diffie-hellman-group1-sha1");
 const QByteArray SshCapabilities::DiffieHellmanGroup14Sha1("diffie-hellman-group14-sha1");
+const QByteArray SshCapabilities::EcdhNistp256("ecdh-sha2-nistp256");
+const QByteArray SshCapabilities::Curve25519Sha256("curve25519-sha256");
+const QByteArray SshCapabilities::Curve25519Sha256LibSsh("curve25519-sha256@libssh.org");
 const QList<QByteArray> SshCapabilities::KeyExchangeMethods
-    = QList<QByteArray>() << SshCapabilities::DiffieHellmanGroup1Sha1
-          << SshCapabilities::DiffieHellmanGroup14Sha1;
+    = QList<QByteArray>() << SshCapabilities::Curve25519Sha256
+          << SshCapabilities::Curve25519Sha256LibSsh
+          << SshCapabilities::EcdhNistp256
+          << SshCapabilities::DiffieHellmanGroup14Sha1
+          << SshCapabilities::DiffieHellmanGroup1Sha1;
 
 const QByteArray SshCapabilities::PubKeyDss("ssh-dss");
 const QByteArray SshCapabilities::PubKeyRsa("ssh-rsa");
+const QByteArray SshCapabilities::PubKeyEd25519("ssh-ed25519");
+const QByteArray SshCapabilities::PubKeyEcdsaNistp256("ecdsa-sha2-nistp256");
 const QList<QByteArray> SshCapabilities::PublicKeyAlgorithms
-    = QList<QByteArray>() << SshCapabilities::PubKeyRsa
+    = QList<QByteArray>() << SshCapabilities::PubKeyEd25519
+          << SshCapabilities::PubKeyEcdsaNistp256
+          << SshCapabilities::PubKeyRsa
           << SshCapabilities::PubKeyDss;
 
 const QByteArray SshCapabilities::CryptAlgo3Des("3des-cbc");
 const QByteArray SshCapabilities::CryptAlgoAes128("aes128-cbc");
 const QByteArray SshCapabilities::CryptAlgoAes128ctr("aes128-ctr");
+const QByteArray SshCapabilities::CryptAlgoAes128Gcm("aes128-gcm@openssh.com");
+const QByteArray SshCapabilities::CryptAlgoAes256Gcm("aes256-gcm@openssh.com");
+const QByteArray SshCapabilities::CryptAlgoChaCha20Poly1305("chacha20-poly1305@openssh.com");
 const QList<QByteArray> SshCapabilities::EncryptionAlgorithms
-    = QList<QByteArray>() << SshCapabilities::CryptAlgoAes128
+    = QList<QByteArray>() << SshCapabilities::CryptAlgoAes128Gcm
+          << SshCapabilities::CryptAlgoAes256Gcm
+          << SshCapabilities::CryptAlgoChaCha20Poly1305
+          << SshCapabilities::CryptAlgoAes128
           << SshCapabilities::CryptAlgo3Des << SshCapabilities::CryptAlgoAes128ctr;
 
 const QByteArray SshCapabilities::HMacSha1("hmac-sha1");
 const QByteArray SshCapabilities::HMacSha196("hmac-sha1-96");
+const QByteArray SshCapabilities::HMacSha256("hmac-sha2-256");
+const QByteArray SshCapabilities::HMacSha512("hmac-sha2-512");
+const QByteArray SshCapabilities::HMacSha1Etm("hmac-sha1-etm@openssh.com");
+const QByteArray SshCapabilities::HMacSha256Etm("hmac-sha2-256-etm@openssh.com");
+const QByteArray SshCapabilities::HMacSha512Etm("hmac-sha2-512-etm@openssh.com");
 const QList<QByteArray> SshCapabilities::MacAlgorithms
-    = QList<QByteArray>() /* << SshCapabilities::HMacSha196 */
+    = QList<QByteArray>() << SshCapabilities::HMacSha256Etm
+        << SshCapabilities::HMacSha512Etm << SshCapabilities::HMacSha1Etm
+        << SshCapabilities::HMacSha256 << SshCapabilities::HMacSha512
+        /* << SshCapabilities::HMacSha196 */
         << SshCapabilities::HMacSha1;
 
+const QByteArray SshCapabilities::CompressionNone("none");
+const QByteArray SshCapabilities::CompressionZlibOpenSsh("zlib@openssh.com");
 const QList<QByteArray> SshCapabilities::CompressionAlgorithms
-    = QList<QByteArray>() << "none";
+    = QList<QByteArray>() << SshCapabilities::CompressionNone;
+const QList<QByteArray> SshCapabilities::CompressionAlgorithmsWithZlib
+    = QList<QByteArray>() << SshCapabilities::CompressionZlibOpenSsh
+          << SshCapabilities::CompressionNone;
 
 const QByteArray SshCapabilities::SshConnectionService("ssh-connection");
 
@@ -42,22 +42,38 @@ class SshCapabilities
 public:
     static const QByteArray DiffieHellmanGroup1Sha1;
     static const QByteArray DiffieHellmanGroup14Sha1;
+    static const QByteArray EcdhNistp256;
+    static const QByteArray Curve25519Sha256;
+    static const QByteArray Curve25519Sha256LibSsh;
     static const QList<QByteArray> KeyExchangeMethods;
 
     static const QByteArray PubKeyDss;
     static const QByteArray PubKeyRsa;
+    static const QByteArray PubKeyEd25519;
+    static const QByteArray PubKeyEcdsaNistp256;
     static const QList<QByteArray> PublicKeyAlgorithms;
 
     static const QByteArray CryptAlgo3Des;
     static const QByteArray CryptAlgoAes128;
     static const QByteArray CryptAlgoAes128ctr;
+    static const QByteArray CryptAlgoAes128Gcm;
+    static const QByteArray CryptAlgoAes256Gcm;
+    static const QByteArray CryptAlgoChaCha20Poly1305;
     static const QList<QByteArray> EncryptionAlgorithms;
 
     static const QByteArray HMacSha1;
     static const QByteArray HMacSha196;
+    static const QByteArray HMacSha256;
+    static const QByteArray HMacSha512;
+    static const QByteArray HMacSha1Etm;
+    static const QByteArray HMacSha256Etm;
+    static const QByteArray HMacSha512Etm;
     static const QList<QByteArray> MacAlgorithms;
 
+    static const QByteArray CompressionNone;
+    static const QByteArray CompressionZlibOpenSsh;
     static const QList<QByteArray> CompressionAlgorithms;
+    static const QList<QByteArray> CompressionAlgorithmsWithZlib;
 
     static const QByteArray SshConnectionService;
 
@@ -35,27 +35,23 @@
 
 #include <botan/exceptn.h>
 
-#include <QTimer>
-
 namespace QSsh {
 namespace Internal {
 
 namespace {
     const quint32 MinMaxPacketSize = 32768;
     const quint32 MaxPacketSize = 16 * 1024 * 1024;
-    const quint32 InitialWindowSize = MaxPacketSize;
     const quint32 NoChannel = 0xffffffffu;
 } // anonymous namespace
 
 AbstractSshChannel::AbstractSshChannel(quint32 channelId,
     SshSendFacility &sendFacility)
-    : m_sendFacility(sendFacility), m_timeoutTimer(new QTimer(this)),
-      m_localChannel(channelId), m_remoteChannel(NoChannel),
-      m_localWindowSize(InitialWindowSize), m_remoteWindowSize(0),
-      m_state(Inactive)
+    : m_sendFacility(sendFacility), m_timeoutTimer(this, "timeout"),
+      m_localChannel(channelId), m_remoteChannel(NoChannel), m_openRequestTime(0),
+      m_remoteWindowSize(0), m_remoteMaxPacketSize(0), m_state(Inactive), m_bytesInSocket(0), m_highWaterMark(0),
+      m_readBufferSize(0), m_scheduler(0), m_priority(1)
 {
-    m_timeoutTimer->setSingleShot(true);
-    connect(m_timeoutTimer, SIGNAL(timeout()), this, SIGNAL(timeout()));
+    m_clock.start();
 }
 
 AbstractSshChannel::~AbstractSshChannel()
@@ -66,8 +62,50 @@ AbstractSshChannel::~AbstractSshChannel()
 void AbstractSshChannel::setChannelState(ChannelState state)
 {
     m_state = state;
-    if (state == Closed)
+    if (state == Closed) {
+        m_localWindow.close();
         closeHook();
+    }
+}
+
+void AbstractSshChannel::setReceiveWindowBudget(SshReceiveWindowBudget *budget)
+{
+    if (!budget)
+        m_localWindow.close();
+    m_localWindow.setBudget(budget);
+}
+
+void AbstractSshChannel::shrinkIdleReceiveWindow()
+{
+    m_localWindow.shrinkIfIdle(m_clock.elapsed());
+}
+
+void AbstractSshChannel::setReadBufferSize(qint64 size)
+{
+    m_readBufferSize = qMax<qint64>(size, 0);
+    m_localWindow.setMaxSize(m_readBufferSize > 0
+        ? quint32(qMin<qint64>(m_readBufferSize, SshReceiveWindow::MaxSize))
+        : SshReceiveWindow::MaxSize);
+
+    // Whatever is still buffered does not count anymore.
+    if (m_readBufferSize == 0)
+        handleDataConsumed(m_localWindow.unconsumed());
+}
+
+void AbstractSshChannel::handleDataConsumed(qint64 bytes)
+{
+    // There can't be more unconsumed data than fits into the window.
+    bytes = qMin<qint64>(bytes, m_localWindow.unconsumed());
+    if (bytes == 0)
+        return;
+    try {
+        const quint32 bytesToAdd = m_localWindow.consume(bytes, m_clock.elapsed());
+        if (bytesToAdd > 0)
+            m_sendFacility.sendWindowAdjustPacket(m_remoteChannel, bytesToAdd);
+    }  catch (Botan::Exception &e) {
+        qDebug("Botan error: %s", e.what());
+        closeChannel();
+    }
 }
 
 void AbstractSshChannel::requestSessionStart()
@@ -77,10 +115,11 @@ void AbstractSshChannel::requestSessionStart()
     // with our cryptography stuff, it would have hit us before, on
     // establishing the connection.
     try {
-        m_sendFacility.sendSessionPacket(m_localChannel, InitialWindowSize,
-            MaxPacketSize);
+        m_openRequestTime = m_clock.elapsed();
+        m_sendFacility.sendSessionPacket(m_localChannel,
+            m_localWindow.open(m_openRequestTime), MaxPacketSize);
         setChannelState(SessionRequested);
-        m_timeoutTimer->start(ReplyTimeout);
+        m_timeoutTimer.start(ReplyTimeout);
     }  catch (Botan::Exception &e) {
         qDebug("Botan error: %s", e.what());
         closeChannel();
@@ -90,7 +129,7 @@ void AbstractSshChannel::requestSessionStart()
 void AbstractSshChannel::sendData(const QByteArray &data)
 {
     try {
-        m_sendBuffer += data;
+        m_sendBuffer.append(data);
         flushSendBuffer();
     }  catch (Botan::Exception &e) {
         qDebug("Botan error: %s", e.what());
@@ -114,16 +153,62 @@ void AbstractSshChannel::handleWindowAdjust(quint32 bytesToAdd)
 
 void AbstractSshChannel::flushSendBuffer()
 {
-    while (true) {
-        const quint32 bytesToSend = qMin(m_remoteMaxPacketSize,
-                qMin<quint32>(m_remoteWindowSize, m_sendBuffer.size()));
-        if (bytesToSend == 0)
+    if (nextPacketSize() == 0)
+        return;
+    if (m_scheduler) {
+        m_scheduler->schedule(this);
+        emit dataScheduled();
+        return;
+    }
+
+    SshSendFacilityCork cork(m_sendFacility);
+    while (const quint32 bytesToSend = nextPacketSize())
+        sendNextPacket(bytesToSend);
+}
+
+quint32 AbstractSshChannel::nextPacketSize() const
+{
+    if (m_state != SessionEstablished)
+        return 0;
+    return qMin<qint64>(m_remoteMaxPacketSize,
+        qMin<qint64>(m_remoteWindowSize, m_sendBuffer.size()));
+}
+
+void AbstractSshChannel::sendNextPacket(quint32 size)
+{
+    Q_ASSERT(size > 0 && size <= nextPacketSize());
+    m_sendFacility.sendChannelDataPacket(m_remoteChannel, m_sendBuffer.take(size));
+    m_remoteWindowSize -= size;
+    const SocketWrite write = { m_sendFacility.lastPacketEndPosition(), size };
+    m_socketWrites << write;
+    m_bytesInSocket += size;
+}
+
+qint64 AbstractSshChannel::writeBufferSpace(qint64 wanted) const
+{
+    if (m_highWaterMark <= 0)
+        return wanted;
+    return qBound<qint64>(0, m_highWaterMark - bytesToWrite(), wanted);
+}
+
+void AbstractSshChannel::handleSocketBytesWritten()
+{
+    qint64 writtenBytes = 0;
+    while (!m_socketWrites.isEmpty()) {
+        SocketWrite &write = m_socketWrites.first();
+        if (write.endPosition == SshSendFacility::HeldBackPosition) {
+            if (m_sendFacility.hasHeldBackPackets())
+                break;
+            write.endPosition = m_sendFacility.heldBackEndPosition();
+        }
+        if (write.endPosition > m_sendFacility.bytesWritten())
             break;
-        const QByteArray &data = m_sendBuffer.left(bytesToSend);
-        m_sendFacility.sendChannelDataPacket(m_remoteChannel, data);
-        m_sendBuffer.remove(0, bytesToSend);
-        m_remoteWindowSize -= bytesToSend;
+        writtenBytes += m_socketWrites.takeFirst().bytes;
     }
+    if (writtenBytes == 0)
+        return;
+    m_bytesInSocket -= writtenBytes;
+    emit bytesWritten(writtenBytes);
 }
 
 void AbstractSshChannel::handleOpenSuccess(quint32 remoteChannelId,
@@ -133,7 +218,7 @@ void AbstractSshChannel::handleOpenSuccess(quint32 remoteChannelId,
        throw SSH_SERVER_EXCEPTION(SSH_DISCONNECT_PROTOCOL_ERROR,
            "Invalid SSH_MSG_CHANNEL_OPEN_CONFIRMATION packet.");
    }
-    m_timeoutTimer->stop();
+    m_timeoutTimer.stop();
 
    if (remoteMaxPacketSize < MinMaxPacketSize) {
        throw SSH_SERVER_EXCEPTION(SSH_DISCONNECT_PROTOCOL_ERROR,
@@ -147,6 +232,8 @@ void AbstractSshChannel::handleOpenSuccess(quint32 remoteChannelId,
 #endif
    m_remoteChannel = remoteChannelId;
    m_remoteWindowSize = remoteWindowSize;
+   if (m_localWindow.budget())
+       m_localWindow.budget()->addRoundTripTimeSample(m_clock.elapsed() - m_openRequestTime);
    m_remoteMaxPacketSize = remoteMaxPacketSize - sizeof(quint32) - sizeof m_remoteChannel - 1;
         // Original value includes packet type, channel number and length field for string.
    setChannelState(SessionEstablished);
@@ -159,7 +246,7 @@ void AbstractSshChannel::handleOpenFailure(const QString &reason)
        throw SSH_SERVER_EXCEPTION(SSH_DISCONNECT_PROTOCOL_ERROR,
            "Invalid SSH_MSG_CHANNEL_OPEN_FAILURE packet.");
    }
-    m_timeoutTimer->stop();
+    m_timeoutTimer.stop();
 
 #ifdef CREATOR_SSH_DEBUG
    qDebug("Channel open request failed for channel %u", m_localChannel);
@@ -173,7 +260,7 @@ void AbstractSshChannel::handleChannelEof()
         throw SSH_SERVER_EXCEPTION(SSH_DISCONNECT_PROTOCOL_ERROR,
             "Unexpected SSH_MSG_CHANNEL_EOF message.");
     }
-    m_localWindowSize = 0;
+    m_localWindow.close();
 }
 
 void AbstractSshChannel::handleChannelClose()
@@ -223,23 +310,25 @@ int AbstractSshChannel::handleChannelOrExtendedChannelData(const QByteArray &dat
     if (bytesToDeliver != data.size())
         qWarning("Misbehaving server does not respect local window, clipping.");
 
-    m_localWindowSize -= bytesToDeliver;
-    if (m_localWindowSize < MaxPacketSize) {
-        m_localWindowSize += MaxPacketSize;
-        m_sendFacility.sendWindowAdjustPacket(m_remoteChannel,
-            MaxPacketSize);
-    }
+    m_localWindow.receive(bytesToDeliver);
+    if (m_readBufferSize == 0)
+        handleDataConsumed(bytesToDeliver);
     return bytesToDeliver;
 }
 
 void AbstractSshChannel::closeChannel()
 {
     if (m_state == CloseRequested) {
-        m_timeoutTimer->stop();
+        m_timeoutTimer.stop();
     } else if (m_state != Closed) {
         if (m_state == Inactive) {
             setChannelState(Closed);
         } else {
+            // Whatever the scheduler has not got around to yet must precede the EOF.
+            if (m_scheduler)
+                m_scheduler->remove(this);
+            while (const quint32 bytesToSend = nextPacketSize())
+                sendNextPacket(bytesToSend);
             setChannelState(CloseRequested);
             m_sendFacility.sendChannelEofPacket(m_remoteChannel);
             m_sendFacility.sendChannelClosePacket(m_remoteChannel);
@@ -256,7 +345,7 @@ void AbstractSshChannel::checkChannelActive()
 
 quint32 AbstractSshChannel::maxDataSize() const
 {
-    return qMin(m_localWindowSize, MaxPacketSize);
+    return qMin(m_localWindow.remaining(), MaxPacketSize);
 }
 
 } // namespace Internal
@@ -31,12 +31,17 @@
 #ifndef SSHCHANNEL_P_H
 #define SSHCHANNEL_P_H
 
+#include "sshchannelscheduler_p.h"
+#include "sshreceivewindow_p.h"
+#include "sshsendqueue_p.h"
+#include "sshtimerwheel_p.h"
+
 #include <QByteArray>
+#include <QElapsedTimer>
+#include <QList>
 #include <QObject>
 #include <QString>
 
-QT_FORWARD_DECLARE_CLASS(QTimer)
-
 namespace QSsh {
 namespace Internal {
 
@@ -45,7 +50,7 @@ struct SshChannelExitStatus;
 class SshIncomingPacket;
 class SshSendFacility;
 
-class AbstractSshChannel : public QObject
+class AbstractSshChannel : public QObject, public SshSchedulableChannel
 {
     Q_OBJECT
 public:
@@ -78,20 +83,52 @@ public:
     void sendData(const QByteArray &data);
     void closeChannel();
 
+    // Set by the channel manager; 0 detaches the channel from the connection.
+    void setReceiveWindowBudget(SshReceiveWindowBudget *budget);
+    void shrinkIdleReceiveWindow();
+
+    // Data passed to sendData() that has not been written to the network yet,
+    // i.e. what is still in the send buffer plus this channel's share of what
+    // is waiting in the socket. A high-water mark of 0 means "unlimited".
+    qint64 bytesToWrite() const { return m_sendBuffer.size() + m_bytesInSocket; }
+    qint64 writeBufferHighWaterMark() const { return m_highWaterMark; }
+    void setWriteBufferHighWaterMark(qint64 bytes) { m_highWaterMark = bytes; }
+    qint64 writeBufferSpace(qint64 wanted) const;
+    void handleSocketBytesWritten();
+
+    // With a read buffer size of 0 (the default), received data counts as consumed
+    // right away. Otherwise, the window is reopened only as handleDataConsumed() is
+    // called, so that the peer can never get more than that far ahead of the reader.
+    qint64 readBufferSize() const { return m_readBufferSize; }
+    void setReadBufferSize(qint64 size);
+    void handleDataConsumed(qint64 bytes);
+
+    // Set by the channel manager. Without a scheduler, data is sent right away.
+    void setScheduler(SshChannelScheduler *scheduler) { m_scheduler = scheduler; }
+    void setPriority(int priority) { m_priority = qMax(priority, 1); }
+    int priority() const { return m_priority; }
+    quint32 nextPacketSize() const;
+    void sendNextPacket(quint32 size);
+
     virtual ~AbstractSshChannel();
 
     static const int ReplyTimeout = 10000; // milli seconds
 
 signals:
     void timeout();
+    void bytesWritten(qint64 bytes);
+    void dataScheduled();
 protected:
     AbstractSshChannel(quint32 channelId, SshSendFacility &sendFacility);
 
     quint32 maxDataSize() const;
     void checkChannelActive();
 
+    // The most data that fits into one SSH_MSG_CHANNEL_DATA packet to the peer.
+    quint32 remoteMaxDataSize() const { return m_remoteMaxPacketSize; }
+
     SshSendFacility &m_sendFacility;
-    QTimer * const m_timeoutTimer;
+    SshTimer m_timeoutTimer;
 
 private:
     virtual void handleOpenSuccessInternal() = 0;
@@ -108,11 +145,26 @@ private:
 
     const quint32 m_localChannel;
     quint32 m_remoteChannel;
-    quint32 m_localWindowSize;
+    SshReceiveWindow m_localWindow;
+    QElapsedTimer m_clock;
+    qint64 m_openRequestTime;
     quint32 m_remoteWindowSize;
     quint32 m_remoteMaxPacketSize;
     ChannelState m_state;
-    QByteArray m_sendBuffer;
+    SshSendQueue m_sendBuffer;
+
+    // Channel data packets that are still in the socket, in the order written.
+    struct SocketWrite
+    {
+        quint64 endPosition; // See SshSendFacility::lastPacketEndPosition().
+        qint64 bytes;
+    };
+    QList<SocketWrite> m_socketWrites;
+    qint64 m_bytesInSocket;
+    qint64 m_highWaterMark;
+    qint64 m_readBufferSize;
+    SshChannelScheduler *m_scheduler;
+    int m_priority;
 };
 
 } // namespace Internal
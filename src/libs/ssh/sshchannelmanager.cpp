@@ -42,10 +42,26 @@
 namespace QSsh {
 namespace Internal {
 
+namespace {
+    // The scheduler only decides about what goes into the socket, so keep the
+    // socket's own queue short, but long enough to keep the network busy.
+    const qint64 ScheduledBytesInSocket = 128 * 1024;
+} // anonymous namespace
+
 SshChannelManager::SshChannelManager(SshSendFacility &sendFacility,
-    QObject *parent)
-    : QObject(parent), m_sendFacility(sendFacility), m_nextLocalChannelId(0)
+    quint64 receiveWindowLimit, QObject *parent)
+    : QObject(parent), m_sendFacility(sendFacility), m_nextLocalChannelId(0),
+      m_lastChannel(0), m_receiveWindowBudget(receiveWindowLimit),
+      m_idleTimer(this, "shrinkIdleReceiveWindows")
+{
+    m_idleTimer.start(2000);
+}
+
+SshChannelManager::~SshChannelManager()
 {
+    // The channels can outlive us, as the user holds references to them.
+    for (ChannelIterator it = m_channels.begin(); it != m_channels.end(); ++it)
+        detachChannel(it.value());
 }
 
 void SshChannelManager::handleChannelRequest(const SshIncomingPacket &packet)
@@ -128,6 +144,44 @@ void SshChannelManager::handleChannelClose(const SshIncomingPacket &packet)
     }
 }
 
+void SshChannelManager::addRoundTripTimeSample(int msecs)
+{
+    m_receiveWindowBudget.addRoundTripTimeSample(msecs);
+}
+
+void SshChannelManager::sendScheduledData()
+{
+    // Packets sent now would only be held back until the new keys are in place.
+    if (m_scheduler.isEmpty() || m_sendFacility.isKeyExchangeInProgress())
+        return;
+    const qint64 room = ScheduledBytesInSocket - m_sendFacility.bytesToWrite();
+    if (room <= 0)
+        return;
+    SshSendFacilityCork cork(m_sendFacility);
+    m_scheduler.run(room);
+    emit scheduledDataSent();
+}
+
+void SshChannelManager::handleSocketBytesWritten()
+{
+    sendScheduledData();
+
+    // Channels can go away in reaction to the signals emitted here.
+    const QList<quint32> channelIds = m_channels.keys();
+    foreach (const quint32 channelId, channelIds) {
+        const ChannelIterator it = m_channels.find(channelId);
+        if (it != m_channels.end())
+            it.value()->handleSocketBytesWritten();
+    }
+}
+
+void SshChannelManager::shrinkIdleReceiveWindows()
+{
+    for (ChannelIterator it = m_channels.begin(); it != m_channels.end(); ++it)
+        it.value()->shrinkIdleReceiveWindow();
+    m_idleTimer.start();
+}
+
 SshChannelManager::ChannelIterator SshChannelManager::lookupChannelAsIterator(quint32 channelId,
     bool allowNotFound)
 {
@@ -143,8 +197,13 @@ SshChannelManager::ChannelIterator SshChannelManager::lookupChannelAsIterator(qu
 AbstractSshChannel *SshChannelManager::lookupChannel(quint32 channelId,
     bool allowNotFound)
 {
+    if (m_lastChannel && m_lastChannel->localChannelId() == channelId)
+        return m_lastChannel;
     ChannelIterator it = lookupChannelAsIterator(channelId, allowNotFound);
-    return it == m_channels.end() ? 0 : it.value();
+    if (it == m_channels.end())
+        return 0;
+    m_lastChannel = it.value();
+    return m_lastChannel;
 }
 
 QSsh::SshRemoteProcess::Ptr SshChannelManager::createRemoteProcess(const QByteArray &command)
@@ -172,6 +231,9 @@ void SshChannelManager::insertChannel(AbstractSshChannel *priv,
     const QSharedPointer<QObject> &pub)
 {
     connect(priv, SIGNAL(timeout()), this, SIGNAL(timeout()));
+    connect(priv, SIGNAL(dataScheduled()), this, SLOT(sendScheduledData()));
+    priv->setReceiveWindowBudget(&m_receiveWindowBudget);
+    priv->setScheduler(&m_scheduler);
     m_channels.insert(priv->localChannelId(), priv);
     m_sessions.insert(priv, pub);
 }
@@ -182,6 +244,9 @@ int SshChannelManager::closeAllChannels(CloseAllMode mode)
     for (ChannelIterator it = m_channels.begin(); it != m_channels.end(); ++it)
         it.value()->closeChannel();
     if (mode == CloseAllAndReset) {
+        for (ChannelIterator it = m_channels.begin(); it != m_channels.end(); ++it)
+            detachChannel(it.value());
+        m_lastChannel = 0;
         m_channels.clear();
         m_sessions.clear();
     }
@@ -198,8 +263,18 @@ void SshChannelManager::removeChannel(ChannelIterator it)
     Q_ASSERT(it != m_channels.end() && "Unexpected channel lookup failure.");
     const int removeCount = m_sessions.remove(it.value());
     Q_ASSERT(removeCount == 1 && "Session for channel not found.");
+    if (it.value() == m_lastChannel)
+        m_lastChannel = 0;
+    detachChannel(it.value());
     m_channels.erase(it);
 }
 
+void SshChannelManager::detachChannel(AbstractSshChannel *channel)
+{
+    channel->setReceiveWindowBudget(0);
+    m_scheduler.remove(channel);
+    channel->setScheduler(0);
+}
+
 } // namespace Internal
 } // namespace QSsh
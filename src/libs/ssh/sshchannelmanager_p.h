@@ -31,6 +31,10 @@
 #ifndef SSHCHANNELLAYER_P_H
 #define SSHCHANNELLAYER_P_H
 
+#include "sshchannelscheduler_p.h"
+#include "sshreceivewindow_p.h"
+#include "sshtimerwheel_p.h"
+
 #include <QHash>
 #include <QObject>
 #include <QSharedPointer>
@@ -50,7 +54,9 @@ class SshChannelManager : public QObject
 {
     Q_OBJECT
 public:
-    SshChannelManager(SshSendFacility &sendFacility, QObject *parent);
+    SshChannelManager(SshSendFacility &sendFacility, quint64 receiveWindowLimit,
+        QObject *parent);
+    ~SshChannelManager();
 
     QSharedPointer<SshRemoteProcess> createRemoteProcess(const QByteArray &command);
     QSharedPointer<SshRemoteProcess> createRemoteShell();
@@ -72,10 +78,17 @@ public:
     void handleChannelEof(const SshIncomingPacket &packet);
     void handleChannelClose(const SshIncomingPacket &packet);
 
+    void addRoundTripTimeSample(int msecs);
+    void handleSocketBytesWritten();
+    Q_SLOT void sendScheduledData();
+
 signals:
     void timeout();
+    void scheduledDataSent();
 
 private:
+    Q_SLOT void shrinkIdleReceiveWindows();
+
     typedef QHash<quint32, AbstractSshChannel *>::Iterator ChannelIterator;
 
     ChannelIterator lookupChannelAsIterator(quint32 channelId,
@@ -83,6 +96,7 @@ private:
     AbstractSshChannel *lookupChannel(quint32 channelId,
         bool allowNotFound = false);
     void removeChannel(ChannelIterator it);
+    void detachChannel(AbstractSshChannel *channel);
     void insertChannel(AbstractSshChannel *priv,
         const QSharedPointer<QObject> &pub);
 
@@ -90,6 +104,13 @@ private:
     QHash<quint32, AbstractSshChannel *> m_channels;
     QHash<AbstractSshChannel *, QSharedPointer<QObject> > m_sessions;
     quint32 m_nextLocalChannelId;
+
+    // Almost all packets on a busy connection are for the same channel.
+    AbstractSshChannel *m_lastChannel;
+
+    SshReceiveWindowBudget m_receiveWindowBudget;
+    SshTimer m_idleTimer;
+    SshChannelScheduler m_scheduler;
 };
 
 } // namespace Internal
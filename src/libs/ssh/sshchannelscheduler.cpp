@@ -0,0 +1,93 @@
+/**************************************************************************
+**
+** This file is part of Qt Creator
+**
+** Copyright (c) 2012 Nokia Corporation and/or its subsidiary(-ies).
+**
+** Contact: http://www.qt-project.org/
+**
+**
+** GNU Lesser General Public License Usage
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.LGPL included in the packaging of this file.
+** Please review the following information to ensure the GNU Lesser General
+** Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights. These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** Other Usage
+**
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and Nokia.
+**
+**
+**************************************************************************/
+
+#include "sshchannelscheduler_p.h"
+
+namespace QSsh {
+namespace Internal {
+
+const quint32 SshChannelScheduler::Quantum;
+
+SshChannelScheduler::SshChannelScheduler() : m_headHasQuantum(false)
+{
+}
+
+void SshChannelScheduler::schedule(SshSchedulableChannel *channel)
+{
+    for (int i = 0; i < m_channels.count(); ++i) {
+        if (m_channels.at(i).channel == channel)
+            return;
+    }
+    const ScheduledChannel scheduledChannel = { channel, 0 };
+    m_channels << scheduledChannel;
+}
+
+void SshChannelScheduler::remove(SshSchedulableChannel *channel)
+{
+    for (int i = 0; i < m_channels.count(); ++i) {
+        if (m_channels.at(i).channel == channel) {
+            if (i == 0)
+                m_headHasQuantum = false;
+            m_channels.removeAt(i);
+            return;
+        }
+    }
+}
+
+qint64 SshChannelScheduler::run(qint64 maxBytes)
+{
+    qint64 bytesSent = 0;
+    while (bytesSent < maxBytes && !m_channels.isEmpty()) {
+        ScheduledChannel &head = m_channels.first();
+        const quint32 packetSize = head.channel->nextPacketSize();
+        if (packetSize == 0) {
+            // Nothing to send or no window; the channel schedules itself again.
+            m_channels.removeFirst();
+            m_headHasQuantum = false;
+            continue;
+        }
+        if (!m_headHasQuantum) {
+            head.deficit += quint64(Quantum) * qMax(head.channel->priority(), 1);
+            m_headHasQuantum = true;
+        }
+        if (packetSize > head.deficit) {
+            m_channels.append(m_channels.takeFirst());
+            m_headHasQuantum = false;
+            continue;
+        }
+        head.deficit -= packetSize;
+        head.channel->sendNextPacket(packetSize);
+        bytesSent += packetSize;
+    }
+    return bytesSent;
+}
+
+} // namespace Internal
+} // namespace QSsh
@@ -0,0 +1,87 @@
+/**************************************************************************
+**
+** This file is part of Qt Creator
+**
+** Copyright (c) 2012 Nokia Corporation and/or its subsidiary(-ies).
+**
+** Contact: http://www.qt-project.org/
+**
+**
+** GNU Lesser General Public License Usage
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.LGPL included in the packaging of this file.
+** Please review the following information to ensure the GNU Lesser General
+** Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights. These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** Other Usage
+**
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and Nokia.
+**
+**
+**************************************************************************/
+
+#ifndef SSHCHANNELSCHEDULER_P_H
+#define SSHCHANNELSCHEDULER_P_H
+
+#include <QList>
+
+namespace QSsh {
+namespace Internal {
+
+class SshSchedulableChannel
+{
+public:
+    // Size of the next data packet the channel can send right now, 0 if none.
+    virtual quint32 nextPacketSize() const = 0;
+    virtual void sendNextPacket(quint32 size) = 0;
+    virtual int priority() const = 0;
+
+protected:
+    ~SshSchedulableChannel() {}
+};
+
+/*
+ * Decides which channel gets to send next when several of them have data
+ * (deficit round robin). Every channel with data gets a quantum proportional
+ * to its priority per round and sends packets as long as it has quantum left,
+ * so a bulk transfer cannot delay a channel with a few bytes to send by more
+ * than one round. The caller limits how much is sent at a time, so that the
+ * decision is not left to the socket's write buffer.
+ */
+class SshChannelScheduler
+{
+public:
+    SshChannelScheduler();
+
+    void schedule(SshSchedulableChannel *channel);
+    void remove(SshSchedulableChannel *channel);
+    bool isEmpty() const { return m_channels.isEmpty(); }
+
+    // Sends packets until at least maxBytes have been sent or no scheduled
+    // channel can send anymore. Returns the number of bytes sent.
+    qint64 run(qint64 maxBytes);
+
+    static const quint32 Quantum = 32 * 1024;
+
+private:
+    struct ScheduledChannel
+    {
+        SshSchedulableChannel *channel;
+        quint64 deficit;
+    };
+    QList<ScheduledChannel> m_channels;
+    bool m_headHasQuantum; // The first channel has already got its quantum in this round.
+};
+
+} // namespace Internal
+} // namespace QSsh
+
+#endif // SSHCHANNELSCHEDULER_P_H
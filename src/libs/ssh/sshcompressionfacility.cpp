@@ -0,0 +1,207 @@
+/**************************************************************************
+**
+** This file is part of Qt Creator
+**
+** Copyright (c) 2012 Nokia Corporation and/or its subsidiary(-ies).
+**
+** Contact: http://www.qt-project.org/
+**
+**
+** GNU Lesser General Public License Usage
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.LGPL included in the packaging of this file.
+** Please review the following information to ensure the GNU Lesser General
+** Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights. These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** Other Usage
+**
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and Nokia.
+**
+**
+**************************************************************************/
+
+#include "sshcompressionfacility_p.h"
+
+#include "sshcapabilities_p.h"
+#include "sshexception_p.h"
+
+#include <zlib.h>
+
+#include <cstring>
+
+namespace QSsh {
+namespace Internal {
+
+namespace {
+
+const int MinChunkSize = 4096;
+
+// More than any packet the server may send us, including channel data
+// packets of AbstractSshChannel::MaxPacketSize.
+const int MaxDecompressedSize = 0x1000000 + 0x10000;
+
+} // anonymous namespace
+
+struct SshZlibStream
+{
+    z_stream zs;
+};
+
+SshAbstractCompressionFacility::SshAbstractCompressionFacility()
+    : m_zlibNegotiated(false), m_authenticated(false)
+{
+}
+
+SshAbstractCompressionFacility::~SshAbstractCompressionFacility()
+{
+    // Derived classes must call reset(), as endStream() is not available here.
+    Q_ASSERT(!m_stream);
+}
+
+void SshAbstractCompressionFacility::setAlgorithm(const QByteArray &rfcAlgoName)
+{
+    m_zlibNegotiated = rfcAlgoName == SshCapabilities::CompressionZlibOpenSsh;
+
+    // Every key exchange starts a new compression context.
+    stop();
+    if (m_zlibNegotiated && m_authenticated)
+        start();
+}
+
+void SshAbstractCompressionFacility::setAuthenticated()
+{
+    m_authenticated = true;
+    if (m_zlibNegotiated && !m_stream)
+        start();
+}
+
+void SshAbstractCompressionFacility::reset()
+{
+    stop();
+    m_zlibNegotiated = false;
+    m_authenticated = false;
+    m_buffer.clear();
+}
+
+void SshAbstractCompressionFacility::start()
+{
+    m_stream.reset(new SshZlibStream);
+    std::memset(&m_stream->zs, 0, sizeof m_stream->zs);
+    if (!initStream(m_stream.data())) {
+        m_stream.reset();
+        throw SshClientException(SshInternalError,
+            SSH_TR("Failed to initialize zlib stream."));
+    }
+}
+
+void SshAbstractCompressionFacility::stop()
+{
+    if (m_stream) {
+        endStream(m_stream.data());
+        m_stream.reset();
+    }
+}
+
+
+SshCompressionFacility::~SshCompressionFacility()
+{
+    reset();
+}
+
+bool SshCompressionFacility::initStream(SshZlibStream *stream)
+{
+    return deflateInit(&stream->zs, Z_DEFAULT_COMPRESSION) == Z_OK;
+}
+
+void SshCompressionFacility::endStream(SshZlibStream *stream)
+{
+    deflateEnd(&stream->zs);
+}
+
+void SshCompressionFacility::compress(QByteArray &data, int offset)
+{
+    Q_ASSERT(isActive());
+
+    z_stream &zs = stream()->zs;
+    zs.next_in = reinterpret_cast<Bytef *>(data.data() + offset);
+    zs.avail_in = data.size() - offset;
+
+    // Each packet is flushed so that the server can decompress it on its own,
+    // but the dictionary is kept across packets.
+    m_buffer.resize(0);
+    do {
+        const int oldSize = m_buffer.size();
+        const int chunkSize = qMax<int>(MinChunkSize, zs.avail_in + zs.avail_in / 8);
+        m_buffer.resize(oldSize + chunkSize);
+        zs.next_out = reinterpret_cast<Bytef *>(m_buffer.data() + oldSize);
+        zs.avail_out = chunkSize;
+        const int status = deflate(&zs, Z_PARTIAL_FLUSH);
+        m_buffer.resize(m_buffer.size() - zs.avail_out);
+        if (status == Z_BUF_ERROR) // Nothing left to do.
+            break;
+        if (status != Z_OK) {
+            throw SshClientException(SshInternalError,
+                SSH_TR("Failed to compress packet."));
+        }
+    } while (zs.avail_out == 0);
+
+    data.resize(offset);
+    data.append(m_buffer);
+}
+
+
+SshDecompressionFacility::~SshDecompressionFacility()
+{
+    reset();
+}
+
+bool SshDecompressionFacility::initStream(SshZlibStream *stream)
+{
+    return inflateInit(&stream->zs) == Z_OK;
+}
+
+void SshDecompressionFacility::endStream(SshZlibStream *stream)
+{
+    inflateEnd(&stream->zs);
+}
+
+void SshDecompressionFacility::decompress(const char *data, int size, QByteArray &target)
+{
+    Q_ASSERT(isActive());
+
+    z_stream &zs = stream()->zs;
+    zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+    zs.avail_in = size;
+
+    const int startSize = target.size();
+    do {
+        const int oldSize = target.size();
+        if (oldSize - startSize > MaxDecompressedSize) {
+            throw SSH_SERVER_EXCEPTION(SSH_DISCONNECT_COMPRESSION_ERROR,
+                "Decompressed packet too large.");
+        }
+        const int chunkSize = qMax(MinChunkSize, 4 * static_cast<int>(zs.avail_in));
+        target.resize(oldSize + chunkSize);
+        zs.next_out = reinterpret_cast<Bytef *>(target.data() + oldSize);
+        zs.avail_out = chunkSize;
+        const int status = inflate(&zs, Z_PARTIAL_FLUSH);
+        target.resize(target.size() - zs.avail_out);
+        if (status == Z_BUF_ERROR) // Nothing left to do.
+            break;
+        if (status != Z_OK) {
+            throw SSH_SERVER_EXCEPTION(SSH_DISCONNECT_COMPRESSION_ERROR,
+                "Invalid compressed data.");
+        }
+    } while (zs.avail_out == 0);
+}
+
+} // namespace Internal
+} // namespace QSsh
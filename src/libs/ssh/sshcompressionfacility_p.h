@@ -0,0 +1,108 @@
+/**************************************************************************
+**
+** This file is part of Qt Creator
+**
+** Copyright (c) 2012 Nokia Corporation and/or its subsidiary(-ies).
+**
+** Contact: http://www.qt-project.org/
+**
+**
+** GNU Lesser General Public License Usage
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.LGPL included in the packaging of this file.
+** Please review the following information to ensure the GNU Lesser General
+** Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights. These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** Other Usage
+**
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and Nokia.
+**
+**
+**************************************************************************/
+
+#ifndef SSHCOMPRESSIONFACILITY_P_H
+#define SSHCOMPRESSIONFACILITY_P_H
+
+#include <QByteArray>
+#include <QScopedPointer>
+
+namespace QSsh {
+namespace Internal {
+
+struct SshZlibStream;
+
+/*
+ * zlib@openssh.com is "delayed" compression: Although negotiated during the
+ * key exchange, it only kicks in after the user has been authenticated,
+ * which is why the facility needs to know about both.
+ */
+class SshAbstractCompressionFacility
+{
+public:
+    virtual ~SshAbstractCompressionFacility();
+
+    void setAlgorithm(const QByteArray &rfcAlgoName); // After NEWKEYS.
+    void setAuthenticated();
+    void reset();
+
+    bool isActive() const { return !m_stream.isNull(); }
+
+protected:
+    SshAbstractCompressionFacility();
+
+    SshZlibStream *stream() const { return m_stream.data(); }
+    QByteArray m_buffer;
+
+private:
+    SshAbstractCompressionFacility(const SshAbstractCompressionFacility &);
+    SshAbstractCompressionFacility &operator=(const SshAbstractCompressionFacility &);
+
+    void start();
+    void stop();
+
+    virtual bool initStream(SshZlibStream *stream) = 0;
+    virtual void endStream(SshZlibStream *stream) = 0;
+
+    QScopedPointer<SshZlibStream> m_stream;
+    bool m_zlibNegotiated;
+    bool m_authenticated;
+};
+
+class SshCompressionFacility : public SshAbstractCompressionFacility
+{
+public:
+    ~SshCompressionFacility();
+
+    // Replaces everything in data after offset by its compressed form.
+    void compress(QByteArray &data, int offset);
+
+private:
+    virtual bool initStream(SshZlibStream *stream);
+    virtual void endStream(SshZlibStream *stream);
+};
+
+class SshDecompressionFacility : public SshAbstractCompressionFacility
+{
+public:
+    ~SshDecompressionFacility();
+
+    // Appends the decompressed data to target.
+    void decompress(const char *data, int size, QByteArray &target);
+
+private:
+    virtual bool initStream(SshZlibStream *stream);
+    virtual void endStream(SshZlibStream *stream);
+};
+
+} // namespace Internal
+} // namespace QSsh
+
+#endif // SSHCOMPRESSIONFACILITY_P_H
@@ -37,6 +37,7 @@
 #include "sshcryptofacility_p.h"
 #include "sshexception_p.h"
 #include "sshkeyexchange_p.h"
+#include "sshreceivewindow_p.h"
 
 #include <botan/init.h>
 
@@ -73,6 +74,7 @@ namespace {
             qRegisterMetaType<QSsh::SftpJobId>("QSsh::SftpJobId");
             qRegisterMetaType<QSsh::SftpFileInfo>("QSsh::SftpFileInfo");
             qRegisterMetaType<QList <QSsh::SftpFileInfo> >("QList<QSsh::SftpFileInfo>");
+            qRegisterMetaType<QList<QByteArray> >("QList<QByteArray>");
             staticInitializationsDone = true;
         }
     }
@@ -80,7 +82,9 @@ namespace {
 
 
 SshConnectionParameters::SshConnectionParameters() :
-    timeout(0),  authenticationType(AuthenticationByKey), port(0), proxyType(NoProxy)
+    timeout(0),  authenticationType(AuthenticationByKey), port(0), proxyType(NoProxy),
+    useCompression(false), rekeyAfterBytes(Q_UINT64_C(1) << 30), rekeyAfterSeconds(3600),
+    receiveWindowLimit(128 * 1024 * 1024)
 {
 }
 
@@ -90,7 +94,11 @@ static inline bool equals(const SshConnectionParameters &p1, const SshConnection
             && p1.authenticationType == p2.authenticationType
             && (p1.authenticationType == SshConnectionParameters::AuthenticationByPassword ?
                     p1.password == p2.password : p1.privateKeyFile == p2.privateKeyFile)
-            && p1.timeout == p2.timeout && p1.port == p2.port;
+            && p1.timeout == p2.timeout && p1.port == p2.port
+            && p1.useCompression == p2.useCompression
+            && p1.rekeyAfterBytes == p2.rekeyAfterBytes
+            && p1.rekeyAfterSeconds == p2.rekeyAfterSeconds
+            && p1.receiveWindowLimit == p2.receiveWindowLimit;
 }
 
 bool operator==(const SshConnectionParameters &p1, const SshConnectionParameters &p2)
@@ -207,24 +215,33 @@ int SshConnection::channelCount() const
     return d->m_channelManager->channelCount();
 }
 
+void SshConnection::setGlobalReceiveWindowLimit(quint64 bytes)
+{
+    Internal::SshReceiveWindowBudget::setGlobalLimit(bytes);
+}
+
 namespace Internal {
 
 SshConnectionPrivate::SshConnectionPrivate(SshConnection *conn,
     const SshConnectionParameters &serverInfo)
     : m_socket(new QTcpSocket(this)), m_state(SocketUnconnected),
       m_sendFacility(m_socket),
-      m_channelManager(new SshChannelManager(m_sendFacility, this)),
-      m_connParams(serverInfo), m_error(SshNoError), m_ignoreNextPacket(false),
+      m_channelManager(new SshChannelManager(m_sendFacility,
+          serverInfo.receiveWindowLimit, this)),
+      m_connParams(serverInfo), m_error(SshNoError), m_timeoutTimer(this, "handleTimeout"),
+      m_keepAliveTimer(this, "sendKeepAlivePacket"), m_rekeyTimer(this, "handleRekeyTimeout"),
+      m_bytesReceivedSinceKeyExchange(0), m_ignoreNextPacket(false),
       m_conn(conn)
 {
     setupPacketHandlers();
     m_socket->setProxy(m_connParams.proxyType == SshConnectionParameters::DefaultProxy
         ? QNetworkProxy::DefaultProxy : QNetworkProxy::NoProxy);
-    m_timeoutTimer.setSingleShot(true);
     m_timeoutTimer.setInterval(m_connParams.timeout * 1000);
-    m_keepAliveTimer.setSingleShot(true);
     m_keepAliveTimer.setInterval(10000);
+    m_rekeyTimer.setInterval(m_connParams.rekeyAfterSeconds * 1000);
     connect(m_channelManager, SIGNAL(timeout()), this, SLOT(handleTimeout()));
+    connect(m_channelManager, SIGNAL(scheduledDataSent()), this,
+        SLOT(handleScheduledDataSent()));
 }
 
 SshConnectionPrivate::~SshConnectionPrivate()
@@ -236,6 +253,11 @@ void SshConnectionPrivate::setupPacketHandlers()
 {
     typedef SshConnectionPrivate This;
 
+    for (int i = 0; i < 256; ++i) {
+        m_packetHandlers[i].handler = 0;
+        m_packetHandlers[i].stateMask = 0;
+    }
+
     setupPacketHandler(SSH_MSG_KEXINIT, StateList() << SocketConnected
         << ConnectionEstablished, &This::handleKeyExchangeInitPacket);
     setupPacketHandler(SSH_MSG_KEXDH_REPLY, StateList() << SocketConnected
@@ -299,7 +321,11 @@ void SshConnectionPrivate::setupPacketHandler(SshPacketType type,
     const SshConnectionPrivate::StateList &states,
     SshConnectionPrivate::PacketHandler handler)
 {
-    m_packetHandlers.insert(type, HandlerInStates(states, handler));
+    HandlerInStates &entry = m_packetHandlers[static_cast<quint8>(type)];
+    entry.handler = handler;
+    entry.stateMask = 0;
+    foreach (const SshStateInternal state, states)
+        entry.stateMask |= 1U << state;
 }
 
 void SshConnectionPrivate::handleSocketConnected()
@@ -316,14 +342,18 @@ void SshConnectionPrivate::handleIncomingData()
     try {
         if (!canUseSocket())
             return;
-        m_incomingData += m_socket->readAll();
+        m_bytesReceivedSinceKeyExchange += qMax<qint64>(m_incomingData.readFrom(m_socket), 0);
+
+        // Everything we send in response to this batch of data goes out in one write.
+        SshSendFacilityCork cork(m_sendFacility);
 #ifdef CREATOR_SSH_DEBUG
         qDebug("state = %d, remote data size = %d", m_state,
-            m_incomingData.count());
+            m_incomingData.size());
 #endif
         if (m_serverId.isEmpty())
             handleServerId();
         handlePackets();
+        checkForKeyReExchange();
     } catch (SshServerException &e) {
         closeConnection(e.error, SshProtocolError, e.errorStringServer,
             tr("SSH Protocol error: %1").arg(e.errorStringUser));
@@ -341,7 +371,8 @@ void SshConnectionPrivate::handleServerId()
 {
 #ifdef CREATOR_SSH_DEBUG
     qDebug("%s: incoming data size = %d, incoming data = '%s'",
-        Q_FUNC_INFO, m_incomingData.count(), m_incomingData.data());
+        Q_FUNC_INFO, m_incomingData.size(),
+        m_incomingData.left(m_incomingData.size()).constData());
 #endif
     const int newLinePos = m_incomingData.indexOf('\n');
     if (newLinePos == -1)
@@ -349,7 +380,7 @@ void SshConnectionPrivate::handleServerId()
 
     // Lines not starting with "SSH-" are ignored.
     if (!m_incomingData.startsWith("SSH-")) {
-        m_incomingData.remove(0, newLinePos + 1);
+        m_incomingData.consume(newLinePos + 1);
         m_serverHasSentDataBeforeId = true;
         return;
     }
@@ -361,11 +392,11 @@ void SshConnectionPrivate::handleServerId()
                "allowed length is 255.").arg(newLinePos + 1));
     }
 
-    const bool hasCarriageReturn = m_incomingData.at(newLinePos - 1) == '\r';
+    const bool hasCarriageReturn = m_incomingData.constData()[newLinePos - 1] == '\r';
     m_serverId = m_incomingData.left(newLinePos);
     if (hasCarriageReturn)
         m_serverId.chop(1);
-    m_incomingData.remove(0, newLinePos + 1);
+    m_incomingData.consume(newLinePos + 1);
 
     if (m_serverId.contains('\0')) {
         throw SshServerException(SSH_DISCONNECT_PROTOCOL_ERROR,
@@ -405,7 +436,7 @@ void SshConnectionPrivate::handleServerId()
                "before the identification string, which is not allowed."));
     }
 
-    m_keyExchange.reset(new SshKeyExchange(m_sendFacility));
+    m_keyExchange.reset(new SshKeyExchange(m_connParams, m_sendFacility));
     m_keyExchange->sendKexInitPacket(m_serverId);
     m_keyExchangeState = KexInitSent;
 }
@@ -430,18 +461,32 @@ void SshConnectionPrivate::handleCurrentPacket()
         return;
     }
 
-    QHash<SshPacketType, HandlerInStates>::ConstIterator it
-        = m_packetHandlers.find(m_incomingPacket.type());
-    if (it == m_packetHandlers.end()) {
+    const SshPacketType type = m_incomingPacket.type();
+
+    // Bulk transfers consist almost entirely of these two, so don't bother
+    // with the table for them.
+    if (m_state == ConnectionEstablished) {
+        if (type == SSH_MSG_CHANNEL_DATA) {
+            m_channelManager->handleChannelData(m_incomingPacket);
+            return;
+        }
+        if (type == SSH_MSG_CHANNEL_WINDOW_ADJUST) {
+            m_channelManager->handleChannelWindowAdjust(m_incomingPacket);
+            return;
+        }
+    }
+
+    const HandlerInStates &entry = m_packetHandlers[static_cast<quint8>(type)];
+    if (!entry.handler) {
         m_sendFacility.sendMsgUnimplementedPacket(m_incomingPacket.serverSeqNr());
         return;
     }
-    if (!it.value().first.contains(m_state)) {
+    if (!(entry.stateMask & (1U << m_state))) {
         throw SshServerException(SSH_DISCONNECT_PROTOCOL_ERROR,
             "Unexpected packet.", tr("Unexpected packet of type %1.")
-            .arg(m_incomingPacket.type()));
+            .arg(type));
     }
-    (this->*it.value().second)();
+    (this->*entry.handler)();
 }
 
 void SshConnectionPrivate::handleKeyExchangeInitPacket()
@@ -455,7 +500,7 @@ void SshConnectionPrivate::handleKeyExchangeInitPacket()
 
     // Server-initiated re-exchange.
     if (m_keyExchangeState == NoKeyExchange) {
-        m_keyExchange.reset(new SshKeyExchange(m_sendFacility));
+        m_keyExchange.reset(new SshKeyExchange(m_connParams, m_sendFacility));
         m_keyExchange->sendKexInitPacket(m_serverId);
     }
 
@@ -481,6 +526,7 @@ void SshConnectionPrivate::handleKeyExchangeReplyPacket()
         ClientId.left(ClientId.size() - 2));
     m_sendFacility.recreateKeys(*m_keyExchange);
     m_keyExchangeState = NewKeysSent;
+    m_channelManager->sendScheduledData();
 }
 
 void SshConnectionPrivate::handleNewKeysPacket()
@@ -494,6 +540,9 @@ void SshConnectionPrivate::handleNewKeysPacket()
     m_incomingPacket.recreateKeys(*m_keyExchange);
     m_keyExchange.reset();
     m_keyExchangeState = NoKeyExchange;
+    m_bytesReceivedSinceKeyExchange = 0;
+    if (m_state == ConnectionEstablished && m_connParams.rekeyAfterSeconds > 0)
+        m_rekeyTimer.start();
 
     if (m_state == SocketConnected) {
         m_sendFacility.sendUserAuthServiceRequestPacket();
@@ -537,10 +586,13 @@ void SshConnectionPrivate::handleUserAuthSuccessPacket()
 {
     m_state = ConnectionEstablished;
     m_timeoutTimer.stop();
+    m_incomingPacket.enableDelayedCompression();
+    m_sendFacility.enableDelayedCompression();
     emit connected();
     m_lastInvalidMsgSeqNr = InvalidSeqNr;
-    connect(&m_keepAliveTimer, SIGNAL(timeout()), SLOT(sendKeepAlivePacket()));
     m_keepAliveTimer.start();
+    if (m_connParams.rekeyAfterSeconds > 0)
+        m_rekeyTimer.start();
 }
 
 void SshConnectionPrivate::handleUserAuthFailurePacket()
@@ -568,6 +620,10 @@ void SshConnectionPrivate::handleUnimplementedPacket()
     m_lastInvalidMsgSeqNr = InvalidSeqNr;
     m_timeoutTimer.stop();
     m_keepAliveTimer.start();
+
+    // The keep-alive is answered right away, so this is as close to the network's
+    // round-trip time as we can get.
+    m_channelManager->addRoundTripTimeSample(m_keepAliveClock.elapsed());
 }
 
 void SshConnectionPrivate::handleChannelRequest()
@@ -655,6 +711,12 @@ void SshConnectionPrivate::handleSocketError()
     }
 }
 
+void SshConnectionPrivate::handleSocketBytesWritten(qint64 bytes)
+{
+    m_sendFacility.handleBytesWritten(bytes);
+    m_channelManager->handleSocketBytesWritten();
+}
+
 void SshConnectionPrivate::handleTimeout()
 {
     closeConnection(SSH_DISCONNECT_BY_APPLICATION, SshTimeoutError, "",
@@ -663,8 +725,10 @@ void SshConnectionPrivate::handleTimeout()
 
 void SshConnectionPrivate::sendKeepAlivePacket()
 {
-    // This type of message is not allowed during key exchange.
-    if (m_keyExchangeState != NoKeyExchange) {
+    // This type of message is not allowed during key exchange. The send facility
+    // would hold it back until NEWKEYS, and it would then go out with a later
+    // sequence number than the one recorded here.
+    if (m_sendFacility.isKeyExchangeInProgress()) {
         m_keepAliveTimer.start();
         return;
     }
@@ -672,9 +736,62 @@ void SshConnectionPrivate::sendKeepAlivePacket()
     Q_ASSERT(m_lastInvalidMsgSeqNr == InvalidSeqNr);
     m_lastInvalidMsgSeqNr = m_sendFacility.nextClientSeqNr();
     m_sendFacility.sendInvalidPacket();
+    m_keepAliveClock.start();
     m_timeoutTimer.start();
 }
 
+// RFC 4253, 9 and RFC 4344, 3.1.
+void SshConnectionPrivate::checkForKeyReExchange()
+{
+    if (m_state != ConnectionEstablished || m_keyExchangeState != NoKeyExchange
+            || m_connParams.rekeyAfterBytes == 0) {
+        return;
+    }
+    if (m_bytesReceivedSinceKeyExchange >= m_connParams.rekeyAfterBytes
+            || m_sendFacility.bytesSentSinceKeyExchange() >= m_connParams.rekeyAfterBytes) {
+        startKeyReExchange();
+    }
+}
+
+void SshConnectionPrivate::handleRekeyTimeout()
+{
+    // Otherwise, the timer gets restarted when the current exchange has finished.
+    if (m_state != ConnectionEstablished || m_keyExchangeState != NoKeyExchange)
+        return;
+
+    try {
+        startKeyReExchange();
+    } catch (Botan::Exception &e) {
+        closeConnection(SSH_DISCONNECT_BY_APPLICATION, SshInternalError, "",
+            tr("Botan library exception: %1").arg(QString::fromAscii(e.what())));
+    }
+}
+
+// An upload gets little back from the server, so the amount sent has to be checked
+// on the way out as well.
+void SshConnectionPrivate::handleScheduledDataSent()
+{
+    try {
+        checkForKeyReExchange();
+    } catch (Botan::Exception &e) {
+        closeConnection(SSH_DISCONNECT_BY_APPLICATION, SshInternalError, "",
+            tr("Botan library exception: %1").arg(QString::fromAscii(e.what())));
+    }
+}
+
+// Channel traffic that comes up in the meantime is held back by the send facility.
+void SshConnectionPrivate::startKeyReExchange()
+{
+#ifdef CREATOR_SSH_DEBUG
+    qDebug("Starting key re-exchange after %llu bytes received, %llu bytes sent",
+        m_bytesReceivedSinceKeyExchange, m_sendFacility.bytesSentSinceKeyExchange());
+#endif
+    m_rekeyTimer.stop();
+    m_keyExchange.reset(new SshKeyExchange(m_connParams, m_sendFacility));
+    m_keyExchange->sendKexInitPacket(m_serverId);
+    m_keyExchangeState = KexInitSent;
+}
+
 void SshConnectionPrivate::connectToHost()
 {
     QSSH_ASSERT_AND_RETURN(m_state == SocketUnconnected);
@@ -687,6 +804,7 @@ void SshConnectionPrivate::connectToHost()
     m_errorString.clear();
     m_serverId.clear();
     m_serverHasSentDataBeforeId = false;
+    m_bytesReceivedSinceKeyExchange = 0;
 
     try {
         if (m_connParams.authenticationType == SshConnectionParameters::AuthenticationByKey)
@@ -700,11 +818,12 @@ void SshConnectionPrivate::connectToHost()
 
     connect(m_socket, SIGNAL(connected()), this, SLOT(handleSocketConnected()));
     connect(m_socket, SIGNAL(readyRead()), this, SLOT(handleIncomingData()));
+    connect(m_socket, SIGNAL(bytesWritten(qint64)), this,
+        SLOT(handleSocketBytesWritten(qint64)));
     connect(m_socket, SIGNAL(error(QAbstractSocket::SocketError)), this,
         SLOT(handleSocketError()));
     connect(m_socket, SIGNAL(disconnected()), this,
         SLOT(handleSocketDisconnected()));
-    connect(&m_timeoutTimer, SIGNAL(timeout()), this, SLOT(handleTimeout()));
     m_state = SocketConnecting;
     m_keyExchangeState = NoKeyExchange;
     m_timeoutTimer.start();
@@ -723,12 +842,12 @@ void SshConnectionPrivate::closeConnection(SshErrorCode sshError,
     m_errorString = userErrorString;
     m_timeoutTimer.stop();
     disconnect(m_socket, 0, this, 0);
-    disconnect(&m_timeoutTimer, 0, this, 0);
     m_keepAliveTimer.stop();
-    disconnect(&m_keepAliveTimer, 0, this, 0);
+    m_rekeyTimer.stop();
     try {
         m_channelManager->closeAllChannels(SshChannelManager::CloseAllAndReset);
         m_sendFacility.sendDisconnectPacket(sshError, serverErrorString);
+        m_sendFacility.flush(); // We might be called during packet dispatch.
     } catch (Botan::Exception &) {}  // Nothing sensible to be done here.
     if (m_error != SshNoError)
         emit error(userError);
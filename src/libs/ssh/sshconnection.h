@@ -64,6 +64,10 @@ public:
     AuthenticationType authenticationType;
     quint16 port;
     ProxyType proxyType;
+    bool useCompression; // zlib@openssh.com; pays off on slow links only.
+    quint64 rekeyAfterBytes; // Re-exchange keys after that much data in one direction; 0 means never.
+    int rekeyAfterSeconds; // Re-exchange keys after that much time; 0 means never.
+    quint64 receiveWindowLimit; // Upper bound for the sum of all channels' receive windows.
 };
 
 QSSH_EXPORT bool operator==(const SshConnectionParameters &p1, const SshConnectionParameters &p2);
@@ -109,6 +113,9 @@ public:
 
     int channelCount() const;
 
+    // Upper bound for the receive windows of all connections in the process.
+    static void setGlobalReceiveWindowLimit(quint64 bytes);
+
 signals:
     void connected();
     void disconnected();
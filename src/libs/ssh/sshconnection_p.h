@@ -34,15 +34,15 @@
 #include "sshconnection.h"
 #include "sshexception_p.h"
 #include "sshincomingpacket_p.h"
+#include "sshreceivebuffer_p.h"
 #include "sshremoteprocess.h"
 #include "sshsendfacility_p.h"
+#include "sshtimerwheel_p.h"
 
-#include <QHash>
+#include <QElapsedTimer>
 #include <QList>
 #include <QObject>
-#include <QPair>
 #include <QScopedPointer>
-#include <QTimer>
 
 QT_BEGIN_NAMESPACE
 class QTcpSocket;
@@ -105,6 +105,9 @@ private:
     Q_SLOT void handleSocketDisconnected();
     Q_SLOT void handleTimeout();
     Q_SLOT void sendKeepAlivePacket();
+    Q_SLOT void handleRekeyTimeout();
+    Q_SLOT void handleScheduledDataSent();
+    Q_SLOT void handleSocketBytesWritten(qint64 bytes);
 
     void handleServerId();
     void handlePackets();
@@ -132,6 +135,8 @@ private:
     void handleChannelEof();
     void handleChannelClose();
     void handleDisconnect();
+    void checkForKeyReExchange();
+    void startKeyReExchange();
     bool canUseSocket() const;
     void createPrivateKey();
 
@@ -143,8 +148,14 @@ private:
     void setupPacketHandler(SshPacketType type, const StateList &states,
         PacketHandler handler);
 
-    typedef QPair<StateList, PacketHandler> HandlerInStates;
-    QHash<SshPacketType, HandlerInStates> m_packetHandlers;
+    // Indexed by message type; the state mask has bit (1 << state) set for every
+    // state in which the packet is allowed. A null handler means "unimplemented".
+    struct HandlerInStates
+    {
+        PacketHandler handler;
+        quint32 stateMask;
+    };
+    HandlerInStates m_packetHandlers[256];
 
     static const quint64 InvalidSeqNr;
 
@@ -155,12 +166,15 @@ private:
     SshSendFacility m_sendFacility;
     SshChannelManager * const m_channelManager;
     const SshConnectionParameters m_connParams;
-    QByteArray m_incomingData;
+    SshReceiveBuffer m_incomingData;
     SshError m_error;
     QString m_errorString;
     QScopedPointer<SshKeyExchange> m_keyExchange;
-    QTimer m_timeoutTimer;
-    QTimer m_keepAliveTimer;
+    SshTimer m_timeoutTimer;
+    SshTimer m_keepAliveTimer;
+    QElapsedTimer m_keepAliveClock;
+    SshTimer m_rekeyTimer;
+    quint64 m_bytesReceivedSinceKeyExchange;
     bool m_ignoreNextPacket;
     SshConnection *m_conn;
     quint64 m_lastInvalidMsgSeqNr;
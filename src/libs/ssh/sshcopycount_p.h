@@ -0,0 +1,87 @@
+/**************************************************************************
+**
+** This file is part of Qt Creator
+**
+** Copyright (c) 2012 Nokia Corporation and/or its subsidiary(-ies).
+**
+** Contact: http://www.qt-project.org/
+**
+**
+** GNU Lesser General Public License Usage
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.LGPL included in the packaging of this file.
+** Please review the following information to ensure the GNU Lesser General
+** Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights. These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** Other Usage
+**
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and Nokia.
+**
+**
+**************************************************************************/
+
+#ifndef SSHCOPYCOUNT_P_H
+#define SSHCOPYCOUNT_P_H
+
+#include <QByteArray>
+
+/*
+ * Instrumentation for the benchmarks, which build the library with
+ * QSSH_COUNT_COPIES defined: The path that outgoing channel data takes counts
+ * the bytes it copies, including moves caused by reallocating a buffer.
+ * In normal builds, the macros expand to nothing.
+ */
+
+#ifdef QSSH_COUNT_COPIES
+
+namespace QSsh {
+namespace Internal {
+
+inline quint64 &sshCopiedBytes()
+{
+    static quint64 bytes = 0;
+    return bytes;
+}
+
+// Counts the buffer's contents as moved once if it got reallocated while in scope.
+class SshBufferMoveCounter
+{
+public:
+    SshBufferMoveCounter(const QByteArray &buffer)
+        : m_buffer(buffer), m_data(buffer.constData()) {}
+    ~SshBufferMoveCounter()
+    {
+        if (m_buffer.constData() != m_data)
+            sshCopiedBytes() += m_buffer.size();
+    }
+
+private:
+    Q_DISABLE_COPY(SshBufferMoveCounter)
+
+    const QByteArray &m_buffer;
+    const char * const m_data;
+};
+
+} // namespace Internal
+} // namespace QSsh
+
+# define QSSH_COUNT_COPY(bytes) (QSsh::Internal::sshCopiedBytes() += (bytes))
+# define QSSH_COUNT_BUFFER_MOVES(buffer) \
+    QSsh::Internal::SshBufferMoveCounter bufferMoveCounter(buffer)
+
+#else
+
+# define QSSH_COUNT_COPY(bytes) do { } while (0)
+# define QSSH_COUNT_BUFFER_MOVES(buffer) do { } while (0)
+
+#endif // QSSH_COUNT_COPIES
+
+#endif // SSHCOPYCOUNT_P_H
@@ -33,23 +33,27 @@
 #include "sshbotanconversions_p.h"
 #include "sshcapabilities_p.h"
 #include "sshexception_p.h"
+#include "sshkeyencoding_p.h"
 #include "sshkeyexchange_p.h"
 #include "sshkeypasswordretriever_p.h"
 #include "sshpacket_p.h"
 
 #include <botan/block_cipher.h>
-#include <botan/cbc.h>
 #include <botan/hash.h>
-#include <botan/cipher_filter.h>
+#include <botan/mem_ops.h>
+#include <botan/pipe.h>
 #include <botan/pkcs8.h>
 #include <botan/dsa.h>
+#include <botan/ecdsa.h>
 #include <botan/rsa.h>
 #include <botan/ber_dec.h>
 #include <botan/pubkey.h>
 
 #include <QDebug>
 #include <QList>
+#include <QtEndian>
 
+#include <cstring>
 #include <string>
 
 using namespace Botan;
@@ -58,7 +62,7 @@ namespace QSsh {
 namespace Internal {
 
 SshAbstractCryptoFacility::SshAbstractCryptoFacility()
-    : m_cipherBlockSize(0), m_macLength(0)
+    : m_cipherKind(NoCipher), m_encryptThenMac(false), m_cipherBlockSize(0), m_macLength(0)
 {
 }
 
@@ -66,10 +70,16 @@ SshAbstractCryptoFacility::~SshAbstractCryptoFacility() {}
 
 void SshAbstractCryptoFacility::clearKeys()
 {
+    m_cipherKind = NoCipher;
+    m_encryptThenMac = false;
     m_cipherBlockSize = 0;
     m_macLength = 0;
     m_sessionId.clear();
-    m_pipe.reset(0);
+    m_cipherMode.reset(0);
+    m_aeadMode.reset(0);
+    m_chaChaMain.reset(0);
+    m_chaChaHeader.reset(0);
+    m_poly1305.reset(0);
     m_hMac.reset(0);
 }
 
@@ -79,44 +89,76 @@ void SshAbstractCryptoFacility::recreateKeys(const SshKeyExchange &kex)
 
     if (m_sessionId.isEmpty())
         m_sessionId = kex.h();
-    const std::string &cryptAlgo = botanCryptAlgoName(cryptAlgoName(kex));
-    BlockCipher *const cipher =  BlockCipher::create_or_throw(cryptAlgo)->clone();
+    const QByteArray &rfcCryptAlgo = cryptAlgoName(kex);
+    m_cipherMode.reset(0);
+    m_aeadMode.reset(0);
+    m_chaChaMain.reset(0);
+    m_chaChaHeader.reset(0);
+    m_poly1305.reset(0);
+    m_hMac.reset(0);
+    m_encryptThenMac = false;
+
+    if (rfcCryptAlgo == SshCapabilities::CryptAlgoChaCha20Poly1305) {
+        // The first half of the key is for the packet contents, the second one
+        // for the length field. The nonce is the sequence number, so there is no IV.
+        m_cipherKind = ChaChaPolyCipher;
+        m_cipherBlockSize = 8;
+        const QByteArray keyData = generateHash(kex, keyChar(), 64);
+        m_chaChaMain.reset(StreamCipher::create_or_throw(botanChaChaName()).release());
+        m_chaChaMain->set_key(convertByteArray(keyData), 32);
+        m_chaChaHeader.reset(StreamCipher::create_or_throw(botanChaChaName()).release());
+        m_chaChaHeader->set_key(convertByteArray(keyData) + 32, 32);
+        m_poly1305.reset(MessageAuthenticationCode::create_or_throw(botanPoly1305Name())
+                .release());
+        m_macLength = 16;
+        return;
+    }
 
-    m_cipherBlockSize = cipher->block_size();
-    const QByteArray ivData = generateHash(kex, ivChar(), m_cipherBlockSize);
-    const InitializationVector iv(convertByteArray(ivData), m_cipherBlockSize);
+    m_cipherBlockSize = BlockCipher::create_or_throw(botanCryptAlgoName(rfcCryptAlgo))
+            ->block_size();
+
+    if (isAeadCryptAlgo(rfcCryptAlgo)) {
+        // RFC 5647, 7.1: 12 byte IV, the last 8 bytes of which count the packets.
+        m_cipherKind = GcmCipher;
+        m_aeadMode.reset(AEAD_Mode::create_or_throw(botanCipherModeName(rfcCryptAlgo),
+                cipherDirection()).release());
+        const quint32 keySize = m_aeadMode->key_spec().maximum_keylength();
+        const QByteArray cryptKeyData = generateHash(kex, keyChar(), keySize);
+        m_aeadMode->set_key(convertByteArray(cryptKeyData), keySize);
+        const QByteArray ivData = generateHash(kex, ivChar(), 12);
+        m_gcmNonce.assign(ivData.constBegin(), ivData.constEnd());
+        m_macLength = m_aeadMode->tag_size();
+        return;
+    }
 
-    const quint32 keySize = cipher->key_spec().maximum_keylength();
+    // CBC and CTR both go through the Cipher_Mode interface, which works in place
+    // and keeps its chaining state (IV or counter) between packets.
+    m_cipherKind = PlainCipher;
+    m_cipherMode.reset(Cipher_Mode::create_or_throw(botanCipherModeName(rfcCryptAlgo),
+            cipherDirection()).release());
+    const quint32 keySize = m_cipherMode->key_spec().maximum_keylength();
     const QByteArray cryptKeyData = generateHash(kex, keyChar(), keySize);
-    SymmetricKey cryptKey(convertByteArray(cryptKeyData), keySize);
-
-    //Keyed_Filter * const cipherMode = makeCipherMode(cipher, new Null_Padding, iv, cryptKey);
-    const std::string &cryptAlgoParam = botanAlgoNameParameter(cryptAlgoName(kex));
-    //Keyed_Filter * const cipherMode = get_cipher(cryptAlgoParam, cryptKey, iv, ENCRYPTION);
-
-    if (cryptAlgoParam == "AES-128/CTR")
-    {
-        Keyed_Filter * const cipherMode = get_cipher(cryptAlgoParam, cryptKey, iv, ENCRYPTION);;
-        m_pipe.reset(new Pipe(cipherMode));
-    }
-    else
-    {
-        Keyed_Filter * const cipherMode = makeCipherMode(cipher, new Null_Padding, iv, cryptKey);
-        m_pipe.reset(new Pipe(cipherMode));
-    }
+    m_cipherMode->set_key(convertByteArray(cryptKeyData), keySize);
+    const QByteArray ivData = generateHash(kex, ivChar(), m_cipherBlockSize);
+    m_cipherMode->start(convertByteArray(ivData), m_cipherBlockSize);
 
-    m_macLength = botanHMacKeyLen(hMacAlgoName(kex));
+    const QByteArray &rfcHMacAlgo = hMacAlgoName(kex);
+    m_encryptThenMac = isEncryptThenMacAlgo(rfcHMacAlgo);
+    m_macLength = botanHMacKeyLen(rfcHMacAlgo);
     const QByteArray hMacKeyData = generateHash(kex, macChar(), macLength());
-    SymmetricKey hMacKey(convertByteArray(hMacKeyData), macLength());
-    const HashFunction * const hMacProto = HashFunction::create(botanHMacAlgoName(hMacAlgoName(kex)))->clone();
-    m_hMac.reset(new HMAC(hMacProto->clone()));
-    m_hMac->set_key(hMacKey);
+    m_hMac.reset(new HMAC(HashFunction::create_or_throw(botanHMacAlgoName(rfcHMacAlgo))
+            .release()));
+    m_hMac->set_key(convertByteArray(hMacKeyData), macLength());
+}
+
+quint32 SshAbstractCryptoFacility::aadLength() const
+{
+    return m_cipherKind == GcmCipher || m_cipherKind == ChaChaPolyCipher || m_encryptThenMac
+        ? 4 : 0;
 }
 
-void SshAbstractCryptoFacility::convert(QByteArray &data, quint32 offset,
-    quint32 dataSize) const
+void SshAbstractCryptoFacility::convert(char *data, quint32 dataSize) const
 {
-    Q_ASSERT(offset + dataSize <= static_cast<quint32>(data.size()));
     checkInvariant();
 
     // Session id empty => No key exchange has happened yet.
@@ -127,20 +169,110 @@ void SshAbstractCryptoFacility::convert(QByteArray &data, quint32 offset,
         throw SSH_SERVER_EXCEPTION(SSH_DISCONNECT_PROTOCOL_ERROR,
             "Invalid packet size");
     }
-    m_pipe->process_msg(reinterpret_cast<const byte *>(data.constData()) + offset,
-        dataSize);
-    quint32 bytesRead = m_pipe->read(reinterpret_cast<byte *>(data.data()) + offset,
-        dataSize, m_pipe->message_count() - 1); // Can't use Pipe::LAST_MESSAGE because of a VC bug.
-    Q_ASSERT(bytesRead == dataSize);
+    const size_t bytesProcessed
+        = m_cipherMode->process(reinterpret_cast<byte *>(data), dataSize);
+    Q_ASSERT(bytesProcessed == dataSize);
+    Q_UNUSED(bytesProcessed);
+}
+
+void SshAbstractCryptoFacility::startAeadPacket(const char *packetStart, quint32 seqNr) const
+{
+    if (m_cipherKind == GcmCipher) {
+        // The length field is not encrypted, but authenticated.
+        m_aeadMode->set_associated_data(reinterpret_cast<const byte *>(packetStart), 4);
+        m_aeadMode->start(m_gcmNonce.data(), m_gcmNonce.size());
+        for (int i = m_gcmNonce.size() - 1; i >= 4; --i) {
+            if (++m_gcmNonce[i] != 0)
+                break;
+        }
+    } else {
+        Q_ASSERT(m_cipherKind == ChaChaPolyCipher);
+
+        // The first 32 bytes of key stream are the Poly1305 key, the packet
+        // contents get encrypted starting with the second block.
+        const quint64 nonce = qToBigEndian<quint64>(seqNr);
+        m_chaChaMain->set_iv(reinterpret_cast<const byte *>(&nonce), sizeof nonce);
+        byte polyKey[32] = { 0 };
+        m_chaChaMain->cipher1(polyKey, sizeof polyKey);
+        m_chaChaMain->seek(64);
+        m_poly1305->set_key(polyKey, sizeof polyKey);
+    }
+}
+
+// For encryption, the tag gets written to tag, for decryption it is read from there.
+bool SshAbstractCryptoFacility::processGcm(char *data, quint32 dataSize, char *tag) const
+{
+    Q_ASSERT(m_cipherKind == GcmCipher);
+
+    // Botan's AEAD interface wants the last part of the message (and the tag)
+    // in a vector, so only pass the bits that process() cannot handle in place.
+    const quint32 inPlaceSize = dataSize - dataSize % m_aeadMode->update_granularity();
+    m_aeadMode->process(reinterpret_cast<byte *>(data), inPlaceSize);
+    const quint32 tailSize = dataSize - inPlaceSize;
+    m_gcmFinalBlock.assign(data + inPlaceSize, data + dataSize);
+    const bool encrypting = cipherDirection() == ENCRYPTION;
+    if (!encrypting)
+        m_gcmFinalBlock.insert(m_gcmFinalBlock.end(), tag, tag + m_macLength);
+    try {
+        m_aeadMode->finish(m_gcmFinalBlock);
+    } catch (const Invalid_Authentication_Tag &) {
+        return false;
+    }
+    std::memcpy(data + inPlaceSize, m_gcmFinalBlock.data(), tailSize);
+    if (encrypting)
+        std::memcpy(tag, m_gcmFinalBlock.data() + tailSize, m_macLength);
+    return true;
+}
+
+void SshAbstractCryptoFacility::cryptChaChaLength(char *lengthField, quint32 seqNr) const
+{
+    const quint64 nonce = qToBigEndian<quint64>(seqNr);
+    m_chaChaHeader->set_iv(reinterpret_cast<const byte *>(&nonce), sizeof nonce);
+    m_chaChaHeader->cipher1(reinterpret_cast<byte *>(lengthField), 4);
+}
+
+void SshAbstractCryptoFacility::cryptChaChaPayload(char *data, quint32 dataSize) const
+{
+    m_chaChaMain->cipher1(reinterpret_cast<byte *>(data), dataSize);
+}
+
+// The tag covers the encrypted length field and the encrypted packet contents.
+void SshAbstractCryptoFacility::computePoly1305(const char *data, quint32 dataSize,
+    char *tag) const
+{
+    m_poly1305->update(reinterpret_cast<const byte *>(data), dataSize);
+    m_poly1305->final(reinterpret_cast<byte *>(tag));
+}
+
+void SshAbstractCryptoFacility::checkAeadDataSize(quint32 dataSize) const
+{
+    if (dataSize == 0 || dataSize % cipherBlockSize() != 0) {
+        throw SSH_SERVER_EXCEPTION(SSH_DISCONNECT_PROTOCOL_ERROR,
+            "Invalid packet size");
+    }
+}
+
+void SshAbstractCryptoFacility::generateMac(quint32 seqNr, const char *data,
+    quint32 dataSize, char *mac) const
+{
+    if (m_sessionId.isEmpty())
+        return;
+
+    // Feed sequence number and packet separately instead of concatenating them first.
+    Q_ASSERT(m_hMac->output_length() == macLength());
+    const quint32 seqNrBe = qToBigEndian(seqNr);
+    m_hMac->update(reinterpret_cast<const byte *>(&seqNrBe), sizeof seqNrBe);
+    m_hMac->update(reinterpret_cast<const byte *>(data), dataSize);
+    m_hMac->final(reinterpret_cast<byte *>(mac));
 }
 
-QByteArray SshAbstractCryptoFacility::generateMac(const QByteArray &data,
-    quint32 dataSize) const
+// The MAC to check directly follows the data.
+bool SshAbstractCryptoFacility::checkMac(quint32 seqNr, const char *data, quint32 dataSize) const
 {
-    return m_sessionId.isEmpty()
-        ? QByteArray()
-        : convertByteArray(m_hMac->process(reinterpret_cast<const byte *>(data.constData()),
-              dataSize));
+    char mac[64]; // Largest supported MAC is hmac-sha2-512.
+    Q_ASSERT(macLength() <= sizeof mac);
+    generateMac(seqNr, data, dataSize, mac);
+    return same_mem(mac, data + dataSize, macLength());
 }
 
 QByteArray SshAbstractCryptoFacility::generateHash(const SshKeyExchange &kex,
@@ -164,7 +296,7 @@ QByteArray SshAbstractCryptoFacility::generateHash(const SshKeyExchange &kex,
 
 void SshAbstractCryptoFacility::checkInvariant() const
 {
-    Q_ASSERT(m_sessionId.isEmpty() == !m_pipe);
+    Q_ASSERT(m_sessionId.isEmpty() == (m_cipherKind == NoCipher));
 }
 
 
@@ -183,20 +315,42 @@ QByteArray SshEncryptionFacility::hMacAlgoName(const SshKeyExchange &kex) const
     return kex.hMacAlgoClientToServer();
 }
 
-Keyed_Filter *SshEncryptionFacility::makeCipherMode(BlockCipher *cipher,
-    BlockCipherModePaddingMethod *paddingMethod, const InitializationVector &iv,
-    const SymmetricKey &key)
+void SshEncryptionFacility::encryptPacket(QByteArray &packet, quint32 seqNr) const
 {
-    CBC_Encryption *cbc = new CBC_Encryption(cipher, paddingMethod);
-    Cipher_Mode_Filter *filter = new Cipher_Mode_Filter(cbc);
-    filter->set_iv(iv);
-    filter->set_key(key);
-    return filter;
-}
-
-void SshEncryptionFacility::encrypt(QByteArray &data) const
-{
-    convert(data, 0, data.size());
+    const quint32 packetSize = packet.size();
+    switch (cipherKind()) {
+    case NoCipher:
+        break;
+    case PlainCipher: {
+        // The MAC goes directly behind the packet; SshOutgoingPacket has reserved space for it.
+        packet.resize(packetSize + macLength());
+        char * const data = packet.data();
+        if (isEncryptThenMac()) {
+            convert(data + aadLength(), packetSize - aadLength());
+            generateMac(seqNr, data, packetSize, data + packetSize);
+        } else {
+            generateMac(seqNr, data, packetSize, data + packetSize);
+            convert(data, packetSize);
+        }
+        break;
+    }
+    case GcmCipher: {
+        packet.resize(packetSize + macLength());
+        char * const data = packet.data();
+        startAeadPacket(data, seqNr);
+        processGcm(data + aadLength(), packetSize - aadLength(), data + packetSize);
+        break;
+    }
+    case ChaChaPolyCipher: {
+        packet.resize(packetSize + macLength());
+        char * const data = packet.data();
+        startAeadPacket(data, seqNr);
+        cryptChaChaLength(data, seqNr);
+        cryptChaChaPayload(data + aadLength(), packetSize - aadLength());
+        computePoly1305(data, packetSize, data + packetSize);
+        break;
+    }
+    }
 }
 
 void SshEncryptionFacility::createAuthenticationKey(const QByteArray &privKeyFileContents)
@@ -207,13 +361,19 @@ void SshEncryptionFacility::createAuthenticationKey(const QByteArray &privKeyFil
 #ifdef CREATOR_SSH_DEBUG
     qDebug("%s: Key not cached, reading", Q_FUNC_INFO);
 #endif
-    QList<BigInt> pubKeyParams;
     QList<BigInt> allKeyParams;
     QString error1;
     QString error2;
-    if (!createAuthenticationKeyFromPKCS8(privKeyFileContents, pubKeyParams, allKeyParams, error1)
-            && !createAuthenticationKeyFromOpenSSL(privKeyFileContents, pubKeyParams, allKeyParams,
-                error2)) {
+    if (SshKeyEncoding::isOpenSshPrivateKey(privKeyFileContents)) {
+        if (!createAuthenticationKeyFromOpenSsh(privKeyFileContents, allKeyParams, error1)) {
+#ifdef CREATOR_SSH_DEBUG
+            qDebug("%s: %s\n", Q_FUNC_INFO, qPrintable(error1));
+#endif
+            throw SshClientException(SshKeyFileError,
+                SSH_TR("Decoding of private key file failed: %1").arg(error1));
+        }
+    } else if (!createAuthenticationKeyFromPKCS8(privKeyFileContents, allKeyParams, error1)
+            && !createAuthenticationKeyFromOpenSSL(privKeyFileContents, allKeyParams, error2)) {
 #ifdef CREATOR_SSH_DEBUG
         qDebug("%s: %s\n\t%s\n", Q_FUNC_INFO, qPrintable(error1), qPrintable(error2));
 #endif
@@ -228,33 +388,19 @@ void SshEncryptionFacility::createAuthenticationKey(const QByteArray &privKeyFil
         }
     }
 
-    m_authPubKeyBlob = AbstractSshPacket::encodeString(m_authKeyAlgoName);
-    foreach (const BigInt &b, pubKeyParams)
-        m_authPubKeyBlob += AbstractSshPacket::encodeMpInt(b);
+    m_authPubKeyBlob = SshKeyEncoding::publicKeyBlob(*m_authKey);
     m_cachedPrivKeyContents = privKeyFileContents;
 }
 
 bool SshEncryptionFacility::createAuthenticationKeyFromPKCS8(const QByteArray &privKeyFileContents,
-    QList<BigInt> &pubKeyParams, QList<BigInt> &allKeyParams, QString &error)
+    QList<BigInt> &allKeyParams, QString &error)
 {
     try {
         Pipe pipe;
         pipe.process_msg(convertByteArray(privKeyFileContents), privKeyFileContents.size());
         Private_Key * const key = PKCS8::load_key(pipe, m_rng, SshKeyPasswordRetriever::get_passphrase);
-        if (DSA_PrivateKey * const dsaKey = dynamic_cast<DSA_PrivateKey *>(key)) {
-            m_authKeyAlgoName = SshCapabilities::PubKeyDss;
-            m_authKey.reset(dsaKey);
-            pubKeyParams << dsaKey->group_p() << dsaKey->group_q()
-                         << dsaKey->group_g() << dsaKey->get_y();
-            allKeyParams << pubKeyParams << dsaKey->get_x();
-        } else if (RSA_PrivateKey * const rsaKey = dynamic_cast<RSA_PrivateKey *>(key)) {
-            m_authKeyAlgoName = SshCapabilities::PubKeyRsa;
-            m_authKey.reset(rsaKey);
-            pubKeyParams << rsaKey->get_e() << rsaKey->get_n();
-            allKeyParams << pubKeyParams << rsaKey->get_p() << rsaKey->get_q()
-                         << rsaKey->get_d();
-        } else {
-            qWarning("%s: Unexpected code flow, expected success or exception.", Q_FUNC_INFO);
+        if (!setAuthenticationKey(key, allKeyParams)) {
+            error = SSH_TR("Unsupported key type.");
             return false;
         }
     } catch (const Botan::Decoding_Error &ex) {
@@ -269,7 +415,7 @@ bool SshEncryptionFacility::createAuthenticationKeyFromPKCS8(const QByteArray &p
 }
 
 bool SshEncryptionFacility::createAuthenticationKeyFromOpenSSL(const QByteArray &privKeyFileContents,
-    QList<BigInt> &pubKeyParams, QList<BigInt> &allKeyParams, QString &error)
+    QList<BigInt> &allKeyParams, QString &error)
 {
     try {
         bool syntaxOk = true;
@@ -315,15 +461,13 @@ bool SshEncryptionFacility::createAuthenticationKeyFromOpenSSL(const QByteArray
             sequence.decode (p).decode (q).decode (g).decode (y).decode (x);
             DSA_PrivateKey * const dsaKey = new DSA_PrivateKey(m_rng, DL_Group(p, q, g), x);
             m_authKey.reset(dsaKey);
-            pubKeyParams << p << q << g << y;
-            allKeyParams << pubKeyParams << x;
+            allKeyParams << p << q << g << y << x;
         } else {
             BigInt p, q, e, d, n;
             sequence.decode(n).decode(e).decode(d).decode(p).decode(q);
             RSA_PrivateKey * const rsaKey = new RSA_PrivateKey(p, q, e, d, n);
             m_authKey.reset(rsaKey);
-            pubKeyParams << e << n;
-            allKeyParams << pubKeyParams << p << q << d;
+            allKeyParams << e << n << p << q << d;
         }
 
         sequence.discard_remaining();
@@ -338,6 +482,46 @@ bool SshEncryptionFacility::createAuthenticationKeyFromOpenSSL(const QByteArray
     return true;
 }
 
+bool SshEncryptionFacility::createAuthenticationKeyFromOpenSsh(const QByteArray &privKeyFileContents,
+    QList<BigInt> &allKeyParams, QString &error)
+{
+    try {
+        Private_Key * const key
+            = SshKeyEncoding::decodeOpenSshPrivateKey(privKeyFileContents, m_rng);
+        if (!setAuthenticationKey(key, allKeyParams)) {
+            error = SSH_TR("Unsupported key type.");
+            return false;
+        }
+    } catch (const Botan::Exception &ex) {
+        error = QLatin1String(ex.what());
+        return false;
+    }
+    return true;
+}
+
+// Takes ownership of key.
+bool SshEncryptionFacility::setAuthenticationKey(Private_Key *key, QList<BigInt> &allKeyParams)
+{
+    const QByteArray algoName = SshKeyEncoding::algorithmName(*key);
+    if (algoName.isEmpty()) {
+        delete key;
+        return false;
+    }
+
+    m_authKeyAlgoName = algoName;
+    m_authKey.reset(key);
+    if (DSA_PrivateKey * const dsaKey = dynamic_cast<DSA_PrivateKey *>(key)) {
+        allKeyParams << dsaKey->group_p() << dsaKey->group_q() << dsaKey->group_g()
+                     << dsaKey->get_y() << dsaKey->get_x();
+    } else if (RSA_PrivateKey * const rsaKey = dynamic_cast<RSA_PrivateKey *>(key)) {
+        allKeyParams << rsaKey->get_e() << rsaKey->get_n() << rsaKey->get_p()
+                     << rsaKey->get_q() << rsaKey->get_d();
+    } else if (ECDSA_PrivateKey * const ecdsaKey = dynamic_cast<ECDSA_PrivateKey *>(key)) {
+        allKeyParams << ecdsaKey->private_value();
+    }
+    return true;
+}
+
 QByteArray SshEncryptionFacility::authenticationAlgorithmName() const
 {
     Q_ASSERT(m_authKey);
@@ -355,18 +539,20 @@ QByteArray SshEncryptionFacility::authenticationKeySignature(const QByteArray &d
     QByteArray signature
         = convertByteArray(signer->sign_message(convertByteArray(dataToSign),
               dataToSign.size(), m_rng));
-    return AbstractSshPacket::encodeString(m_authKeyAlgoName)
-        + AbstractSshPacket::encodeString(signature);
+    return SshKeyEncoding::signatureBlob(m_authKeyAlgoName, signature);
 }
 
 QByteArray SshEncryptionFacility::getRandomNumbers(int count) const
 {
-    QByteArray data;
-    data.resize(count);
-    m_rng.randomize(convertByteArray(data), count);
-    return data;
+    return m_randomPool.randomBytes(count);
 }
 
+void SshEncryptionFacility::fillWithRandomNumbers(char *data, int count) const
+{
+    m_randomPool.fill(data, count);
+}
+
+SshEncryptionFacility::SshEncryptionFacility() : m_randomPool(m_rng) {}
 SshEncryptionFacility::~SshEncryptionFacility() {}
 
 
@@ -380,25 +566,75 @@ QByteArray SshDecryptionFacility::hMacAlgoName(const SshKeyExchange &kex) const
     return kex.hMacAlgoServerToClient();
 }
 
-Keyed_Filter *SshDecryptionFacility::makeCipherMode(BlockCipher *cipher,
-    BlockCipherModePaddingMethod *paddingMethod, const InitializationVector &iv,
-    const SymmetricKey &key)
+quint32 SshDecryptionFacility::decryptLength(char *packetStart, quint32 seqNr) const
 {
-    CBC_Decryption *cbc = new CBC_Decryption(cipher, paddingMethod);
-    Cipher_Mode_Filter *filter = new Cipher_Mode_Filter(cbc);
-    filter->set_iv(iv);
-    filter->set_key(key);
-    return filter;
+    switch (cipherKind()) {
+    case PlainCipher:
+        // The rest of the first block gets decrypted along with it.
+        if (!isEncryptThenMac())
+            convert(packetStart, cipherBlockSize());
+        break;
+    case ChaChaPolyCipher: {
+        // The encrypted length field is needed for verifying the tag later on.
+        char lengthField[4];
+        std::memcpy(lengthField, packetStart, sizeof lengthField);
+        cryptChaChaLength(lengthField, seqNr);
+        return qFromBigEndian<quint32>(reinterpret_cast<const uchar *>(lengthField));
+    }
+    case NoCipher:
+    case GcmCipher:
+        break;
+    }
+    return qFromBigEndian<quint32>(reinterpret_cast<const uchar *>(packetStart));
 }
 
-void SshDecryptionFacility::decrypt(QByteArray &data, quint32 offset,
-    quint32 dataSize) const
+void SshDecryptionFacility::decryptPacket(char *packetStart, quint32 packetSize,
+    quint32 seqNr) const
 {
-    convert(data, offset, dataSize);
+    bool macOk = true;
+    switch (cipherKind()) {
+    case NoCipher:
+        break;
+    case PlainCipher:
+        if (isEncryptThenMac()) {
+            // Nothing gets decrypted before the packet has been authenticated.
+            macOk = checkMac(seqNr, packetStart, packetSize);
+            if (macOk)
+                convert(packetStart + aadLength(), packetSize - aadLength());
+        } else {
+            convert(packetStart + cipherBlockSize(), packetSize - cipherBlockSize());
+            macOk = checkMac(seqNr, packetStart, packetSize);
+        }
+        break;
+    case GcmCipher:
+        checkAeadDataSize(packetSize - aadLength());
+        startAeadPacket(packetStart, seqNr);
+        macOk = processGcm(packetStart + aadLength(), packetSize - aadLength(),
+                packetStart + packetSize);
+        break;
+    case ChaChaPolyCipher: {
+        checkAeadDataSize(packetSize - aadLength());
+        startAeadPacket(packetStart, seqNr);
+        char expectedTag[16];
+        computePoly1305(packetStart, packetSize, expectedTag);
+        macOk = same_mem(expectedTag, packetStart + packetSize, sizeof expectedTag);
+        if (macOk) {
+            cryptChaChaPayload(packetStart + aadLength(), packetSize - aadLength());
+            qToBigEndian(packetSize - 4, reinterpret_cast<uchar *>(packetStart));
+        }
+        break;
+    }
+    }
+
+    if (!macOk) {
+        throw SSH_SERVER_EXCEPTION(SSH_DISCONNECT_MAC_ERROR,
+                           "Message authentication failed.");
+    }
+
 #ifdef CREATOR_SSH_DEBUG
     qDebug("Decrypted data:");
-    const char * const start = data.constData() + offset;
-    const char * const end = start + dataSize;
+    const char * const start = packetStart;
+    const char * const end = start + packetSize;
     for (const char *c = start; c < end; ++c)
         qDebug() << "'" << *c << "' (0x" << (static_cast<int>(*c) & 0xff) << ")";
 #endif
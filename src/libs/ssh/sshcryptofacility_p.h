@@ -31,15 +31,17 @@
 #ifndef SSHABSTRACTCRYPTOFACILITY_P_H
 #define SSHABSTRACTCRYPTOFACILITY_P_H
 
-#include <botan/mode_pad.h>
+#include <botan/aead.h>
+#include <botan/cipher_mode.h>
 #include <botan/hmac.h>
-#include <botan/key_filt.h>
-#include <botan/block_cipher.h>
-#include <botan/pipe.h>
+#include <botan/mac.h>
+#include <botan/stream_cipher.h>
 #include <botan/bigint.h>
 #include <botan/pk_keys.h>
 #include <botan/auto_rng.h>
 
+#include "sshrandompool_p.h"
+
 #include <QByteArray>
 #include <QScopedPointer>
 
@@ -55,13 +57,34 @@ public:
 
     void clearKeys();
     void recreateKeys(const SshKeyExchange &kex);
-    QByteArray generateMac(const QByteArray &data, quint32 dataSize) const;
+    // Writes macLength() bytes to mac.
+    void generateMac(quint32 seqNr, const char *data, quint32 dataSize, char *mac) const;
     quint32 cipherBlockSize() const { return m_cipherBlockSize; }
     quint32 macLength() const { return m_macLength; }
 
+    // Number of leading packet bytes (i.e. the length field) that are not
+    // part of the block-aligned data processed by the cipher.
+    quint32 aadLength() const;
+
 protected:
+    enum CipherKind {
+        NoCipher, // Before the first key exchange.
+        PlainCipher, // Block or stream cipher plus HMAC, possibly encrypt-then-MAC.
+        GcmCipher, // aes*-gcm@openssh.com (RFC 5647)
+        ChaChaPolyCipher // chacha20-poly1305@openssh.com
+    };
+
     SshAbstractCryptoFacility();
-    void convert(QByteArray &data, quint32 offset, quint32 dataSize) const;
+    CipherKind cipherKind() const { return m_cipherKind; }
+    bool isEncryptThenMac() const { return m_encryptThenMac; }
+    bool checkMac(quint32 seqNr, const char *data, quint32 dataSize) const;
+    void convert(char *data, quint32 dataSize) const;
+    void startAeadPacket(const char *packetStart, quint32 seqNr) const;
+    bool processGcm(char *data, quint32 dataSize, char *tag) const;
+    void cryptChaChaLength(char *lengthField, quint32 seqNr) const;
+    void cryptChaChaPayload(char *data, quint32 dataSize) const;
+    void computePoly1305(const char *data, quint32 dataSize, char *tag) const;
+    void checkAeadDataSize(quint32 dataSize) const;
     QByteArray sessionId() const { return m_sessionId; }
 
 private:
@@ -70,10 +93,7 @@ private:
 
     virtual QByteArray cryptAlgoName(const SshKeyExchange &kex) const = 0;
     virtual QByteArray hMacAlgoName(const SshKeyExchange &kex) const = 0;
-    virtual Botan::Keyed_Filter *makeCipherMode(Botan::BlockCipher *cipher,
-        Botan::BlockCipherModePaddingMethod *paddingMethod,
-        const Botan::InitializationVector &iv,
-        const Botan::SymmetricKey &key) = 0;
+    virtual Botan::Cipher_Dir cipherDirection() const = 0;
     virtual char ivChar() const = 0;
     virtual char keyChar() const = 0;
     virtual char macChar() const = 0;
@@ -82,7 +102,15 @@ private:
     void checkInvariant() const;
 
     QByteArray m_sessionId;
-    QScopedPointer<Botan::Pipe> m_pipe;
+    CipherKind m_cipherKind;
+    bool m_encryptThenMac;
+    QScopedPointer<Botan::Cipher_Mode> m_cipherMode;
+    QScopedPointer<Botan::AEAD_Mode> m_aeadMode;
+    mutable Botan::secure_vector<Botan::byte> m_gcmNonce;
+    mutable Botan::secure_vector<Botan::byte> m_gcmFinalBlock;
+    QScopedPointer<Botan::StreamCipher> m_chaChaMain;
+    QScopedPointer<Botan::StreamCipher> m_chaChaHeader;
+    QScopedPointer<Botan::MessageAuthenticationCode> m_poly1305;
     QScopedPointer<Botan::HMAC> m_hMac;
     quint32 m_cipherBlockSize;
     quint32 m_macLength;
@@ -91,30 +119,34 @@ private:
 class SshEncryptionFacility : public SshAbstractCryptoFacility
 {
 public:
-    void encrypt(QByteArray &data) const;
+    // Encrypts the complete packet in place and appends the MAC or authentication tag.
+    void encryptPacket(QByteArray &packet, quint32 seqNr) const;
 
     void createAuthenticationKey(const QByteArray &privKeyFileContents);
     QByteArray authenticationAlgorithmName() const;
     QByteArray authenticationPublicKey() const { return m_authPubKeyBlob; }
     QByteArray authenticationKeySignature(const QByteArray &data) const;
     QByteArray getRandomNumbers(int count) const;
+    void fillWithRandomNumbers(char *data, int count) const; // Does not allocate.
 
+    SshEncryptionFacility();
     ~SshEncryptionFacility();
 
 private:
     virtual QByteArray cryptAlgoName(const SshKeyExchange &kex) const;
     virtual QByteArray hMacAlgoName(const SshKeyExchange &kex) const;
-    virtual Botan::Keyed_Filter *makeCipherMode(Botan::BlockCipher *cipher,
-        Botan::BlockCipherModePaddingMethod *paddingMethod,
-        const Botan::InitializationVector &iv, const Botan::SymmetricKey &key);
+    virtual Botan::Cipher_Dir cipherDirection() const { return Botan::ENCRYPTION; }
     virtual char ivChar() const { return 'A'; }
     virtual char keyChar() const { return 'C'; }
     virtual char macChar() const { return 'E'; }
 
     bool createAuthenticationKeyFromPKCS8(const QByteArray &privKeyFileContents,
-        QList<Botan::BigInt> &pubKeyParams, QList<Botan::BigInt> &allKeyParams, QString &error);
+        QList<Botan::BigInt> &allKeyParams, QString &error);
     bool createAuthenticationKeyFromOpenSSL(const QByteArray &privKeyFileContents,
-        QList<Botan::BigInt> &pubKeyParams, QList<Botan::BigInt> &allKeyParams, QString &error);
+        QList<Botan::BigInt> &allKeyParams, QString &error);
+    bool createAuthenticationKeyFromOpenSsh(const QByteArray &privKeyFileContents,
+        QList<Botan::BigInt> &allKeyParams, QString &error);
+    bool setAuthenticationKey(Botan::Private_Key *key, QList<Botan::BigInt> &allKeyParams);
 
     static const QByteArray PrivKeyFileStartLineRsa;
     static const QByteArray PrivKeyFileStartLineDsa;
@@ -126,19 +158,22 @@ private:
     QByteArray m_cachedPrivKeyContents;
     QScopedPointer<Botan::Private_Key> m_authKey;
     mutable Botan::AutoSeeded_RNG m_rng;
+    mutable SshRandomPool m_randomPool;
 };
 
 class SshDecryptionFacility : public SshAbstractCryptoFacility
 {
 public:
-    void decrypt(QByteArray &data, quint32 offset, quint32 dataSize) const;
+    // Must be called exactly once per packet, before decryptPacket().
+    quint32 decryptLength(char *packetStart, quint32 seqNr) const;
+
+    // packetSize includes the length field. The MAC or tag follows the packet.
+    void decryptPacket(char *packetStart, quint32 packetSize, quint32 seqNr) const;
 
 private:
     virtual QByteArray cryptAlgoName(const SshKeyExchange &kex) const;
     virtual QByteArray hMacAlgoName(const SshKeyExchange &kex) const;
-    virtual Botan::Keyed_Filter *makeCipherMode(Botan::BlockCipher *cipher,
-        Botan::BlockCipherModePaddingMethod *paddingMethod,
-        const Botan::InitializationVector &iv, const Botan::SymmetricKey &key);
+    virtual Botan::Cipher_Dir cipherDirection() const { return Botan::DECRYPTION; }
     virtual char ivChar() const { return 'B'; }
     virtual char keyChar() const { return 'D'; }
     virtual char macChar() const { return 'F'; }
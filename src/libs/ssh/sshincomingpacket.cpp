@@ -30,7 +30,9 @@
 
 #include "sshincomingpacket_p.h"
 
+#include "sshbotanconversions_p.h"
 #include "sshcapabilities_p.h"
+#include "sshkeyencoding_p.h"
 
 namespace QSsh {
 namespace Internal {
@@ -50,9 +52,20 @@ quint32 SshIncomingPacket::macLength() const
     return m_decrypter.macLength();
 }
 
+quint32 SshIncomingPacket::aadLength() const
+{
+    return m_decrypter.aadLength();
+}
+
 void SshIncomingPacket::recreateKeys(const SshKeyExchange &keyExchange)
 {
     m_decrypter.recreateKeys(keyExchange);
+    m_decompressor.setAlgorithm(keyExchange.compressionAlgoServerToClient());
+}
+
+void SshIncomingPacket::enableDelayedCompression()
+{
+    m_decompressor.setAuthenticated();
 }
 
 void SshIncomingPacket::reset()
@@ -60,72 +73,80 @@ void SshIncomingPacket::reset()
     clear();
     m_serverSeqNr = 0;
     m_decrypter.clearKeys();
+    m_decompressor.reset();
+    m_decompressedData.clear();
 }
 
-void SshIncomingPacket::consumeData(QByteArray &newData)
+void SshIncomingPacket::consumeData(SshReceiveBuffer &buffer)
 {
 #ifdef CREATOR_SSH_DEBUG
-    qDebug("%s: current data size = %d, new data size = %d",
-        Q_FUNC_INFO, m_data.size(), newData.size());
+    qDebug("%s: current length = %u, buffered data size = %d",
+        Q_FUNC_INFO, m_length, buffer.size());
 #endif
 
-    if (isComplete() || newData.isEmpty())
+    if (isComplete() || buffer.isEmpty())
         return;
 
     /*
      * Until we have reached the minimum packet size, we cannot decrypt the
-     * length field.
+     * length field. Depending on the cipher, this might decrypt the first block
+     * in place, so it must happen exactly once; the block then stays in the
+     * buffer until the rest of the packet has arrived.
      */
     const quint32 minSize = minPacketSize();
-    if (currentDataSize() < minSize) {
-        const int bytesToTake
-            = qMin<quint32>(minSize - currentDataSize(), newData.size());
-        moveFirstBytes(m_data, newData, bytesToTake);
+    if (m_length == 0) {
+        if (static_cast<quint32>(buffer.size()) < minSize)
+            return;
+        m_length = m_decrypter.decryptLength(buffer.data(), m_serverSeqNr);
 #ifdef CREATOR_SSH_DEBUG
-        qDebug("Took %d bytes from new data", bytesToTake);
+        qDebug("decrypted length is %u", m_length);
 #endif
-        if (currentDataSize() < minSize)
-            return;
     }
 
-    if (4 + length() + macLength() < currentDataSize())
+    const quint32 packetSize = 4 + m_length + macLength();
+    if (packetSize < minSize)
         throw SSH_SERVER_EXCEPTION(SSH_DISCONNECT_PROTOCOL_ERROR, "Server sent invalid packet.");
+    if (static_cast<quint32>(buffer.size()) < packetSize)
+        return;
 
-    const int bytesToTake
-        = qMin<quint32>(length() + 4 + macLength() - currentDataSize(),
-              newData.size());
-    moveFirstBytes(m_data, newData, bytesToTake);
-#ifdef CREATOR_SSH_DEBUG
-    qDebug("Took %d bytes from new data", bytesToTake);
-#endif
-    if (isComplete()) {
+    char * const packetStart = buffer.data();
+    m_decrypter.decryptPacket(packetStart, 4 + m_length, m_serverSeqNr);
+
+    // The packet is not copied out of the buffer; m_data just refers to it.
+    m_data = QByteArray::fromRawData(packetStart, packetSize);
+    buffer.consume(packetSize);
+    if (m_decompressor.isActive())
+        decompress();
 #ifdef CREATOR_SSH_DEBUG
-        qDebug("Message complete. Overall size: %u, payload size: %u",
-            m_data.size(), m_length - paddingLength() - 1);
+    qDebug("Message complete. Overall size: %u, payload size: %u",
+        m_data.size(), m_length - paddingLength() - 1);
 #endif
-        decrypt();
-        ++m_serverSeqNr;
-    }
+    ++m_serverSeqNr;
 }
 
-void SshIncomingPacket::decrypt()
+/*
+ * The decompressed packet is rebuilt in a buffer of its own, without padding,
+ * so that everything further up does not need to know about compression.
+ */
+void SshIncomingPacket::decompress()
 {
-    Q_ASSERT(isComplete());
-    const quint32 netDataLength = length() + 4;
-    m_decrypter.decrypt(m_data, cipherBlockSize(),
-        netDataLength - cipherBlockSize());
-    const QByteArray &mac = m_data.mid(netDataLength, macLength());
-    if (mac != generateMac(m_decrypter, m_serverSeqNr)) {
-        throw SSH_SERVER_EXCEPTION(SSH_DISCONNECT_MAC_ERROR,
-                           "Message authentication failed.");
-    }
-}
+    const quint32 padLength = paddingLength();
+    if (padLength + 1 >= m_length)
+        throw SSH_SERVER_EXCEPTION(SSH_DISCONNECT_PROTOCOL_ERROR, "Server sent invalid packet.");
 
-void SshIncomingPacket::moveFirstBytes(QByteArray &target, QByteArray &source,
-    int n)
-{
-    target.append(source.left(n));
-    source.remove(0, n);
+    m_decompressedData.resize(PayloadOffset);
+    m_decompressor.decompress(m_data.constData() + PayloadOffset,
+        m_length - padLength - 1, m_decompressedData);
+    if (m_decompressedData.size() == static_cast<int>(PayloadOffset))
+        throw SSH_SERVER_EXCEPTION(SSH_DISCONNECT_COMPRESSION_ERROR, "Server sent empty packet.");
+    m_decompressedData[PaddingLengthOffset] = 0;
+    setLengthField(m_decompressedData);
+    m_length = m_decompressedData.size() - 4;
+
+    // Keep the MAC, so the packet's size still adds up.
+    m_decompressedData.append(m_data.constData() + m_data.size() - macLength(),
+        macLength());
+    m_data = m_decompressedData;
 }
 
 SshKeyExchangeInit SshIncomingPacket::extractKeyExchangeInitData() const
@@ -168,7 +189,8 @@ SshKeyExchangeInit SshIncomingPacket::extractKeyExchangeInitData() const
     return exchangeData;
 }
 
-SshKeyExchangeReply SshIncomingPacket::extractKeyExchangeReply(const QByteArray &pubKeyAlgo) const
+SshKeyExchangeReply SshIncomingPacket::extractKeyExchangeReply(const QByteArray &kexAlgo,
+    const QByteArray &pubKeyAlgo) const
 {
     Q_ASSERT(isComplete());
     Q_ASSERT(type() == SSH_MSG_KEXDH_REPLY);
@@ -184,17 +206,28 @@ SshKeyExchangeReply SshIncomingPacket::extractKeyExchangeReply(const QByteArray
         if (SshPacketParser::asString(m_data, &offset) != pubKeyAlgo)
             throw SshPacketParseException();
 
-        // DSS: p and q, RSA: e and n
-        replyData.parameters << SshPacketParser::asBigInt(m_data, &offset);
-        replyData.parameters << SshPacketParser::asBigInt(m_data, &offset);
-
-        // g and y
-        if (pubKeyAlgo == SshCapabilities::PubKeyDss) {
+        if (pubKeyAlgo == SshCapabilities::PubKeyEd25519) {
+            replyData.hostKey = SshPacketParser::asString(m_data, &offset);
+        } else if (pubKeyAlgo == SshCapabilities::PubKeyEcdsaNistp256) {
+            if (SshPacketParser::asString(m_data, &offset) != SshKeyEncoding::NistP256Identifier)
+                throw SshPacketParseException();
+            replyData.hostKey = SshPacketParser::asString(m_data, &offset);
+        } else {
+            // DSS: p and q, RSA: e and n
             replyData.parameters << SshPacketParser::asBigInt(m_data, &offset);
             replyData.parameters << SshPacketParser::asBigInt(m_data, &offset);
+
+            // g and y
+            if (pubKeyAlgo == SshCapabilities::PubKeyDss) {
+                replyData.parameters << SshPacketParser::asBigInt(m_data, &offset);
+                replyData.parameters << SshPacketParser::asBigInt(m_data, &offset);
+            }
         }
 
-        replyData.f = SshPacketParser::asBigInt(m_data, &offset);
+        if (isEcdhKeyExchangeAlgo(kexAlgo))
+            replyData.q_s = SshPacketParser::asString(m_data, &offset);
+        else
+            replyData.f = SshPacketParser::asBigInt(m_data, &offset);
         offset += 4;
         if (SshPacketParser::asString(m_data, &offset) != pubKeyAlgo)
             throw SshPacketParseException();
@@ -341,7 +374,7 @@ SshChannelData SshIncomingPacket::extractChannelData() const
     try {
         quint32 offset = TypeOffset + 1;
         data.localChannel = SshPacketParser::asUint32(m_data, &offset);
-        data.data = SshPacketParser::asString(m_data, &offset);
+        data.data = SshPacketParser::asRawString(m_data, &offset);
     } catch (SshPacketParseException &) {
         throw SSH_SERVER_EXCEPTION(SSH_DISCONNECT_PROTOCOL_ERROR,
             "Invalid SSH_MSG_CHANNEL_DATA packet.");
@@ -359,7 +392,7 @@ SshChannelExtendedData SshIncomingPacket::extractChannelExtendedData() const
         quint32 offset = TypeOffset + 1;
         data.localChannel = SshPacketParser::asUint32(m_data, &offset);
         data.type = SshPacketParser::asUint32(m_data, &offset);
-        data.data = SshPacketParser::asString(m_data, &offset);
+        data.data = SshPacketParser::asRawString(m_data, &offset);
     } catch (SshPacketParseException &) {
         throw SSH_SERVER_EXCEPTION(SSH_DISCONNECT_PROTOCOL_ERROR,
             "Invalid SSH_MSG_CHANNEL_EXTENDED_DATA packet.");
@@ -442,23 +475,5 @@ QByteArray SshIncomingPacket::extractChannelRequestType() const
     }
 }
 
-void SshIncomingPacket::calculateLength() const
-{
-    Q_ASSERT(currentDataSize() >= minPacketSize());
-#ifdef CREATOR_SSH_DEBUG
-    qDebug("Length field before decryption: %d-%d-%d-%d", m_data.at(0) & 0xff,
-        m_data.at(1) & 0xff, m_data.at(2) & 0xff, m_data.at(3) & 0xff);
-#endif
-    m_decrypter.decrypt(m_data, 0, cipherBlockSize());
-#ifdef CREATOR_SSH_DEBUG
-    qDebug("Length field after decryption: %d-%d-%d-%d", m_data.at(0) & 0xff, m_data.at(1) & 0xff, m_data.at(2) & 0xff, m_data.at(3) & 0xff);
-    qDebug("message type = %d", m_data.at(TypeOffset));
-#endif
-    m_length = SshPacketParser::asUint32(m_data, static_cast<quint32>(0));
-#ifdef CREATOR_SSH_DEBUG
-    qDebug("decrypted length is %u", m_length);
-#endif
-}
-
 } // namespace Internal
 } // namespace QSsh
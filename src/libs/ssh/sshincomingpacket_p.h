@@ -33,8 +33,10 @@
 
 #include "sshpacket_p.h"
 
+#include "sshcompressionfacility_p.h"
 #include "sshcryptofacility_p.h"
 #include "sshpacketparser_p.h"
+#include "sshreceivebuffer_p.h"
 
 #include <QList>
 #include <QString>
@@ -64,7 +66,9 @@ struct SshKeyExchangeReply
 {
     QByteArray k_s;
     QList<Botan::BigInt> parameters; // DSS: p, q, g, y. RSA: e, n.
+    QByteArray hostKey; // Ed25519: public key. ECDSA: public point.
     Botan::BigInt f;
+    QByteArray q_s; // ECDH: The server's public key instead of f.
     QByteArray signatureBlob;
 };
 
@@ -115,6 +119,8 @@ struct SshChannelWindowAdjust
     quint32 bytesToAdd;
 };
 
+// The data members of these two refer to the packet's memory; they are only valid
+// until the next packet is read and must be copied by whoever wants to keep them.
 struct SshChannelData
 {
     quint32 localChannel;
@@ -149,12 +155,14 @@ class SshIncomingPacket : public AbstractSshPacket
 public:
     SshIncomingPacket();
 
-    void consumeData(QByteArray &data);
+    void consumeData(SshReceiveBuffer &buffer);
     void recreateKeys(const SshKeyExchange &keyExchange);
+    void enableDelayedCompression();
     void reset();
 
     SshKeyExchangeInit extractKeyExchangeInitData() const;
-    SshKeyExchangeReply extractKeyExchangeReply(const QByteArray &pubKeyAlgo) const;
+    SshKeyExchangeReply extractKeyExchangeReply(const QByteArray &kexAlgo,
+        const QByteArray &pubKeyAlgo) const;
     SshDisconnect extractDisconnect() const;
     SshUserAuthBanner extractUserAuthBanner() const;
     SshDebug extractDebug() const;
@@ -178,13 +186,14 @@ public:
 private:
     virtual quint32 cipherBlockSize() const;
     virtual quint32 macLength() const;
-    virtual void calculateLength() const;
+    virtual quint32 aadLength() const;
 
-    void decrypt();
-    void moveFirstBytes(QByteArray &target, QByteArray &source, int n);
+    void decompress();
 
     quint32 m_serverSeqNr;
     SshDecryptionFacility m_decrypter;
+    SshDecompressionFacility m_decompressor;
+    QByteArray m_decompressedData;
 };
 
 } // namespace Internal
@@ -35,13 +35,20 @@
 #include "sshsendfacility_p.h"
 #include "sshexception_p.h"
 #include "sshincomingpacket_p.h"
+#include "sshkeyencoding_p.h"
 
+#include <botan/auto_rng.h>
+#include <botan/curve25519.h>
 #include <botan/dl_group.h>
 #include <botan/dh.h>
+#include <botan/ec_group.h>
+#include <botan/ecdh.h>
 #include <botan/numthry.h>
 #include <botan/pubkey.h>
 #include <botan/lookup.h>
 #include <botan/dsa.h>
+#include <botan/ecdsa.h>
+#include <botan/ed25519.h>
 #include <botan/rsa.h>
 
 #ifdef CREATOR_SSH_DEBUG
@@ -80,10 +87,35 @@ namespace {
     }
 #endif
 
+    // Seeding an RNG is not cheap, so all key exchanges share one.
+    // Botan's auto-seeded RNG is thread-safe.
+    RandomNumberGenerator &keyExchangeRng()
+    {
+        static AutoSeeded_RNG rng;
+        return rng;
+    }
+
+    // Decoding the group parameters is not cheap either.
+    const DL_Group &dhGroup(const QByteArray &rfcKexAlgo)
+    {
+        static const DL_Group group1(
+            botanKeyExchangeAlgoName(SshCapabilities::DiffieHellmanGroup1Sha1));
+        static const DL_Group group14(
+            botanKeyExchangeAlgoName(SshCapabilities::DiffieHellmanGroup14Sha1));
+        return rfcKexAlgo == SshCapabilities::DiffieHellmanGroup1Sha1 ? group1 : group14;
+    }
+
+    const EC_Group &nistP256Group()
+    {
+        static const EC_Group group(botanKeyExchangeAlgoName(SshCapabilities::EcdhNistp256));
+        return group;
+    }
+
 } // anonymous namespace
 
-SshKeyExchange::SshKeyExchange(SshSendFacility &sendFacility)
-    : m_sendFacility(sendFacility)
+SshKeyExchange::SshKeyExchange(const SshConnectionParameters &connParams,
+        SshSendFacility &sendFacility)
+    : m_connParams(connParams), m_sendFacility(sendFacility)
 {
 }
 
@@ -92,7 +124,15 @@ SshKeyExchange::~SshKeyExchange() {}
 void SshKeyExchange::sendKexInitPacket(const QByteArray &serverId)
 {
     m_serverId = serverId;
-    m_clientKexInitPayload = m_sendFacility.sendKeyExchangeInitPacket();
+    m_clientKexInitPayload
+        = m_sendFacility.sendKeyExchangeInitPacket(compressionAlgorithms());
+}
+
+QList<QByteArray> SshKeyExchange::compressionAlgorithms() const
+{
+    return m_connParams.useCompression
+        ? SshCapabilities::CompressionAlgorithmsWithZlib
+        : SshCapabilities::CompressionAlgorithms;
 }
 
 bool SshKeyExchange::sendDhInitPacket(const SshIncomingPacket &serverKexInit)
@@ -111,15 +151,14 @@ bool SshKeyExchange::sendDhInitPacket(const SshIncomingPacket &serverKexInit)
     printNameList("MAC algorithms client to server", kexInitParams.macAlgorithmsClientToServer);
     printNameList("MAC algorithms server to client", kexInitParams.macAlgorithmsServerToClient);
     printNameList("Compression algorithms client to server", kexInitParams.compressionAlgorithmsClientToServer);
-    printNameList("Compression algorithms client to server", kexInitParams.compressionAlgorithmsClientToServer);
+    printNameList("Compression algorithms server to client", kexInitParams.compressionAlgorithmsServerToClient);
     printNameList("Languages client to server", kexInitParams.languagesClientToServer);
     printNameList("Languages server to client", kexInitParams.languagesServerToClient);
 #ifdef CREATOR_SSH_DEBUG
     qDebug("First packet follows: %d", kexInitParams.firstKexPacketFollows);
 #endif
 
-    const QByteArray &keyAlgo
-        = SshCapabilities::findBestMatch(SshCapabilities::KeyExchangeMethods,
+    m_kexAlgo = SshCapabilities::findBestMatch(SshCapabilities::KeyExchangeMethods,
               kexInitParams.keyAlgorithms.names);
     m_serverHostKeyAlgo
         = SshCapabilities::findBestMatch(SshCapabilities::PublicKeyAlgorithms,
@@ -130,23 +169,35 @@ bool SshKeyExchange::sendDhInitPacket(const SshIncomingPacket &serverKexInit)
     m_decryptionAlgo
         = SshCapabilities::findBestMatch(SshCapabilities::EncryptionAlgorithms,
               kexInitParams.encryptionAlgorithmsServerToClient.names);
-    m_c2sHMacAlgo
-        = SshCapabilities::findBestMatch(SshCapabilities::MacAlgorithms,
+
+    // Like OpenSSH, do not negotiate a MAC for a direction that uses an AEAD cipher.
+    m_c2sHMacAlgo.clear();
+    m_s2cHMacAlgo.clear();
+    if (!isAeadCryptAlgo(m_encryptionAlgo)) {
+        m_c2sHMacAlgo = SshCapabilities::findBestMatch(SshCapabilities::MacAlgorithms,
               kexInitParams.macAlgorithmsClientToServer.names);
-    m_s2cHMacAlgo
-        = SshCapabilities::findBestMatch(SshCapabilities::MacAlgorithms,
+    }
+    if (!isAeadCryptAlgo(m_decryptionAlgo)) {
+        m_s2cHMacAlgo = SshCapabilities::findBestMatch(SshCapabilities::MacAlgorithms,
               kexInitParams.macAlgorithmsServerToClient.names);
-    SshCapabilities::findBestMatch(SshCapabilities::CompressionAlgorithms,
+    }
+    m_c2sCompressionAlgo = SshCapabilities::findBestMatch(compressionAlgorithms(),
         kexInitParams.compressionAlgorithmsClientToServer.names);
-    SshCapabilities::findBestMatch(SshCapabilities::CompressionAlgorithms,
+    m_s2cCompressionAlgo = SshCapabilities::findBestMatch(compressionAlgorithms(),
         kexInitParams.compressionAlgorithmsServerToClient.names);
 
-    AutoSeeded_RNG rng;
-    m_dhKey.reset(new DH_PrivateKey(rng,
-        DL_Group(botanKeyExchangeAlgoName(keyAlgo))));
-
     m_serverKexInitPayload = serverKexInit.payLoad();
-    m_sendFacility.sendKeyDhInitPacket(m_dhKey->get_y());
+    if (isEcdhKeyExchangeAlgo(m_kexAlgo)) {
+        if (isCurve25519KeyExchangeAlgo(m_kexAlgo))
+            m_ecdhKey.reset(new Curve25519_PrivateKey(keyExchangeRng()));
+        else
+            m_ecdhKey.reset(new ECDH_PrivateKey(keyExchangeRng(), nistP256Group()));
+        m_clientQ = convertByteArray(m_ecdhKey->public_value());
+        m_sendFacility.sendKeyEcdhInitPacket(m_clientQ);
+    } else {
+        m_dhKey.reset(new DH_PrivateKey(keyExchangeRng(), dhGroup(m_kexAlgo)));
+        m_sendFacility.sendKeyDhInitPacket(m_dhKey->get_y());
+    }
     return kexInitParams.firstKexPacketFollows;
 }
 
@@ -154,24 +205,30 @@ void SshKeyExchange::sendNewKeysPacket(const SshIncomingPacket &dhReply,
     const QByteArray &clientId)
 {
     const SshKeyExchangeReply &reply
-        = dhReply.extractKeyExchangeReply(m_serverHostKeyAlgo);
-    if (reply.f <= 0 || reply.f >= m_dhKey->group_p()) {
-        throw SSH_SERVER_EXCEPTION(SSH_DISCONNECT_KEY_EXCHANGE_FAILED,
-            "Server sent invalid f.");
-    }
+        = dhReply.extractKeyExchangeReply(m_kexAlgo, m_serverHostKeyAlgo);
 
     QByteArray concatenatedData = AbstractSshPacket::encodeString(clientId);
     concatenatedData += AbstractSshPacket::encodeString(m_serverId);
     concatenatedData += AbstractSshPacket::encodeString(m_clientKexInitPayload);
     concatenatedData += AbstractSshPacket::encodeString(m_serverKexInitPayload);
     concatenatedData += reply.k_s;
-    concatenatedData += AbstractSshPacket::encodeMpInt(m_dhKey->get_y());
-    concatenatedData += AbstractSshPacket::encodeMpInt(reply.f);
-    const BigInt k = power_mod(reply.f, m_dhKey->get_x(), m_dhKey->get_domain().get_p());
-    m_k = AbstractSshPacket::encodeMpInt(k);
+    if (isEcdhKeyExchangeAlgo(m_kexAlgo)) {
+        concatenatedData += AbstractSshPacket::encodeString(m_clientQ);
+        concatenatedData += AbstractSshPacket::encodeString(reply.q_s);
+        m_k = AbstractSshPacket::encodeMpInt(ecdhSharedSecret(reply.q_s));
+    } else {
+        if (reply.f <= 0 || reply.f >= m_dhKey->group_p()) {
+            throw SSH_SERVER_EXCEPTION(SSH_DISCONNECT_KEY_EXCHANGE_FAILED,
+                "Server sent invalid f.");
+        }
+        concatenatedData += AbstractSshPacket::encodeMpInt(m_dhKey->get_y());
+        concatenatedData += AbstractSshPacket::encodeMpInt(reply.f);
+        const BigInt k = power_mod(reply.f, m_dhKey->get_x(), m_dhKey->group_p());
+        m_k = AbstractSshPacket::encodeMpInt(k);
+    }
     concatenatedData += m_k;
 
-    m_hash.reset(HashFunction::create_or_throw(botanSha1Name())->clone());
+    m_hash.reset(HashFunction::create_or_throw(botanKeyExchangeHashName(m_kexAlgo)).release());
     const SecureVector<byte> &hashResult
         = m_hash->process(convertByteArray(concatenatedData),
                         concatenatedData.size());
@@ -183,35 +240,47 @@ void SshKeyExchange::sendNewKeysPacket(const SshIncomingPacket &dhReply,
     printData("Client Payload", AbstractSshPacket::encodeString(m_clientKexInitPayload));
     printData("Server payload", AbstractSshPacket::encodeString(m_serverKexInitPayload));
     printData("K_S", reply.k_s);
-    printData("y", AbstractSshPacket::encodeMpInt(m_dhKey->get_y()));
-    printData("f", AbstractSshPacket::encodeMpInt(reply.f));
+    if (isEcdhKeyExchangeAlgo(m_kexAlgo)) {
+        printData("Q_C", m_clientQ);
+        printData("Q_S", reply.q_s);
+    } else {
+        printData("y", AbstractSshPacket::encodeMpInt(m_dhKey->get_y()));
+        printData("f", AbstractSshPacket::encodeMpInt(reply.f));
+    }
     printData("K", m_k);
     printData("Concatenated data", concatenatedData);
     printData("H", m_h);
 #endif // CREATOR_SSH_DEBUG
 
     QScopedPointer<Public_Key> sigKey;
-    QScopedPointer<PK_Verifier> verifier;
-    if (m_serverHostKeyAlgo == SshCapabilities::PubKeyDss) {
-        const DL_Group group(reply.parameters.at(0), reply.parameters.at(1),
-            reply.parameters.at(2));
-        DSA_PublicKey * const dsaKey
-            = new DSA_PublicKey(group, reply.parameters.at(3));
-        sigKey.reset(dsaKey);
-        verifier.reset(new PK_Verifier(*dsaKey, botanEmsaAlgoName(SshCapabilities::PubKeyDss)));
-    } else if (m_serverHostKeyAlgo == SshCapabilities::PubKeyRsa) {
-        RSA_PublicKey * const rsaKey
-            = new RSA_PublicKey(reply.parameters.at(1), reply.parameters.at(0));
-        sigKey.reset(rsaKey);
-        verifier.reset(new PK_Verifier(*rsaKey, botanEmsaAlgoName(SshCapabilities::PubKeyRsa)));
-    } else {
-        Q_ASSERT(!"Impossible: Neither DSS nor RSA!");
+    bool signatureOk;
+    try {
+        if (m_serverHostKeyAlgo == SshCapabilities::PubKeyDss) {
+            const DL_Group group(reply.parameters.at(0), reply.parameters.at(1),
+                reply.parameters.at(2));
+            sigKey.reset(new DSA_PublicKey(group, reply.parameters.at(3)));
+        } else if (m_serverHostKeyAlgo == SshCapabilities::PubKeyRsa) {
+            sigKey.reset(new RSA_PublicKey(reply.parameters.at(1), reply.parameters.at(0)));
+        } else if (m_serverHostKeyAlgo == SshCapabilities::PubKeyEd25519) {
+            sigKey.reset(new Ed25519_PublicKey(std::vector<byte>(reply.hostKey.constBegin(),
+                reply.hostKey.constEnd())));
+        } else if (m_serverHostKeyAlgo == SshCapabilities::PubKeyEcdsaNistp256) {
+            const EC_Group &group = nistP256Group();
+            sigKey.reset(new ECDSA_PublicKey(group, OS2ECP(convertByteArray(reply.hostKey),
+                reply.hostKey.size(), group.get_curve())));
+        } else {
+            Q_ASSERT(!"Impossible: Unknown host key algorithm!");
+        }
+        const QByteArray signature
+            = SshKeyEncoding::botanSignature(m_serverHostKeyAlgo, reply.signatureBlob);
+        PK_Verifier verifier(*sigKey, botanEmsaAlgoName(m_serverHostKeyAlgo));
+        signatureOk = verifier.verify_message(convertByteArray(m_h), m_h.size(),
+            convertByteArray(signature), signature.size());
+    } catch (const Botan::Exception &) {
+        throw SSH_SERVER_EXCEPTION(SSH_DISCONNECT_KEY_EXCHANGE_FAILED,
+            "Server sent invalid host key.");
     }
-    const byte * const botanH = convertByteArray(m_h);
-    const Botan::byte * const botanSig
-        = convertByteArray(reply.signatureBlob);
-    if (!verifier->verify_message(botanH, m_h.size(), botanSig,
-        reply.signatureBlob.size())) {
+    if (!signatureOk) {
         throw SSH_SERVER_EXCEPTION(SSH_DISCONNECT_KEY_EXCHANGE_FAILED,
             "Invalid signature in SSH_MSG_KEXDH_REPLY packet.");
     }
@@ -219,5 +288,25 @@ void SshKeyExchange::sendNewKeysPacket(const SshIncomingPacket &dhReply,
     m_sendFacility.sendNewKeysPacket();
 }
 
+BigInt SshKeyExchange::ecdhSharedSecret(const QByteArray &serverQ) const
+{
+    try {
+        PK_Key_Agreement agreement(*m_ecdhKey, keyExchangeRng(), "Raw");
+        const secure_vector<byte> &secret
+            = agreement.derive_key(0, convertByteArray(serverQ), serverQ.size()).bits_of();
+
+        // A low-order point on curve25519 yields an all-zero result (RFC 8731).
+        byte orBits = 0;
+        for (size_t i = 0; i < secret.size(); ++i)
+            orBits |= secret[i];
+        if (orBits == 0)
+            throw Decoding_Error("Degenerate shared secret");
+        return BigInt::decode(secret);
+    } catch (const Botan::Exception &) {
+        throw SSH_SERVER_EXCEPTION(SSH_DISCONNECT_KEY_EXCHANGE_FAILED,
+            "Server sent invalid ECDH public key.");
+    }
+}
+
 } // namespace Internal
 } // namespace QSsh
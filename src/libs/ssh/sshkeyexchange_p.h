@@ -31,12 +31,17 @@
 #ifndef SSHKEYEXCHANGE_P_H
 #define SSHKEYEXCHANGE_P_H
 
+#include "sshconnection.h"
+
 #include <QByteArray>
+#include <QList>
 #include <QScopedPointer>
 
 namespace Botan {
+class BigInt;
 class DH_PrivateKey;
 class HashFunction;
+class PK_Key_Agreement_Key;
 }
 
 namespace QSsh {
@@ -48,7 +53,8 @@ class SshIncomingPacket;
 class SshKeyExchange
 {
 public:
-    SshKeyExchange(SshSendFacility &sendFacility);
+    SshKeyExchange(const SshConnectionParameters &connParams,
+        SshSendFacility &sendFacility);
     ~SshKeyExchange();
 
     void sendKexInitPacket(const QByteArray &serverId);
@@ -66,12 +72,21 @@ public:
     QByteArray decryptionAlgo() const { return m_decryptionAlgo; }
     QByteArray hMacAlgoClientToServer() const { return m_c2sHMacAlgo; }
     QByteArray hMacAlgoServerToClient() const { return m_s2cHMacAlgo; }
+    QByteArray compressionAlgoClientToServer() const { return m_c2sCompressionAlgo; }
+    QByteArray compressionAlgoServerToClient() const { return m_s2cCompressionAlgo; }
 
 private:
+    QList<QByteArray> compressionAlgorithms() const;
+    Botan::BigInt ecdhSharedSecret(const QByteArray &serverQ) const;
+
+    const SshConnectionParameters m_connParams;
     QByteArray m_serverId;
     QByteArray m_clientKexInitPayload;
     QByteArray m_serverKexInitPayload;
+    QByteArray m_kexAlgo;
     QScopedPointer<Botan::DH_PrivateKey> m_dhKey;
+    QScopedPointer<Botan::PK_Key_Agreement_Key> m_ecdhKey;
+    QByteArray m_clientQ;
     QByteArray m_k;
     QByteArray m_h;
     QByteArray m_serverHostKeyAlgo;
@@ -79,6 +94,8 @@ private:
     QByteArray m_decryptionAlgo;
     QByteArray m_c2sHMacAlgo;
     QByteArray m_s2cHMacAlgo;
+    QByteArray m_c2sCompressionAlgo;
+    QByteArray m_s2cCompressionAlgo;
     QScopedPointer<Botan::HashFunction> m_hash;
     SshSendFacility &m_sendFacility;
 };
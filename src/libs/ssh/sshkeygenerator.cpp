@@ -32,10 +32,13 @@
 
 #include "sshbotanconversions_p.h"
 #include "sshcapabilities_p.h"
+#include "sshkeyencoding_p.h"
 #include "sshpacket_p.h"
 
 #include <botan/rsa.h>
 #include <botan/dsa.h>
+#include <botan/ecdsa.h>
+#include <botan/ed25519.h>
 #include <botan/auto_rng.h>
 #include <botan/pipe.h>
 #include <botan/pkcs8.h>
@@ -53,6 +56,15 @@ namespace QSsh {
 using namespace Botan;
 using namespace Internal;
 
+namespace {
+
+QByteArray keyComment()
+{
+    return "QtCreator/" + QDateTime::currentDateTime().toString(Qt::ISODate).toUtf8();
+}
+
+} // anonymous namespace
+
 SshKeyGenerator::SshKeyGenerator() : m_type(Rsa)
 {
 }
@@ -66,16 +78,26 @@ bool SshKeyGenerator::generateKeys(KeyType type, PrivateKeyFormat format, int ke
     try {
         AutoSeeded_RNG rng;
         KeyPtr key;
-        if (m_type == Rsa)
+        switch (m_type) {
+        case Rsa:
             key = KeyPtr(new RSA_PrivateKey(rng, keySize));
-        else
+            break;
+        case Dsa:
             key = KeyPtr(new DSA_PrivateKey(rng, DL_Group(rng, DL_Group::DSA_Kosherizer, keySize)));
+            break;
+        case Ecdsa:
+            key = KeyPtr(new ECDSA_PrivateKey(rng, EC_Group("secp256r1")));
+            break;
+        case Ed25519:
+            key = KeyPtr(new Ed25519_PrivateKey(rng));
+            break;
+        }
         switch (format) {
         case Pkcs8:
             generatePkcs8KeyStrings(key, rng);
             break;
         case OpenSsl:
-            generateOpenSslKeyStrings(key);
+            generateOpenSslKeyStrings(key, rng);
             break;
         case Mixed:
         default:
@@ -120,37 +142,29 @@ void SshKeyGenerator::generatePkcs8KeyString(const KeyPtr &key, bool privateKey,
         pipe.message_count() - 1);
 }
 
-void SshKeyGenerator::generateOpenSslKeyStrings(const KeyPtr &key)
+void SshKeyGenerator::generateOpenSslKeyStrings(const KeyPtr &key,
+    Botan::RandomNumberGenerator &rng)
 {
     generateOpenSslPublicKeyString(key);
-    generateOpenSslPrivateKeyString(key);
+    generateOpenSslPrivateKeyString(key, rng);
 }
 
 void SshKeyGenerator::generateOpenSslPublicKeyString(const KeyPtr &key)
 {
-    QList<BigInt> params;
-    QByteArray keyId;
-    if (m_type == Rsa) {
-        const QSharedPointer<RSA_PrivateKey> rsaKey = key.dynamicCast<RSA_PrivateKey>();
-        params << rsaKey->get_e() << rsaKey->get_n();
-        keyId = SshCapabilities::PubKeyRsa;
-    } else {
-        const QSharedPointer<DSA_PrivateKey> dsaKey = key.dynamicCast<DSA_PrivateKey>();
-        params << dsaKey->group_p() << dsaKey->group_q() << dsaKey->group_g() << dsaKey->get_y();
-        keyId = SshCapabilities::PubKeyDss;
-    }
-
-    QByteArray publicKeyBlob = AbstractSshPacket::encodeString(keyId);
-    foreach (const BigInt &b, params)
-        publicKeyBlob += AbstractSshPacket::encodeMpInt(b);
-    publicKeyBlob = publicKeyBlob.toBase64();
-    const QByteArray id = "QtCreator/"
-        + QDateTime::currentDateTime().toString(Qt::ISODate).toUtf8();
-    m_publicKey = keyId + ' ' + publicKeyBlob + ' ' + id;
+    const QByteArray keyId = SshKeyEncoding::algorithmName(*key);
+    const QByteArray publicKeyBlob = SshKeyEncoding::publicKeyBlob(*key).toBase64();
+    m_publicKey = keyId + ' ' + publicKeyBlob + ' ' + keyComment();
 }
 
-void SshKeyGenerator::generateOpenSslPrivateKeyString(const KeyPtr &key)
+void SshKeyGenerator::generateOpenSslPrivateKeyString(const KeyPtr &key,
+    Botan::RandomNumberGenerator &rng)
 {
+    // There is no PEM format for Ed25519 keys, and OpenSSH uses its own for ECDSA keys, too.
+    if (m_type == Ecdsa || m_type == Ed25519) {
+        m_privateKey = SshKeyEncoding::encodeOpenSshPrivateKey(*key, keyComment(), rng);
+        return;
+    }
+
     QList<BigInt> params;
     QByteArray keyId;
     const char *label;
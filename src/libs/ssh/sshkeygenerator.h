@@ -47,11 +47,14 @@ class QSSH_EXPORT SshKeyGenerator
 {
     Q_DECLARE_TR_FUNCTIONS(SshKeyGenerator)
 public:
-    enum KeyType { Rsa, Dsa };
+    enum KeyType { Rsa, Dsa, Ecdsa, Ed25519 };
     enum PrivateKeyFormat { Pkcs8, OpenSsl, Mixed };
     enum EncryptionMode { DoOfferEncryption, DoNotOfferEncryption }; // Only relevant for Pkcs8 format.
 
     SshKeyGenerator();
+
+    // keySize is ignored for Ecdsa (always nistp256) and Ed25519.
+    // In OpenSsl format, these two are written in OpenSSH's own private key format.
     bool generateKeys(KeyType type, PrivateKeyFormat format, int keySize,
         EncryptionMode encryptionMode = DoOfferEncryption);
 
@@ -66,8 +69,8 @@ private:
     void generatePkcs8KeyStrings(const KeyPtr &key, Botan::RandomNumberGenerator &rng);
     void generatePkcs8KeyString(const KeyPtr &key, bool privateKey,
         Botan::RandomNumberGenerator &rng);
-    void generateOpenSslKeyStrings(const KeyPtr &key);
-    void generateOpenSslPrivateKeyString(const KeyPtr &key);
+    void generateOpenSslKeyStrings(const KeyPtr &key, Botan::RandomNumberGenerator &rng);
+    void generateOpenSslPrivateKeyString(const KeyPtr &key, Botan::RandomNumberGenerator &rng);
     void generateOpenSslPublicKeyString(const KeyPtr &key);
     QString getPassword() const;
 
@@ -31,6 +31,8 @@
 #include "sshoutgoingpacket_p.h"
 
 #include "sshcapabilities_p.h"
+#include "sshcompressionfacility_p.h"
+#include "sshcopycount_p.h"
 #include "sshcryptofacility_p.h"
 
 #include <QtEndian>
@@ -39,7 +41,9 @@ namespace QSsh {
 namespace Internal {
 
 SshOutgoingPacket::SshOutgoingPacket(const SshEncryptionFacility &encrypter,
-    const quint32 &seqNr) : m_encrypter(encrypter), m_seqNr(seqNr)
+    SshCompressionFacility &compressor, const quint32 &seqNr)
+    : m_encrypter(encrypter), m_compressor(compressor), m_seqNr(seqNr),
+      m_keyExchangeInProgress(false), m_heldBack(false)
 {
 }
 
@@ -53,7 +57,12 @@ quint32 SshOutgoingPacket::macLength() const
     return m_encrypter.macLength();
 }
 
-QByteArray SshOutgoingPacket::generateKeyExchangeInitPacket()
+quint32 SshOutgoingPacket::aadLength() const
+{
+    return m_encrypter.aadLength();
+}
+
+QByteArray SshOutgoingPacket::generateKeyExchangeInitPacket(const QList<QByteArray> &compressionAlgorithms)
 {
     const QByteArray &supportedkeyExchangeMethods
         = encodeNameList(SshCapabilities::KeyExchangeMethods);
@@ -64,7 +73,7 @@ QByteArray SshOutgoingPacket::generateKeyExchangeInitPacket()
     const QByteArray &supportedMacAlgorithms
         = encodeNameList(SshCapabilities::MacAlgorithms);
     const QByteArray &supportedCompressionAlgorithms
-        = encodeNameList(SshCapabilities::CompressionAlgorithms);
+        = encodeNameList(compressionAlgorithms);
     const QByteArray &supportedLanguages = encodeNameList(QList<QByteArray>());
 
     init(SSH_MSG_KEXINIT);
@@ -89,6 +98,11 @@ void SshOutgoingPacket::generateKeyDhInitPacket(const Botan::BigInt &e)
     init(SSH_MSG_KEXDH_INIT).appendMpInt(e).finalize();
 }
 
+void SshOutgoingPacket::generateKeyEcdhInitPacket(const QByteArray &clientQ)
+{
+    init(SSH_MSG_KEX_ECDH_INIT).appendString(clientQ).finalize();
+}
+
 void SshOutgoingPacket::generateNewKeysPacket()
 {
     init(SSH_MSG_NEWKEYS).finalize();
@@ -200,8 +214,13 @@ void SshOutgoingPacket::generateWindowAdjustPacket(quint32 remoteChannel,
 void SshOutgoingPacket::generateChannelDataPacket(quint32 remoteChannel,
     const QByteArray &data)
 {
+    // Make room for the complete packet up front, so that the payload is copied
+    // exactly once and neither the padding nor the MAC cause a reallocation.
+    reserve(PayloadOffset + 1 + 4 + 4 + data.size());
+    QSSH_COUNT_BUFFER_MOVES(m_data);
     init(SSH_MSG_CHANNEL_DATA).appendInt(remoteChannel).appendString(data)
         .finalize();
+    QSSH_COUNT_COPY(data.size());
 }
 
 void SshOutgoingPacket::generateChannelSignalPacket(quint32 remoteChannel,
@@ -234,9 +253,18 @@ void SshOutgoingPacket::generateMsgUnimplementedPacket(quint32 serverSeqNr)
     init(SSH_MSG_UNIMPLEMENTED).appendInt(serverSeqNr).finalize();
 }
 
+void SshOutgoingPacket::generatePacketFromPayload(const QByteArray &payload)
+{
+    m_data.resize(PayloadOffset);
+    m_data.append(payload);
+    finalize();
+}
+
 SshOutgoingPacket &SshOutgoingPacket::appendInt(quint32 val)
 {
-    m_data.append(encodeInt(val));
+    const int oldSize = m_data.size();
+    m_data.resize(oldSize + 4);
+    qToBigEndian(val, reinterpret_cast<uchar *>(m_data.data() + oldSize));
     return *this;
 }
 
@@ -254,7 +282,8 @@ SshOutgoingPacket &SshOutgoingPacket::appendBool(bool b)
 
 SshOutgoingPacket &SshOutgoingPacket::appendString(const QByteArray &string)
 {
-    m_data.append(encodeString(string));
+    appendInt(string.size());
+    m_data.append(string);
     return *this;
 }
 
@@ -267,27 +296,35 @@ SshOutgoingPacket &SshOutgoingPacket::init(SshPacketType type)
 
 SshOutgoingPacket &SshOutgoingPacket::setPadding()
 {
-    m_data += m_encrypter.getRandomNumbers(MinPaddingLength);
-    int padLength = MinPaddingLength;
     const int divisor = sizeDivisor();
-    const int mod = m_data.size() % divisor;
-    padLength += divisor - mod;
-    m_data += m_encrypter.getRandomNumbers(padLength - MinPaddingLength);
+    const int mod = (m_data.size() + MinPaddingLength - aadLength()) % divisor;
+    const int padLength = MinPaddingLength + divisor - mod;
+    const int oldSize = m_data.size();
+    m_data.resize(oldSize + padLength);
+    m_encrypter.fillWithRandomNumbers(m_data.data() + oldSize, padLength);
     m_data[PaddingLengthOffset] = padLength;
     return *this;
 }
 
 SshOutgoingPacket &SshOutgoingPacket::encrypt()
 {
-    const QByteArray &mac
-        = generateMac(m_encrypter, m_seqNr);
-    m_encrypter.encrypt(m_data);
-    m_data += mac;
+    m_encrypter.encryptPacket(m_data, m_seqNr);
     return *this;
 }
 
 void SshOutgoingPacket::finalize()
 {
+    m_heldBack = m_keyExchangeInProgress && !isAllowedDuringKeyExchange();
+    if (m_heldBack) {
+#ifdef CREATOR_SSH_DEBUG
+        qDebug("Holding back packet of type %u during key exchange",
+            static_cast<quint8>(m_data.at(TypeOffset)));
+#endif
+        return;
+    }
+
+    if (m_compressor.isActive())
+        m_compressor.compress(m_data, PayloadOffset);
     setPadding();
     setLengthField(m_data);
     m_length = m_data.size() - 4;
@@ -301,6 +338,18 @@ void SshOutgoingPacket::finalize()
     Q_ASSERT(isComplete());
 }
 
+bool SshOutgoingPacket::isAllowedDuringKeyExchange() const
+{
+    const quint8 type = m_data.at(TypeOffset);
+    return type < SSH_MSG_USERAUTH_REQUEST && type != SSH_MSG_SERVICE_REQUEST
+        && type != SSH_MSG_SERVICE_ACCEPT;
+}
+
+void SshOutgoingPacket::reserve(int payloadEnd)
+{
+    m_data.reserve(payloadEnd + MinPaddingLength + sizeDivisor() + macLength());
+}
+
 int SshOutgoingPacket::sizeDivisor() const
 {
     return qMax(cipherBlockSize(), 8U);
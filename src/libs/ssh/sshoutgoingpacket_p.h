@@ -38,16 +38,19 @@
 namespace QSsh {
 namespace Internal {
 
+class SshCompressionFacility;
 class SshEncryptionFacility;
 
 class SshOutgoingPacket : public AbstractSshPacket
 {
 public:
     SshOutgoingPacket(const SshEncryptionFacility &encrypter,
-        const quint32 &seqNr);
+        SshCompressionFacility &compressor, const quint32 &seqNr);
 
-    QByteArray generateKeyExchangeInitPacket(); // Returns payload.
+    // Returns payload.
+    QByteArray generateKeyExchangeInitPacket(const QList<QByteArray> &compressionAlgorithms);
     void generateKeyDhInitPacket(const Botan::BigInt &e);
+    void generateKeyEcdhInitPacket(const QByteArray &clientQ);
     void generateNewKeysPacket();
     void generateDisconnectPacket(SshErrorCode reason,
         const QByteArray &reasonString);
@@ -76,10 +79,21 @@ public:
         const QByteArray &signalName);
     void generateChannelEofPacket(quint32 remoteChannel);
     void generateChannelClosePacket(quint32 remoteChannel);
+    void generatePacketFromPayload(const QByteArray &payload);
+
+    // RFC 4253, 7.1: Between sending KEXINIT and NEWKEYS, only transport layer
+    // messages may be sent. While a key exchange is in progress, all other packets
+    // are left unencrypted; the caller is supposed to put their payload aside
+    // and send it later via generatePacketFromPayload().
+    void setKeyExchangeInProgress(bool inProgress) { m_keyExchangeInProgress = inProgress; }
+    bool isKeyExchangeInProgress() const { return m_keyExchangeInProgress; }
+    bool isHeldBack() const { return m_heldBack; }
+    QByteArray payload() const { return m_data.mid(PayloadOffset); }
 
 private:
     virtual quint32 cipherBlockSize() const;
     virtual quint32 macLength() const;
+    virtual quint32 aadLength() const;
 
     static QByteArray encodeNameList(const QList<QByteArray> &list);
 
@@ -89,15 +103,20 @@ private:
     SshOutgoingPacket &setPadding();
     SshOutgoingPacket &encrypt();
     void finalize();
+    bool isAllowedDuringKeyExchange() const;
 
     SshOutgoingPacket &appendInt(quint32 val);
     SshOutgoingPacket &appendString(const QByteArray &string);
     SshOutgoingPacket &appendMpInt(const Botan::BigInt &number);
     SshOutgoingPacket &appendBool(bool b);
     int sizeDivisor() const;
+    void reserve(int payloadEnd);
 
     const SshEncryptionFacility &m_encrypter;
+    SshCompressionFacility &m_compressor;
     const quint32 &m_seqNr;
+    bool m_keyExchangeInProgress;
+    bool m_heldBack;
 };
 
 } // namespace Internal
@@ -31,7 +31,6 @@
 #include "sshpacket_p.h"
 
 #include "sshcapabilities_p.h"
-#include "sshcryptofacility_p.h"
 #include "sshexception_p.h"
 #include "sshpacketparser_p.h"
 
@@ -66,7 +65,8 @@ AbstractSshPacket::~AbstractSshPacket() {}
 
 bool AbstractSshPacket::isComplete() const
 {
-    if (currentDataSize() < minPacketSize())
+    // Not minPacketSize(): A decompressed packet can be smaller than that.
+    if (currentDataSize() < 4)
         return false;
     return 4 + length() + macLength() == currentDataSize();
 }
@@ -125,7 +125,7 @@ QByteArray AbstractSshPacket::encodeMpInt(const Botan::BigInt &number)
 
 int AbstractSshPacket::paddingLength() const
 {
-    return m_data[PaddingLengthOffset];
+    return static_cast<quint8>(m_data.at(PaddingLengthOffset));
 }
 
 quint32 AbstractSshPacket::length() const
@@ -141,17 +141,11 @@ void AbstractSshPacket::calculateLength() const
     m_length = SshPacketParser::asUint32(m_data, static_cast<quint32>(0));
 }
 
-QByteArray AbstractSshPacket::generateMac(const SshAbstractCryptoFacility &crypt,
-    quint32 seqNr) const
-{
-    const quint32 seqNrBe = qToBigEndian(seqNr);
-    QByteArray data(reinterpret_cast<const char *>(&seqNrBe), sizeof seqNrBe);
-    data += QByteArray(m_data.constData(), length() + 4);
-    return crypt.generateMac(data, data.size());
-}
-
 quint32 AbstractSshPacket::minPacketSize() const
 {
+    // With AEAD ciphers, the length field is not part of the block-aligned data.
+    if (aadLength() > 0)
+        return aadLength() + qMax<quint32>(cipherBlockSize(), 8) + macLength();
     return qMax<quint32>(cipherBlockSize(), 16) + macLength();
 }
 
@@ -54,6 +54,8 @@ enum SshPacketType {
     SSH_MSG_NEWKEYS = 21,
     SSH_MSG_KEXDH_INIT = 30,
     SSH_MSG_KEXDH_REPLY = 31,
+    SSH_MSG_KEX_ECDH_INIT = 30,
+    SSH_MSG_KEX_ECDH_REPLY = 31,
 
     SSH_MSG_USERAUTH_REQUEST = 50,
     SSH_MSG_USERAUTH_FAILURE = 51,
@@ -66,8 +68,7 @@ enum SshPacketType {
     SSH_MSG_REQUEST_SUCCESS = 81,
     SSH_MSG_REQUEST_FAILURE = 82,
 
-    // TODO: We currently take no precautions against sending these messages
-    //       during a key re-exchange, which is not allowed.
+    // SshSendFacility holds these back during a key re-exchange.
     SSH_MSG_CHANNEL_OPEN = 90,
     SSH_MSG_CHANNEL_OPEN_CONFIRMATION = 91,
     SSH_MSG_CHANNEL_OPEN_FAILURE = 92,
@@ -88,8 +89,6 @@ enum SshPacketType {
 
 enum SshExtendedDataType { SSH_EXTENDED_DATA_STDERR = 1 };
 
-class SshAbstractCryptoFacility;
-
 class AbstractSshPacket
 {
 public:
@@ -120,14 +119,13 @@ protected:
 
     virtual quint32 cipherBlockSize() const = 0;
     virtual quint32 macLength() const = 0;
+    virtual quint32 aadLength() const = 0;
     virtual void calculateLength() const;
 
     quint32 length() const;
     int paddingLength() const;
     quint32 minPacketSize() const;
     quint32 currentDataSize() const { return m_data.size(); }
-    QByteArray generateMac(const SshAbstractCryptoFacility &crypt,
-        quint32 seqNr) const;
 
     static const quint32 PaddingLengthOffset;
     static const quint32 PayloadOffset;
@@ -113,6 +113,17 @@ QByteArray SshPacketParser::asString(const QByteArray &data, quint32 *offset)
     return string;
 }
 
+QByteArray SshPacketParser::asRawString(const QByteArray &data, quint32 *offset)
+{
+    const quint32 length = asUint32(data, offset);
+    // asUint32() has made sure that *offset <= size(data); *offset + length could wrap.
+    if (length > size(data) - *offset)
+        throw SshPacketParseException();
+    const QByteArray string = QByteArray::fromRawData(data.constData() + *offset, length);
+    *offset += length;
+    return string;
+}
+
 QString SshPacketParser::asUserString(const QByteArray &data, quint32 *offset)
 {
     return asUserString(asString(data, offset));
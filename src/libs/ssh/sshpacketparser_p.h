@@ -69,6 +69,9 @@ public:
     static quint32 asUint32(const QByteArray &data, quint32 offset);
     static quint32 asUint32(const QByteArray &data, quint32 *offset);
     static QByteArray asString(const QByteArray &data, quint32 *offset);
+
+    // Like asString(), but the result refers to the memory of data instead of copying it.
+    static QByteArray asRawString(const QByteArray &data, quint32 *offset);
     static QString asUserString(const QByteArray &data, quint32 *offset);
     static SshNameList asNameList(const QByteArray &data, quint32 *offset);
     static Botan::BigInt asBigInt(const QByteArray &data, quint32 *offset);
@@ -0,0 +1,89 @@
+/**************************************************************************
+**
+** This file is part of Qt Creator
+**
+** Copyright (c) 2012 Nokia Corporation and/or its subsidiary(-ies).
+**
+** Contact: http://www.qt-project.org/
+**
+**
+** GNU Lesser General Public License Usage
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.LGPL included in the packaging of this file.
+** Please review the following information to ensure the GNU Lesser General
+** Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights. These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** Other Usage
+**
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and Nokia.
+**
+**
+**************************************************************************/
+
+#include "sshrandompool_p.h"
+
+#include <botan/rng.h>
+
+#include <cstring>
+
+namespace QSsh {
+namespace Internal {
+
+namespace {
+const int PoolSize = 4096;
+bool poolEnabled = true;
+} // anonymous namespace
+
+SshRandomPool::SshRandomPool(Botan::RandomNumberGenerator &rng)
+    : m_rng(rng), m_pool(PoolSize), m_pos(PoolSize)
+{
+}
+
+void SshRandomPool::fill(char *data, int count)
+{
+    if (!poolEnabled) {
+        m_rng.randomize(reinterpret_cast<Botan::byte *>(data), count);
+        return;
+    }
+    while (count > 0) {
+        if (m_pos == PoolSize)
+            refill();
+        const int chunkSize = qMin(count, PoolSize - m_pos);
+        std::memcpy(data, m_pool.data() + m_pos, chunkSize);
+
+        // Handed-out bytes must not linger in the pool.
+        std::memset(m_pool.data() + m_pos, 0, chunkSize);
+        m_pos += chunkSize;
+        data += chunkSize;
+        count -= chunkSize;
+    }
+}
+
+QByteArray SshRandomPool::randomBytes(int count)
+{
+    QByteArray data(count, Qt::Uninitialized);
+    fill(data.data(), count);
+    return data;
+}
+
+void SshRandomPool::setEnabled(bool enabled)
+{
+    poolEnabled = enabled;
+}
+
+void SshRandomPool::refill()
+{
+    m_rng.randomize(m_pool.data(), m_pool.size());
+    m_pos = 0;
+}
+
+} // namespace Internal
+} // namespace QSsh
@@ -0,0 +1,71 @@
+/**************************************************************************
+**
+** This file is part of Qt Creator
+**
+** Copyright (c) 2012 Nokia Corporation and/or its subsidiary(-ies).
+**
+** Contact: http://www.qt-project.org/
+**
+**
+** GNU Lesser General Public License Usage
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.LGPL included in the packaging of this file.
+** Please review the following information to ensure the GNU Lesser General
+** Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights. These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** Other Usage
+**
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and Nokia.
+**
+**
+**************************************************************************/
+
+#ifndef SSHRANDOMPOOL_P_H
+#define SSHRANDOMPOOL_P_H
+
+#include <botan/secmem.h>
+
+#include <QByteArray>
+
+namespace Botan { class RandomNumberGenerator; }
+
+namespace QSsh {
+namespace Internal {
+
+/*
+ * Hands out random bytes from a buffer that is refilled from the RNG in
+ * large blocks, so that small requests like packet padding neither go to
+ * the RNG nor allocate. Every byte is handed out only once.
+ */
+class SshRandomPool
+{
+public:
+    explicit SshRandomPool(Botan::RandomNumberGenerator &rng);
+
+    void fill(char *data, int count);
+    QByteArray randomBytes(int count);
+
+    // Only meant for measuring what the pool saves. While disabled, every
+    // request goes to the RNG directly.
+    static void setEnabled(bool enabled);
+
+private:
+    void refill();
+
+    Botan::RandomNumberGenerator &m_rng;
+    Botan::secure_vector<Botan::byte> m_pool;
+    int m_pos;
+};
+
+} // namespace Internal
+} // namespace QSsh
+
+#endif // SSHRANDOMPOOL_P_H
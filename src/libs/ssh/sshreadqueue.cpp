@@ -0,0 +1,168 @@
+/**************************************************************************
+**
+** This file is part of Qt Creator
+**
+** Copyright (c) 2012 Nokia Corporation and/or its subsidiary(-ies).
+**
+** Contact: http://www.qt-project.org/
+**
+**
+** GNU Lesser General Public License Usage
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.LGPL included in the packaging of this file.
+** Please review the following information to ensure the GNU Lesser General
+** Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights. These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** Other Usage
+**
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and Nokia.
+**
+**
+**************************************************************************/
+
+#include "sshreadqueue_p.h"
+
+#include <cstring>
+
+namespace QSsh {
+namespace Internal {
+
+SshReadQueue::SshReadQueue() : m_headOffset(0), m_size(0), m_scannedFor(0), m_scannedBytes(0)
+{
+}
+
+void SshReadQueue::append(const QByteArray &chunk)
+{
+    if (chunk.isEmpty())
+        return;
+    m_chunks << chunk;
+    m_size += chunk.size();
+}
+
+qint64 SshReadQueue::read(char *data, qint64 maxSize)
+{
+    qint64 bytesRead = 0;
+    while (bytesRead < maxSize && !m_chunks.isEmpty()) {
+        const QByteArray &chunk = m_chunks.first();
+        const int bytesFromChunk
+            = int(qMin<qint64>(maxSize - bytesRead, chunk.size() - m_headOffset));
+        std::memcpy(data + bytesRead, chunk.constData() + m_headOffset, bytesFromChunk);
+        bytesRead += bytesFromChunk;
+        m_headOffset += bytesFromChunk;
+        if (m_headOffset == chunk.size()) {
+            m_chunks.removeFirst();
+            m_headOffset = 0;
+        }
+    }
+    m_size -= bytesRead;
+    dropScannedBytes(bytesRead);
+    return bytesRead;
+}
+
+QByteArray SshReadQueue::readChunk()
+{
+    if (m_chunks.isEmpty())
+        return QByteArray();
+    QByteArray chunk = m_chunks.takeFirst();
+    if (m_headOffset > 0) {
+        // Only if read() was used before.
+        chunk = chunk.mid(m_headOffset);
+        m_headOffset = 0;
+    }
+    m_size -= chunk.size();
+    dropScannedBytes(chunk.size());
+    return chunk;
+}
+
+QByteArray SshReadQueue::readAll()
+{
+    if (m_chunks.count() <= 1)
+        return readChunk();
+    QByteArray data(int(m_size), Qt::Uninitialized);
+    read(data.data(), data.size());
+    return data;
+}
+
+bool SshReadQueue::contains(char c)
+{
+    if (c != m_scannedFor) {
+        m_scannedFor = c;
+        m_scannedBytes = 0;
+    }
+
+    qint64 chunkStart = 0; // Relative to the read position.
+    for (int i = 0; i < m_chunks.count(); ++i) {
+        const QByteArray &chunk = m_chunks.at(i);
+        const int offset = i == 0 ? m_headOffset : 0;
+        const qint64 chunkEnd = chunkStart + chunk.size() - offset;
+        if (chunkEnd > m_scannedBytes) {
+            const int scanStart = offset + int(m_scannedBytes - qMin(m_scannedBytes, chunkStart));
+            const char * const match = static_cast<const char *>(std::memchr(
+                chunk.constData() + scanStart, c, chunk.size() - scanStart));
+            if (match) {
+                m_scannedBytes = chunkStart + (match - chunk.constData()) - offset;
+                return true;
+            }
+            m_scannedBytes = chunkEnd;
+        }
+        chunkStart = chunkEnd;
+    }
+    return false;
+}
+
+void SshReadQueue::clear()
+{
+    m_chunks.clear();
+    m_headOffset = 0;
+    m_size = 0;
+    m_scannedBytes = 0;
+}
+
+void SshReadQueue::dropScannedBytes(qint64 count)
+{
+    m_scannedBytes -= qMin(m_scannedBytes, count);
+}
+
+
+void SshRecordSplitter::split(const QByteArray &data, QList<QByteArray> *records)
+{
+    const char *recordStart = data.constData();
+    const char * const end = recordStart + data.size();
+    while (const char * const recordEnd = static_cast<const char *>(
+               std::memchr(recordStart, m_delimiter, end - recordStart))) {
+        if (m_incompleteRecord.isEmpty()) {
+            records->append(QByteArray(recordStart, recordEnd - recordStart));
+        } else {
+            m_incompleteRecord.append(recordStart, recordEnd - recordStart);
+            records->append(m_incompleteRecord);
+            m_incompleteRecord.clear();
+        }
+        recordStart = recordEnd + 1;
+    }
+    if (recordStart < end)
+        m_incompleteRecord.append(recordStart, end - recordStart);
+
+    // Otherwise, output that never contains the delimiter would pile up here.
+    while (m_incompleteRecord.size() >= MaxRecordSize) {
+        records->append(m_incompleteRecord.left(MaxRecordSize));
+        m_incompleteRecord.remove(0, MaxRecordSize);
+    }
+}
+
+QByteArray SshRecordSplitter::takeIncompleteRecord()
+{
+    const QByteArray record = m_incompleteRecord;
+    m_incompleteRecord.clear();
+    return record;
+}
+
+} // namespace Internal
+} // namespace QSsh
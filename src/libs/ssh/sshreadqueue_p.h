@@ -0,0 +1,103 @@
+/**************************************************************************
+**
+** This file is part of Qt Creator
+**
+** Copyright (c) 2012 Nokia Corporation and/or its subsidiary(-ies).
+**
+** Contact: http://www.qt-project.org/
+**
+**
+** GNU Lesser General Public License Usage
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.LGPL included in the packaging of this file.
+** Please review the following information to ensure the GNU Lesser General
+** Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights. These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** Other Usage
+**
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and Nokia.
+**
+**
+**************************************************************************/
+
+#ifndef SSHREADQUEUE_P_H
+#define SSHREADQUEUE_P_H
+
+#include <QByteArray>
+#include <QList>
+
+namespace QSsh {
+namespace Internal {
+
+/*
+ * Data received on a channel that the application has not read yet. It is kept
+ * in the chunks it arrived in, so appending never reallocates and reading never
+ * shifts what is left. readChunk() and readAll() hand out the chunks themselves
+ * where possible, i.e. without copying.
+ */
+class SshReadQueue
+{
+public:
+    SshReadQueue();
+
+    void append(const QByteArray &chunk);
+
+    qint64 read(char *data, qint64 maxSize);
+    QByteArray readChunk();
+    QByteArray readAll();
+
+    // Remembers how far it got, so repeated calls (as from canReadLine()) only
+    // look at data that has arrived since.
+    bool contains(char c);
+    void clear();
+
+    qint64 size() const { return m_size; }
+    bool isEmpty() const { return m_size == 0; }
+
+private:
+    void dropScannedBytes(qint64 count);
+
+    QList<QByteArray> m_chunks;
+    int m_headOffset; // Bytes of the first chunk that have already been read.
+    qint64 m_size;
+    char m_scannedFor;
+    qint64 m_scannedBytes; // From the read position on, known not to contain m_scannedFor.
+};
+
+/*
+ * Splits a stream into records ending with a delimiter. Every byte is looked at
+ * once; an incomplete record is kept until the rest of it arrives, or until it
+ * reaches MaxRecordSize, in which case it is passed on as a record of its own.
+ */
+class SshRecordSplitter
+{
+public:
+    static const int MaxRecordSize = 1024 * 1024;
+
+    SshRecordSplitter() : m_delimiter(0) {}
+
+    char delimiter() const { return m_delimiter; }
+    void setDelimiter(char delimiter) { m_delimiter = delimiter; }
+
+    // Appends the records completed by data to records, without the delimiter.
+    void split(const QByteArray &data, QList<QByteArray> *records);
+
+    QByteArray takeIncompleteRecord();
+
+private:
+    char m_delimiter;
+    QByteArray m_incompleteRecord;
+};
+
+} // namespace Internal
+} // namespace QSsh
+
+#endif // SSHREADQUEUE_P_H
@@ -0,0 +1,106 @@
+/**************************************************************************
+**
+** This file is part of Qt Creator
+**
+** Copyright (c) 2012 Nokia Corporation and/or its subsidiary(-ies).
+**
+** Contact: http://www.qt-project.org/
+**
+**
+** GNU Lesser General Public License Usage
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.LGPL included in the packaging of this file.
+** Please review the following information to ensure the GNU Lesser General
+** Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights. These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** Other Usage
+**
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and Nokia.
+**
+**
+**************************************************************************/
+
+#include "sshreceivebuffer_p.h"
+
+#include <QIODevice>
+
+#include <cstring>
+
+namespace QSsh {
+namespace Internal {
+
+namespace {
+    // Large enough for a full-sized channel data packet plus some readahead.
+    const int InitialCapacity = 64 * 1024;
+} // anonymous namespace
+
+SshReceiveBuffer::SshReceiveBuffer() : m_readPos(0)
+{
+    // Reserving keeps the allocation alive when the buffer runs empty.
+    m_data.reserve(InitialCapacity);
+}
+
+void SshReceiveBuffer::append(const QByteArray &data)
+{
+    compact();
+    m_data.append(data);
+}
+
+qint64 SshReceiveBuffer::readFrom(QIODevice *device)
+{
+    compact();
+    const qint64 bytesAvailable = device->bytesAvailable();
+    if (bytesAvailable <= 0)
+        return 0;
+    const int oldSize = m_data.size();
+    m_data.resize(oldSize + bytesAvailable);
+    const qint64 bytesRead = device->read(m_data.data() + oldSize, bytesAvailable);
+    m_data.resize(oldSize + qMax<qint64>(bytesRead, 0));
+    return bytesRead;
+}
+
+void SshReceiveBuffer::consume(int count)
+{
+    Q_ASSERT(count >= 0 && count <= size());
+    m_readPos += count;
+}
+
+void SshReceiveBuffer::clear()
+{
+    m_data.resize(0);
+    m_readPos = 0;
+}
+
+int SshReceiveBuffer::indexOf(char c) const
+{
+    const void * const pos = std::memchr(constData(), c, size());
+    return pos ? static_cast<const char *>(pos) - constData() : -1;
+}
+
+bool SshReceiveBuffer::startsWith(const QByteArray &prefix) const
+{
+    return size() >= prefix.size()
+        && std::memcmp(constData(), prefix.constData(), prefix.size()) == 0;
+}
+
+void SshReceiveBuffer::compact()
+{
+    if (m_readPos == 0)
+        return;
+    if (m_readPos == m_data.size())
+        m_data.resize(0);
+    else
+        m_data.remove(0, m_readPos);
+    m_readPos = 0;
+}
+
+} // namespace Internal
+} // namespace QSsh
@@ -0,0 +1,81 @@
+/**************************************************************************
+**
+** This file is part of Qt Creator
+**
+** Copyright (c) 2012 Nokia Corporation and/or its subsidiary(-ies).
+**
+** Contact: http://www.qt-project.org/
+**
+**
+** GNU Lesser General Public License Usage
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.LGPL included in the packaging of this file.
+** Please review the following information to ensure the GNU Lesser General
+** Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights. These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** Other Usage
+**
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and Nokia.
+**
+**
+**************************************************************************/
+
+#ifndef SSHRECEIVEBUFFER_P_H
+#define SSHRECEIVEBUFFER_P_H
+
+#include <QByteArray>
+
+QT_BEGIN_NAMESPACE
+class QIODevice;
+QT_END_NAMESPACE
+
+namespace QSsh {
+namespace Internal {
+
+/*
+ * Contiguous buffer for data received from the peer. New data is appended at
+ * the end, complete packets are consumed from the front by advancing a read
+ * position. The consumed bytes are only discarded when new data arrives, so
+ * that the remainder has to be moved at most once per read instead of once
+ * per packet, and packets can be decrypted and parsed right where they are.
+ * Pointers into the buffer stay valid until the next call to append(),
+ * readFrom() or clear().
+ */
+class SshReceiveBuffer
+{
+public:
+    SshReceiveBuffer();
+
+    void append(const QByteArray &data);
+    qint64 readFrom(QIODevice *device);
+    void consume(int count);
+    void clear();
+
+    char *data() { return m_data.data() + m_readPos; }
+    const char *constData() const { return m_data.constData() + m_readPos; }
+    int size() const { return m_data.size() - m_readPos; }
+    bool isEmpty() const { return size() == 0; }
+
+    int indexOf(char c) const;
+    bool startsWith(const QByteArray &prefix) const;
+    QByteArray left(int count) const { return QByteArray(constData(), qMin(count, size())); }
+
+private:
+    void compact();
+
+    QByteArray m_data;
+    int m_readPos;
+};
+
+} // namespace Internal
+} // namespace QSsh
+
+#endif // SSHRECEIVEBUFFER_P_H
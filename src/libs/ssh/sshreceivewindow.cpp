@@ -0,0 +1,203 @@
+/**************************************************************************
+**
+** This file is part of Qt Creator
+**
+** Copyright (c) 2012 Nokia Corporation and/or its subsidiary(-ies).
+**
+** Contact: http://www.qt-project.org/
+**
+**
+** GNU Lesser General Public License Usage
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.LGPL included in the packaging of this file.
+** Please review the following information to ensure the GNU Lesser General
+** Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights. These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** Other Usage
+**
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and Nokia.
+**
+**
+**************************************************************************/
+
+#include "sshreceivewindow_p.h"
+
+#include <QMutex>
+#include <QMutexLocker>
+
+namespace QSsh {
+namespace Internal {
+
+namespace {
+    // Connections can live in different threads.
+    QMutex globalBudgetMutex;
+    quint64 globalLimit = Q_UINT64_C(1) << 30;
+    quint64 globalUsed = 0;
+
+    const qint64 MinSamplePeriod = 50;
+    const qint64 IdleTime = 5000;
+} // anonymous namespace
+
+SshReceiveWindowBudget::SshReceiveWindowBudget(quint64 limit)
+    : m_limit(limit), m_used(0), m_roundTripTime(0)
+{
+}
+
+SshReceiveWindowBudget::~SshReceiveWindowBudget()
+{
+    Q_ASSERT(m_used == 0);
+}
+
+quint32 SshReceiveWindowBudget::acquire(quint32 bytes)
+{
+    QMutexLocker locker(&globalBudgetMutex);
+    const quint64 available = qMin(m_limit - qMin(m_limit, m_used),
+        globalLimit - qMin(globalLimit, globalUsed));
+    const quint32 granted = qMin<quint64>(bytes, available);
+    m_used += granted;
+    globalUsed += granted;
+    return granted;
+}
+
+void SshReceiveWindowBudget::release(quint32 bytes)
+{
+    QMutexLocker locker(&globalBudgetMutex);
+    Q_ASSERT(bytes <= m_used && bytes <= globalUsed);
+    m_used -= bytes;
+    globalUsed -= bytes;
+}
+
+void SshReceiveWindowBudget::addRoundTripTimeSample(int msecs)
+{
+    msecs = qMax(msecs, 1);
+    m_roundTripTime = m_roundTripTime == 0 ? msecs : (7 * m_roundTripTime + msecs) / 8;
+}
+
+void SshReceiveWindowBudget::setGlobalLimit(quint64 limit)
+{
+    QMutexLocker locker(&globalBudgetMutex);
+    globalLimit = limit;
+}
+
+
+const quint32 SshReceiveWindow::MinSize;
+const quint32 SshReceiveWindow::InitialSize;
+const quint32 SshReceiveWindow::MaxSize;
+
+SshReceiveWindow::SshReceiveWindow()
+    : m_budget(0), m_maxSize(MaxSize), m_size(0), m_remaining(0), m_unconsumed(0),
+      m_sampleStart(0), m_sampleBytes(0), m_lastDataTime(0)
+{
+}
+
+SshReceiveWindow::~SshReceiveWindow()
+{
+    close();
+}
+
+quint32 SshReceiveWindow::open(qint64 now)
+{
+    Q_ASSERT(m_size == 0);
+    m_size = MinSize;
+    resize(qMin(InitialSize, m_maxSize));
+    m_remaining = m_size;
+    m_unconsumed = 0;
+    m_sampleStart = m_lastDataTime = now;
+    m_sampleBytes = 0;
+    return m_size;
+}
+
+void SshReceiveWindow::receive(quint32 bytes)
+{
+    bytes = qMin(bytes, m_remaining);
+    m_remaining -= bytes;
+    m_unconsumed += bytes;
+}
+
+quint32 SshReceiveWindow::consume(quint32 bytes, qint64 now)
+{
+    bytes = qMin(bytes, m_unconsumed);
+    m_unconsumed -= bytes;
+    m_sampleBytes += bytes;
+    m_lastDataTime = now;
+
+    const int roundTripTime = m_budget ? m_budget->roundTripTime() : 0;
+    const qint64 elapsed = now - m_sampleStart;
+    if (elapsed >= qMax<qint64>(roundTripTime, MinSamplePeriod)) {
+        if (roundTripTime > 0)
+            adapt(elapsed);
+        m_sampleStart = now;
+        m_sampleBytes = 0;
+    }
+
+    // Top up once half of the window has been used, so the peer never runs dry
+    // while the adjustment is on its way.
+    const quint64 occupied = quint64(m_remaining) + m_unconsumed;
+    if (m_size == 0 || occupied >= m_size / 2)
+        return 0;
+    const quint32 bytesToAdd = m_size - occupied;
+    m_remaining += bytesToAdd;
+    return bytesToAdd;
+}
+
+void SshReceiveWindow::shrinkIfIdle(qint64 now)
+{
+    if (m_size > MinSize && now - m_lastDataTime >= IdleTime)
+        resize(MinSize);
+}
+
+void SshReceiveWindow::close()
+{
+    if (m_size > 0)
+        resize(MinSize);
+    m_size = 0;
+    m_remaining = 0;
+    m_unconsumed = 0;
+}
+
+void SshReceiveWindow::setMaxSize(quint32 maxSize)
+{
+    m_maxSize = qBound(MinSize, maxSize, MaxSize);
+    if (m_size > m_maxSize)
+        resize(m_maxSize);
+}
+
+void SshReceiveWindow::adapt(qint64 elapsed)
+{
+    // A peer that got through half of the window within one round trip is most
+    // likely limited by it.
+    if (m_sampleBytes >= m_size / 2) {
+        resize(qMin<quint64>(m_maxSize, 2 * quint64(m_size)));
+        return;
+    }
+
+    // Otherwise, the reader is slower than the network. Data arrives in bursts,
+    // so leave plenty of headroom over what was actually seen.
+    const quint64 bandwidthDelayProduct
+        = m_sampleBytes * m_budget->roundTripTime() / qMax<qint64>(elapsed, 1);
+    if (4 * bandwidthDelayProduct < m_size)
+        resize(qMax<quint64>(MinSize, 4 * bandwidthDelayProduct));
+}
+
+void SshReceiveWindow::resize(quint32 newSize)
+{
+    if (newSize > m_size) {
+        const quint32 wanted = newSize - m_size;
+        m_size += m_budget ? m_budget->acquire(wanted) : wanted;
+    } else if (newSize < m_size) {
+        if (m_budget)
+            m_budget->release(m_size - newSize);
+        m_size = newSize;
+    }
+}
+
+} // namespace Internal
+} // namespace QSsh
@@ -0,0 +1,134 @@
+/**************************************************************************
+**
+** This file is part of Qt Creator
+**
+** Copyright (c) 2012 Nokia Corporation and/or its subsidiary(-ies).
+**
+** Contact: http://www.qt-project.org/
+**
+**
+** GNU Lesser General Public License Usage
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.LGPL included in the packaging of this file.
+** Please review the following information to ensure the GNU Lesser General
+** Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights. These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** Other Usage
+**
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and Nokia.
+**
+**
+**************************************************************************/
+
+#ifndef SSHRECEIVEWINDOW_P_H
+#define SSHRECEIVEWINDOW_P_H
+
+#include <QtGlobal>
+
+namespace QSsh {
+namespace Internal {
+
+/*
+ * Accounts for the receive windows of all channels of one connection. Every
+ * window gets SshReceiveWindow::MinSize for free; everything above that has to
+ * be acquired here and is limited both per connection and process-wide.
+ * Also keeps the connection's round trip time, which the windows are sized by.
+ */
+class SshReceiveWindowBudget
+{
+public:
+    SshReceiveWindowBudget(quint64 limit);
+    ~SshReceiveWindowBudget();
+
+    // Returns how many of the requested bytes may actually be used.
+    quint32 acquire(quint32 bytes);
+    void release(quint32 bytes);
+
+    // Smoothed value in milliseconds, 0 if there has been no sample yet.
+    int roundTripTime() const { return m_roundTripTime; }
+    void addRoundTripTimeSample(int msecs);
+
+    static void setGlobalLimit(quint64 limit);
+
+private:
+    Q_DISABLE_COPY(SshReceiveWindowBudget)
+
+    const quint64 m_limit;
+    quint64 m_used;
+    int m_roundTripTime;
+};
+
+/*
+ * The local window of one channel. Its size follows the measured throughput:
+ * At the end of each sampling period (one round trip), the window is doubled
+ * if the peer used up at least half of it, as it is then most likely limited
+ * by the window. If much less than that arrived, the window shrinks towards
+ * the bandwidth-delay product seen in that period, and idle channels go back
+ * to the minimum size. All times are in milliseconds on an arbitrary monotonic
+ * clock.
+ */
+class SshReceiveWindow
+{
+public:
+    SshReceiveWindow();
+    ~SshReceiveWindow();
+
+    SshReceiveWindowBudget *budget() const { return m_budget; }
+    void setBudget(SshReceiveWindowBudget *budget) { m_budget = budget; }
+
+    // Returns the initial window size to announce to the peer.
+    quint32 open(qint64 now);
+
+    // Data the peer has sent. It keeps occupying the window until consume()
+    // is called for it, which may happen much later if the application reads
+    // it from a buffer.
+    void receive(quint32 bytes);
+
+    // Accounts for data that has been passed on. Returns the number of bytes
+    // the peer should be granted via SSH_MSG_CHANNEL_WINDOW_ADJUST, or 0 if that
+    // is not due yet.
+    quint32 consume(quint32 bytes, qint64 now);
+
+    void shrinkIfIdle(qint64 now);
+    void close();
+
+    // The window never grows beyond this; at least MinSize.
+    quint32 maxSize() const { return m_maxSize; }
+    void setMaxSize(quint32 maxSize);
+
+    quint32 size() const { return m_size; }
+    quint32 remaining() const { return m_remaining; }
+    quint32 unconsumed() const { return m_unconsumed; }
+
+    static const quint32 MinSize = 64 * 1024;
+    static const quint32 InitialSize = 256 * 1024;
+    static const quint32 MaxSize = 64 * 1024 * 1024;
+
+private:
+    Q_DISABLE_COPY(SshReceiveWindow)
+
+    void adapt(qint64 elapsed);
+    void resize(quint32 newSize);
+
+    SshReceiveWindowBudget *m_budget;
+    quint32 m_maxSize;
+    quint32 m_size;
+    quint32 m_remaining;
+    quint32 m_unconsumed;
+    qint64 m_sampleStart;
+    quint64 m_sampleBytes;
+    qint64 m_lastDataTime;
+};
+
+} // namespace Internal
+} // namespace QSsh
+
+#endif // SSHRECEIVEWINDOW_P_H
@@ -36,8 +36,6 @@
 
 #include <botan/exceptn.h>
 
-#include <QTimer>
-
 #include <cstring>
 #include <cstdlib>
 
@@ -97,7 +95,7 @@ bool SshRemoteProcess::atEnd() const
 
 qint64 SshRemoteProcess::bytesAvailable() const
 {
-    return QIODevice::bytesAvailable() + d->data().count();
+    return QIODevice::bytesAvailable() + d->data().size();
 }
 
 bool SshRemoteProcess::canReadLine() const
@@ -115,11 +113,37 @@ QByteArray SshRemoteProcess::readAllStandardError()
     return readAllFromChannel(QProcess::StandardError);
 }
 
+QByteArray SshRemoteProcess::readChunk()
+{
+    // Whatever QIODevice has buffered already comes first.
+    if (QIODevice::bytesAvailable() > 0)
+        return read(QIODevice::bytesAvailable());
+    const QByteArray &chunk = d->data().readChunk();
+    d->handleDataConsumed(chunk.size());
+    return chunk;
+}
+
+void SshRemoteProcess::setRecordDelimiter(char delimiter)
+{
+    d->setRecordDelimiter(true, delimiter);
+}
+
+void SshRemoteProcess::unsetRecordDelimiter()
+{
+    d->setRecordDelimiter(false, 0);
+}
+
 QByteArray SshRemoteProcess::readAllFromChannel(QProcess::ProcessChannel channel)
 {
     const QProcess::ProcessChannel currentReadChannel = readChannel();
     setReadChannel(channel);
-    const QByteArray &data = readAll();
+    QByteArray data;
+    if (QIODevice::bytesAvailable() > 0) {
+        data = readAll();
+    } else {
+        data = d->data().readAll();
+        d->handleDataConsumed(data.size());
+    }
     setReadChannel(currentReadChannel);
     return data;
 }
@@ -132,21 +156,59 @@ void SshRemoteProcess::close()
 
 qint64 SshRemoteProcess::readData(char *data, qint64 maxlen)
 {
-    const qint64 bytesRead = qMin(qint64(d->data().count()), maxlen);
-    memcpy(data, d->data().constData(), bytesRead);
-    d->data().remove(0, bytesRead);
+    const qint64 bytesRead = d->data().read(data, maxlen);
+    d->handleDataConsumed(bytesRead);
     return bytesRead;
 }
 
 qint64 SshRemoteProcess::writeData(const char *data, qint64 len)
 {
     if (isRunning()) {
-        d->sendData(QByteArray(data, len));
+        len = d->writeBufferSpace(len);
+        if (len > 0) {
+            QSSH_COUNT_COPY(len);
+            d->sendData(QByteArray(data, len));
+        }
         return len;
     }
     return 0;
 }
 
+qint64 SshRemoteProcess::bytesToWrite() const
+{
+    return QIODevice::bytesToWrite() + d->bytesToWrite();
+}
+
+void SshRemoteProcess::setWriteBufferHighWaterMark(qint64 bytes)
+{
+    d->setWriteBufferHighWaterMark(bytes);
+}
+
+qint64 SshRemoteProcess::writeBufferHighWaterMark() const
+{
+    return d->writeBufferHighWaterMark();
+}
+
+void SshRemoteProcess::setReadBufferSize(qint64 size)
+{
+    d->setReadBufferSize(size);
+}
+
+qint64 SshRemoteProcess::readBufferSize() const
+{
+    return d->readBufferSize();
+}
+
+void SshRemoteProcess::setPriority(int priority)
+{
+    d->setPriority(priority);
+}
+
+int SshRemoteProcess::priority() const
+{
+    return d->priority();
+}
+
 QProcess::ProcessChannel SshRemoteProcess::readChannel() const
 {
     return d->m_readChannel;
@@ -166,7 +228,13 @@ void SshRemoteProcess::init()
     connect(d, SIGNAL(readyRead()), this, SIGNAL(readyRead()), Qt::QueuedConnection);
     connect(d, SIGNAL(readyReadStandardError()), this,
         SIGNAL(readyReadStandardError()), Qt::QueuedConnection);
+    connect(d, SIGNAL(standardOutputRecords(QList<QByteArray>)), this,
+        SIGNAL(standardOutputRecords(QList<QByteArray>)), Qt::QueuedConnection);
+    connect(d, SIGNAL(standardErrorRecords(QList<QByteArray>)), this,
+        SIGNAL(standardErrorRecords(QList<QByteArray>)), Qt::QueuedConnection);
     connect(d, SIGNAL(closed(int)), this, SIGNAL(closed(int)), Qt::QueuedConnection);
+    connect(d, SIGNAL(bytesWritten(qint64)), this, SIGNAL(bytesWritten(qint64)),
+        Qt::QueuedConnection);
 }
 
 void SshRemoteProcess::addToEnvironment(const QByteArray &var, const QByteArray &value)
@@ -253,6 +321,26 @@ void SshRemoteProcessPrivate::init()
     m_exitCode = 0;
     m_readChannel = QProcess::StandardOutput;
     m_signal = SshRemoteProcess::NoSignal;
+    m_splitRecords = false;
+}
+
+void SshRemoteProcessPrivate::setRecordDelimiter(bool enabled, char delimiter)
+{
+    if (m_splitRecords && (!enabled || delimiter != m_stdoutRecords.delimiter()))
+        flushIncompleteRecords();
+    m_splitRecords = enabled;
+    m_stdoutRecords.setDelimiter(delimiter);
+    m_stderrRecords.setDelimiter(delimiter);
+}
+
+void SshRemoteProcessPrivate::flushIncompleteRecords()
+{
+    const QByteArray &stdoutRecord = m_stdoutRecords.takeIncompleteRecord();
+    if (!stdoutRecord.isEmpty())
+        emit standardOutputRecords(QList<QByteArray>() << stdoutRecord);
+    const QByteArray &stderrRecord = m_stderrRecords.takeIncompleteRecord();
+    if (!stderrRecord.isEmpty())
+        emit standardErrorRecords(QList<QByteArray>() << stderrRecord);
 }
 
 void SshRemoteProcessPrivate::setProcState(ProcessState newState)
@@ -269,13 +357,15 @@ void SshRemoteProcessPrivate::setProcState(ProcessState newState)
     }
 }
 
-QByteArray &SshRemoteProcessPrivate::data()
+SshReadQueue &SshRemoteProcessPrivate::data()
 {
     return m_readChannel == QProcess::StandardOutput ? m_stdout : m_stderr;
 }
 
 void SshRemoteProcessPrivate::closeHook()
 {
+    if (m_splitRecords)
+        flushIncompleteRecords();
     if (m_wasRunning) {
         if (m_signal != SshRemoteProcess::NoSignal)
             emit closed(SshRemoteProcess::CrashExit);
@@ -299,7 +389,7 @@ void SshRemoteProcessPrivate::handleOpenSuccessInternal()
    else
        m_sendFacility.sendExecPacket(remoteChannel(), m_command);
    setProcState(ExecRequested);
-   m_timeoutTimer->start(ReplyTimeout);
+   m_timeoutTimer.start(ReplyTimeout);
 }
 
 void SshRemoteProcessPrivate::handleOpenFailureInternal(const QString &reason)
@@ -314,7 +404,7 @@ void SshRemoteProcessPrivate::handleChannelSuccess()
         throw SSH_SERVER_EXCEPTION(SSH_DISCONNECT_PROTOCOL_ERROR,
             "Unexpected SSH_MSG_CHANNEL_SUCCESS message.");
     }
-    m_timeoutTimer->stop();
+    m_timeoutTimer.stop();
     setProcState(Running);
 }
 
@@ -324,14 +414,24 @@ void SshRemoteProcessPrivate::handleChannelFailure()
         throw SSH_SERVER_EXCEPTION(SSH_DISCONNECT_PROTOCOL_ERROR,
             "Unexpected SSH_MSG_CHANNEL_FAILURE message.");
     }
-    m_timeoutTimer->stop();
+    m_timeoutTimer.stop();
     setProcState(StartFailed);
     closeChannel();
 }
 
 void SshRemoteProcessPrivate::handleChannelDataInternal(const QByteArray &data)
 {
-    m_stdout += data;
+    if (m_splitRecords) {
+        QList<QByteArray> records;
+        m_stdoutRecords.split(data, &records);
+        handleDataConsumed(data.size());
+        if (!records.isEmpty())
+            emit standardOutputRecords(records);
+        return;
+    }
+
+    // The data refers to the packet, which is about to be reused.
+    m_stdout.append(QByteArray(data.constData(), data.size()));
     emit readyReadStandardOutput();
     if (m_readChannel == QProcess::StandardOutput)
         emit readyRead();
@@ -342,8 +442,14 @@ void SshRemoteProcessPrivate::handleChannelExtendedDataInternal(quint32 type,
 {
     if (type != SSH_EXTENDED_DATA_STDERR) {
         qWarning("Unknown extended data type %u", type);
+    } else if (m_splitRecords) {
+        QList<QByteArray> records;
+        m_stderrRecords.split(data, &records);
+        handleDataConsumed(data.size());
+        if (!records.isEmpty())
+            emit standardErrorRecords(records);
     } else {
-        m_stderr += data;
+        m_stderr.append(QByteArray(data.constData(), data.size()));
         emit readyReadStandardError();
         if (m_readChannel == QProcess::StandardError)
             emit readyRead();
@@ -33,6 +33,7 @@
 
 #include "ssh_global.h"
 
+#include <QList>
 #include <QProcess>
 #include <QSharedPointer>
 
@@ -72,6 +73,31 @@ public:
     bool canReadLine() const;
     void close();
     bool isSequential() const { return true; }
+    qint64 bytesToWrite() const;
+
+    /*
+     * Once bytesToWrite() has reached this value, write() accepts no more data
+     * until bytesWritten() has been emitted. 0 (the default) means no limit.
+     */
+    void setWriteBufferHighWaterMark(qint64 bytes);
+    qint64 writeBufferHighWaterMark() const;
+
+    /*
+     * With a non-zero read buffer size, the server may only send more output once
+     * the application has read what it sent before, so that no more than that
+     * many bytes of standard output and standard error are buffered. Note that
+     * both channels then have to be read. Values below 64 KB are rounded up.
+     * The default of 0 means that all output is buffered as it arrives.
+     */
+    void setReadBufferSize(qint64 size);
+    qint64 readBufferSize() const;
+
+    /*
+     * When several channels of a connection have data to send, each of them gets
+     * a share of the bandwidth proportional to its priority. The default is 1.
+     */
+    void setPriority(int priority);
+    int priority() const;
 
     QProcess::ProcessChannel readChannel() const;
     void setReadChannel(QProcess::ProcessChannel channel);
@@ -92,6 +118,22 @@ public:
     QByteArray readAllStandardOutput();
     QByteArray readAllStandardError();
 
+    /*
+     * Returns the next piece of the current read channel the way it came in from
+     * the network, without copying it, or an empty array if there is nothing to read.
+     */
+    QByteArray readChunk();
+
+    /*
+     * From now on, deliver output as batches of records ending with the delimiter
+     * via standardOutputRecords() and standardErrorRecords(), instead of buffering it
+     * for read(). The records do not include the delimiter; an unterminated last
+     * record is delivered when the channel closes. A record that has not ended after
+     * 1 MB is delivered in pieces of that size.
+     */
+    void setRecordDelimiter(char delimiter);
+    void unsetRecordDelimiter();
+
     // Note: This is ignored by the OpenSSH server.
     void sendSignal(Signal signal);
     void kill() { sendSignal(KillSignal); }
@@ -102,6 +144,9 @@ signals:
     void readyReadStandardOutput();
     void readyReadStandardError();
 
+    void standardOutputRecords(const QList<QByteArray> &records);
+    void standardErrorRecords(const QList<QByteArray> &records);
+
     /*
      * Parameter is of type ExitStatus, but we use int because of
      * signal/slot awkwardness (full namespace required).
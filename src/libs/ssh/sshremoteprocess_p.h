@@ -34,6 +34,7 @@
 #include "sshpseudoterminal.h"
 
 #include "sshchannel_p.h"
+#include "sshreadqueue_p.h"
 
 #include <QList>
 #include <QPair>
@@ -59,13 +60,15 @@ public:
 
     virtual void closeHook();
 
-    QByteArray &data();
+    SshReadQueue &data();
 
 signals:
     void started();
     void readyRead();
     void readyReadStandardOutput();
     void readyReadStandardError();
+    void standardOutputRecords(const QList<QByteArray> &records);
+    void standardErrorRecords(const QList<QByteArray> &records);
     void closed(int exitStatus);
 
 private:
@@ -84,6 +87,8 @@ private:
 
     void init();
     void setProcState(ProcessState newState);
+    void setRecordDelimiter(bool enabled, char delimiter);
+    void flushIncompleteRecords();
 
     QProcess::ProcessChannel m_readChannel;
 
@@ -100,8 +105,12 @@ private:
     bool m_useTerminal;
     SshPseudoTerminal m_terminal;
 
-    QByteArray m_stdout;
-    QByteArray m_stderr;
+    SshReadQueue m_stdout;
+    SshReadQueue m_stderr;
+
+    bool m_splitRecords;
+    SshRecordSplitter m_stdoutRecords;
+    SshRecordSplitter m_stderrRecords;
 
     SshRemoteProcess *m_proc;
 };
@@ -30,6 +30,7 @@
 
 #include "sshsendfacility_p.h"
 
+#include "sshcopycount_p.h"
 #include "sshkeyexchange_p.h"
 #include "sshoutgoingpacket_p.h"
 
@@ -39,8 +40,9 @@ namespace QSsh {
 namespace Internal {
 
 SshSendFacility::SshSendFacility(QTcpSocket *socket)
-    : m_clientSeqNr(0), m_socket(socket),
-      m_outgoingPacket(m_encrypter, m_clientSeqNr)
+    : m_clientSeqNr(0), m_bytesSentSinceKeyExchange(0), m_bytesQueued(0), m_bytesWritten(0),
+      m_heldBackEndPosition(0), m_corkCount(0), m_socket(socket),
+      m_outgoingPacket(m_encrypter, m_compressor, m_clientSeqNr)
 {
 }
 
@@ -49,22 +51,92 @@ void SshSendFacility::sendPacket()
 #ifdef CREATOR_SSH_DEBUG
     qDebug("Sending packet, client seq nr is %u", m_clientSeqNr);
 #endif
+    if (m_outgoingPacket.isHeldBack()) {
+        m_heldBackPayloads << m_outgoingPacket.payload();
+        return;
+    }
     if (m_socket->isValid()
         && m_socket->state() == QAbstractSocket::ConnectedState) {
-        m_socket->write(m_outgoingPacket.rawData());
+        const QByteArray &rawData = m_outgoingPacket.rawData();
+        QSSH_COUNT_COPY(rawData.size());
+        if (m_corkCount > 0)
+            m_writeBuffer += rawData;
+        else
+            m_socket->write(rawData);
+        m_bytesSentSinceKeyExchange += rawData.size();
+        m_bytesQueued += rawData.size();
         ++m_clientSeqNr;
     }
 }
 
+void SshSendFacility::sendHeldBackPackets()
+{
+    const QList<QByteArray> payloads = m_heldBackPayloads;
+    m_heldBackPayloads.clear();
+    foreach (const QByteArray &payload, payloads) {
+        m_outgoingPacket.generatePacketFromPayload(payload);
+        sendPacket();
+    }
+    m_heldBackEndPosition = m_bytesQueued;
+}
+
+quint64 SshSendFacility::lastPacketEndPosition() const
+{
+    return m_outgoingPacket.isHeldBack() ? HeldBackPosition : m_bytesQueued;
+}
+
+void SshSendFacility::uncork()
+{
+    Q_ASSERT(m_corkCount > 0);
+    if (--m_corkCount == 0)
+        flush();
+}
+
+void SshSendFacility::flush()
+{
+    if (m_writeBuffer.isEmpty())
+        return;
+    if (m_socket->isValid()
+        && m_socket->state() == QAbstractSocket::ConnectedState) {
+        QSSH_COUNT_COPY(m_writeBuffer.size());
+        m_socket->write(m_writeBuffer);
+    } else {
+        m_bytesWritten += m_writeBuffer.size();
+    }
+    m_writeBuffer.clear();
+}
+
+void SshSendFacility::handleBytesWritten(qint64 bytes)
+{
+    m_bytesWritten = qMin(m_bytesWritten + bytes, m_bytesQueued);
+}
+
 void SshSendFacility::reset()
 {
     m_clientSeqNr = 0;
+    m_writeBuffer.clear();
+    m_bytesWritten = m_bytesQueued; // The socket has dropped whatever was left.
+    m_bytesSentSinceKeyExchange = 0;
+    m_heldBackPayloads.clear();
+    m_heldBackEndPosition = m_bytesQueued;
+    m_outgoingPacket.setKeyExchangeInProgress(false);
     m_encrypter.clearKeys();
+    m_compressor.reset();
 }
 
+// Called right after NEWKEYS has been sent.
 void SshSendFacility::recreateKeys(const SshKeyExchange &keyExchange)
 {
     m_encrypter.recreateKeys(keyExchange);
+    m_compressor.setAlgorithm(keyExchange.compressionAlgoClientToServer());
+    m_bytesSentSinceKeyExchange = 0;
+    m_outgoingPacket.setKeyExchangeInProgress(false);
+    sendHeldBackPackets();
+}
+
+void SshSendFacility::enableDelayedCompression()
+{
+    m_compressor.setAuthenticated();
 }
 
 void SshSendFacility::createAuthenticationKey(const QByteArray &privKeyFileContents)
@@ -72,9 +144,11 @@ void SshSendFacility::createAuthenticationKey(const QByteArray &privKeyFileConte
     m_encrypter.createAuthenticationKey(privKeyFileContents);
 }
 
-QByteArray SshSendFacility::sendKeyExchangeInitPacket()
+QByteArray SshSendFacility::sendKeyExchangeInitPacket(const QList<QByteArray> &compressionAlgorithms)
 {
-    const QByteArray &payLoad = m_outgoingPacket.generateKeyExchangeInitPacket();
+    m_outgoingPacket.setKeyExchangeInProgress(true);
+    const QByteArray &payLoad
+        = m_outgoingPacket.generateKeyExchangeInitPacket(compressionAlgorithms);
     sendPacket();
     return payLoad;
 }
@@ -85,6 +159,12 @@ void SshSendFacility::sendKeyDhInitPacket(const Botan::BigInt &e)
     sendPacket();
 }
 
+void SshSendFacility::sendKeyEcdhInitPacket(const QByteArray &clientQ)
+{
+    m_outgoingPacket.generateKeyEcdhInitPacket(clientQ);
+    sendPacket();
+}
+
 void SshSendFacility::sendNewKeysPacket()
 {
     m_outgoingPacket.generateNewKeysPacket();
@@ -31,9 +31,12 @@
 #ifndef SSHCONNECTIONOUTSTATE_P_H
 #define SSHCONNECTIONOUTSTATE_P_H
 
+#include "sshcompressionfacility_p.h"
 #include "sshcryptofacility_p.h"
 #include "sshoutgoingpacket_p.h"
 
+#include <QList>
+
 QT_BEGIN_NAMESPACE
 class QTcpSocket;
 QT_END_NAMESPACE
@@ -51,10 +54,12 @@ public:
     SshSendFacility(QTcpSocket *socket);
     void reset();
     void recreateKeys(const SshKeyExchange &keyExchange);
+    void enableDelayedCompression();
     void createAuthenticationKey(const QByteArray &privKeyFileContents);
 
-    QByteArray sendKeyExchangeInitPacket();
+    QByteArray sendKeyExchangeInitPacket(const QList<QByteArray> &compressionAlgorithms);
     void sendKeyDhInitPacket(const Botan::BigInt &e);
+    void sendKeyEcdhInitPacket(const QByteArray &clientQ);
     void sendNewKeysPacket();
     void sendDisconnectPacket(SshErrorCode reason,
         const QByteArray &reasonString);
@@ -83,16 +88,68 @@ public:
     void sendChannelEofPacket(quint32 remoteChannel);
     void sendChannelClosePacket(quint32 remoteChannel);
     quint32 nextClientSeqNr() const { return m_clientSeqNr; }
+    bool isKeyExchangeInProgress() const { return m_outgoingPacket.isKeyExchangeInProgress(); }
+    quint64 bytesSentSinceKeyExchange() const { return m_bytesSentSinceKeyExchange; }
+
+    // While corked, packets are collected and handed to the socket in a single
+    // write when the outermost uncork() happens. Use SshSendFacilityCork for this.
+    // flush() writes out everything collected so far right away.
+    void cork() { ++m_corkCount; }
+    void uncork();
+    void flush();
+
+    // Byte positions in the outgoing stream: everything handed to the facility
+    // so far and the part of it that the socket has actually written.
+    quint64 bytesQueued() const { return m_bytesQueued; }
+    quint64 bytesWritten() const { return m_bytesWritten; }
+    qint64 bytesToWrite() const { return m_bytesQueued - m_bytesWritten; }
+    void handleBytesWritten(qint64 bytes);
+
+    // Where the packet sent last ends in the outgoing stream. A packet generated
+    // during a key exchange is held back until NEWKEYS has been sent, and its
+    // position is HeldBackPosition until then. Once no packets are held back,
+    // heldBackEndPosition() is where the last of them ended.
+    quint64 lastPacketEndPosition() const;
+    bool hasHeldBackPackets() const { return !m_heldBackPayloads.isEmpty(); }
+    quint64 heldBackEndPosition() const { return m_heldBackEndPosition; }
+    static const quint64 HeldBackPosition = ~Q_UINT64_C(0);
 
 private:
     void sendPacket();
+    void sendHeldBackPackets();
 
     quint32 m_clientSeqNr;
+    quint64 m_bytesSentSinceKeyExchange;
+    quint64 m_bytesQueued;
+    quint64 m_bytesWritten;
+
+    // Payloads of packets generated between KEXINIT and NEWKEYS.
+    QList<QByteArray> m_heldBackPayloads;
+    quint64 m_heldBackEndPosition;
+
+    int m_corkCount;
+    QByteArray m_writeBuffer;
     SshEncryptionFacility m_encrypter;
+    SshCompressionFacility m_compressor;
     QTcpSocket *m_socket;
     SshOutgoingPacket m_outgoingPacket;
 };
 
+class SshSendFacilityCork
+{
+public:
+    SshSendFacilityCork(SshSendFacility &sendFacility) : m_sendFacility(sendFacility)
+    {
+        m_sendFacility.cork();
+    }
+    ~SshSendFacilityCork() { m_sendFacility.uncork(); }
+
+private:
+    Q_DISABLE_COPY(SshSendFacilityCork)
+
+    SshSendFacility &m_sendFacility;
+};
+
 } // namespace Internal
 } // namespace QSsh
 
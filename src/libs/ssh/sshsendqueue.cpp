@@ -0,0 +1,102 @@
+/**************************************************************************
+**
+** This file is part of Qt Creator
+**
+** Copyright (c) 2012 Nokia Corporation and/or its subsidiary(-ies).
+**
+** Contact: http://www.qt-project.org/
+**
+**
+** GNU Lesser General Public License Usage
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.LGPL included in the packaging of this file.
+** Please review the following information to ensure the GNU Lesser General
+** Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights. These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** Other Usage
+**
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and Nokia.
+**
+**
+**************************************************************************/
+
+#include "sshsendqueue_p.h"
+
+#include "sshcopycount_p.h"
+
+namespace QSsh {
+namespace Internal {
+
+SshSendQueue::SshSendQueue() : m_headOffset(0), m_size(0)
+{
+}
+
+void SshSendQueue::append(const QByteArray &data)
+{
+    if (data.isEmpty())
+        return;
+    m_chunks << data;
+    m_size += data.size();
+}
+
+QByteArray SshSendQueue::take(int count)
+{
+    Q_ASSERT(count > 0 && count <= m_size);
+
+    m_lastTakenChunk.clear();
+    m_size -= count;
+    const QByteArray &head = m_chunks.first();
+    const int headSize = head.size() - m_headOffset;
+
+    // The common cases: A write that is sent as a whole or split into several packets.
+    if (count < headSize) {
+        const QByteArray data
+            = QByteArray::fromRawData(head.constData() + m_headOffset, count);
+        m_headOffset += count;
+        return data;
+    }
+    if (count == headSize) {
+        m_lastTakenChunk = m_chunks.takeFirst();
+        const int offset = m_headOffset;
+        m_headOffset = 0;
+        if (offset == 0)
+            return m_lastTakenChunk;
+        return QByteArray::fromRawData(m_lastTakenChunk.constData() + offset, count);
+    }
+
+    // Small writes get collected into one packet.
+    QSSH_COUNT_COPY(count);
+    QByteArray data;
+    data.reserve(count);
+    while (count > 0) {
+        const QByteArray &chunk = m_chunks.first();
+        const int bytesFromChunk = qMin(count, chunk.size() - m_headOffset);
+        data.append(chunk.constData() + m_headOffset, bytesFromChunk);
+        count -= bytesFromChunk;
+        m_headOffset += bytesFromChunk;
+        if (m_headOffset == chunk.size()) {
+            m_chunks.removeFirst();
+            m_headOffset = 0;
+        }
+    }
+    return data;
+}
+
+void SshSendQueue::clear()
+{
+    m_chunks.clear();
+    m_headOffset = 0;
+    m_size = 0;
+    m_lastTakenChunk.clear();
+}
+
+} // namespace Internal
+} // namespace QSsh
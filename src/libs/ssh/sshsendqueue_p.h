@@ -0,0 +1,72 @@
+/**************************************************************************
+**
+** This file is part of Qt Creator
+**
+** Copyright (c) 2012 Nokia Corporation and/or its subsidiary(-ies).
+**
+** Contact: http://www.qt-project.org/
+**
+**
+** GNU Lesser General Public License Usage
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.LGPL included in the packaging of this file.
+** Please review the following information to ensure the GNU Lesser General
+** Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights. These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** Other Usage
+**
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and Nokia.
+**
+**
+**************************************************************************/
+
+#ifndef SSHSENDQUEUE_P_H
+#define SSHSENDQUEUE_P_H
+
+#include <QByteArray>
+#include <QList>
+
+namespace QSsh {
+namespace Internal {
+
+/*
+ * Data waiting to be sent on a channel. The arrays passed to append() are kept
+ * as they are, i.e. implicitly shared instead of copied, and take() slices packets
+ * off the front. Only a packet that spans several chunks is copied, so the cost
+ * of take() depends on the packet size, not on the amount of data queued.
+ */
+class SshSendQueue
+{
+public:
+    SshSendQueue();
+
+    void append(const QByteArray &data);
+
+    // The result may refer to memory owned by the queue and is only valid
+    // until the next call to take() or clear().
+    QByteArray take(int count);
+
+    void clear();
+
+    qint64 size() const { return m_size; }
+    bool isEmpty() const { return m_size == 0; }
+
+private:
+    QList<QByteArray> m_chunks;
+    int m_headOffset; // Bytes of the first chunk that have already been taken.
+    qint64 m_size;
+    QByteArray m_lastTakenChunk; // Keeps the data returned by take() alive.
+};
+
+} // namespace Internal
+} // namespace QSsh
+
+#endif // SSHSENDQUEUE_P_H
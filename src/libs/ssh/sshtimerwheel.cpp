@@ -0,0 +1,301 @@
+/**************************************************************************
+**
+** This file is part of Qt Creator
+**
+** Copyright (c) 2012 Nokia Corporation and/or its subsidiary(-ies).
+**
+** Contact: http://www.qt-project.org/
+**
+**
+** GNU Lesser General Public License Usage
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.LGPL included in the packaging of this file.
+** Please review the following information to ensure the GNU Lesser General
+** Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights. These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** Other Usage
+**
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and Nokia.
+**
+**
+**************************************************************************/
+
+#include "sshtimerwheel_p.h"
+
+#include <QEvent>
+#include <QThreadStorage>
+
+namespace QSsh {
+namespace Internal {
+
+namespace {
+    QThreadStorage<SshTimerWheel *> timerWheels;
+
+    const quint64 FirstLevelMask = (1 << 8) - 1;
+    const quint64 LevelMask = (1 << 6) - 1;
+
+    void unlink(SshTimerNode *node)
+    {
+        node->prev->next = node->next;
+        node->next->prev = node->prev;
+        node->prev = node->next = 0;
+    }
+
+    void append(SshTimerNode *list, SshTimerNode *node)
+    {
+        node->prev = list->prev;
+        node->next = list;
+        list->prev->next = node;
+        list->prev = node;
+    }
+
+    // Moves all nodes of the list to the empty list target.
+    void takeAll(SshTimerNode *list, SshTimerNode *target)
+    {
+        target->prev = target->next = target;
+        if (list->next == list)
+            return;
+        target->next = list->next;
+        target->prev = list->prev;
+        target->next->prev = target;
+        target->prev->next = target;
+        list->prev = list->next = list;
+    }
+} // anonymous namespace
+
+SshTimer::SshTimer(QObject *receiver, const char *member)
+    : m_receiver(receiver), m_member(member), m_interval(0), m_expiryTick(0),
+      m_wheel(0), m_filteringWheel(0), m_moving(false)
+{
+    prev = next = 0;
+}
+
+SshTimer::~SshTimer()
+{
+    stop();
+}
+
+void SshTimer::start()
+{
+    SshTimerWheel::instance()->add(this, m_interval);
+}
+
+void SshTimer::start(int msecs)
+{
+    m_interval = msecs;
+    start();
+}
+
+void SshTimer::stop()
+{
+    m_moving = false;
+    if (next)
+        m_wheel->remove(this);
+}
+
+
+SshTimerWheel *SshTimerWheel::instance()
+{
+    if (!timerWheels.hasLocalData())
+        timerWheels.setLocalData(new SshTimerWheel);
+    return timerWheels.localData();
+}
+
+SshTimerWheel::SshTimerWheel() : m_wakeUpTick(0), m_nextTick(0), m_timerCount(0)
+{
+    for (int level = 0; level < Levels; ++level) {
+        for (int index = 0; index < (1 << FirstLevelBits); ++index)
+            m_slots[level][index].prev = m_slots[level][index].next = &m_slots[level][index];
+    }
+    m_clock.start();
+    m_wakeUpTimer.setSingleShot(true);
+    connect(&m_wakeUpTimer, SIGNAL(timeout()), SLOT(handleTimeout()));
+}
+
+quint64 SshTimerWheel::currentTick() const
+{
+    return m_clock.elapsed() / TickInterval;
+}
+
+void SshTimerWheel::add(SshTimer *timer, int msecs)
+{
+    timer->stop();
+    if (timer->m_filteringWheel != this) {
+        timer->m_receiver->installEventFilter(this);
+        timer->m_filteringWheel = this;
+    }
+    if (m_timerCount == 0)
+        m_nextTick = currentTick(); // Nothing to catch up on.
+
+    // Round up, so that the timer never fires early.
+    timer->m_expiryTick
+        = (m_clock.elapsed() + qMax(msecs, 0) + TickInterval - 1) / TickInterval;
+    const int level = insert(timer);
+    timer->m_wheel = this;
+    ++m_timerCount;
+
+    // Timers on further levels are looked at when the first level wraps around.
+    const quint64 dueTick = level == 0 ? timer->m_expiryTick : nextRevolution();
+    if (!m_wakeUpTimer.isActive() || dueTick < m_wakeUpTick)
+        wakeUpAt(dueTick);
+}
+
+void SshTimerWheel::remove(SshTimer *timer)
+{
+    unlink(timer);
+    timer->m_wheel = 0;
+    if (--m_timerCount == 0)
+        m_wakeUpTimer.stop();
+}
+
+bool SshTimerWheel::eventFilter(QObject *watched, QEvent *event)
+{
+    // Sent in the old thread, right before the receiver moves.
+    if (event->type() == QEvent::ThreadChange)
+        moveTimers(watched);
+    return false;
+}
+
+void SshTimerWheel::moveTimers(QObject *receiver)
+{
+    // The filter stays installed. Qt ignores it while the receiver lives in another
+    // thread, and it is in place again if the receiver comes back.
+    SshTimerMover *mover = 0;
+    for (int level = 0; level < Levels; ++level) {
+        for (int index = 0; index < (1 << FirstLevelBits); ++index) {
+            SshTimerNode * const slot = &m_slots[level][index];
+            for (SshTimerNode *node = slot->next; node != slot;) {
+                SshTimer * const timer = static_cast<SshTimer *>(node);
+                node = node->next;
+                if (timer->m_receiver != receiver)
+                    continue;
+                const qint64 remaining = qint64(timer->m_expiryTick) * TickInterval
+                    - m_clock.elapsed();
+                remove(timer);
+                if (!mover)
+                    mover = new SshTimerMover(receiver);
+                mover->addTimer(timer, int(qMax<qint64>(remaining, 0)));
+            }
+        }
+    }
+    if (mover)
+        QMetaObject::invokeMethod(mover, "restartTimers", Qt::QueuedConnection);
+}
+
+int SshTimerWheel::insert(SshTimer *timer)
+{
+    timer->m_expiryTick = qMax(timer->m_expiryTick, m_nextTick);
+    const quint64 delta = timer->m_expiryTick - m_nextTick;
+    int level = 0;
+    int shift = FirstLevelBits;
+    while (level < Levels - 1 && delta >= (Q_UINT64_C(1) << shift)) {
+        ++level;
+        shift += LevelBits;
+    }
+    if (delta >= (Q_UINT64_C(1) << shift))
+        timer->m_expiryTick = m_nextTick + (Q_UINT64_C(1) << shift) - 1; // Far enough.
+
+    const int index = level == 0 ? int(timer->m_expiryTick & FirstLevelMask)
+        : int((timer->m_expiryTick >> (shift - LevelBits)) & LevelMask);
+    append(&m_slots[level][index], timer);
+    return level;
+}
+
+void SshTimerWheel::cascade(int level)
+{
+    const int shift = FirstLevelBits + (level - 1) * LevelBits;
+    const int index = int((m_nextTick >> shift) & LevelMask);
+    SshTimerNode timers;
+    takeAll(&m_slots[level][index], &timers);
+    while (timers.next != &timers) {
+        SshTimer * const timer = static_cast<SshTimer *>(timers.next);
+        unlink(timer);
+        insert(timer);
+    }
+    if (index == 0 && level < Levels - 1)
+        cascade(level + 1);
+}
+
+void SshTimerWheel::handleTimeout()
+{
+    const quint64 now = currentTick();
+    while (m_nextTick <= now && m_timerCount > 0) {
+        if ((m_nextTick & FirstLevelMask) == 0)
+            cascade(1);
+
+        SshTimerNode expired;
+        takeAll(&m_slots[0][m_nextTick & FirstLevelMask], &expired);
+        ++m_nextTick; // Timers started from the callbacks go after this tick.
+        while (expired.next != &expired) {
+            SshTimer * const timer = static_cast<SshTimer *>(expired.next);
+            unlink(timer);
+            timer->m_wheel = 0;
+            --m_timerCount;
+            QMetaObject::invokeMethod(timer->m_receiver, timer->m_member, Qt::DirectConnection);
+        }
+    }
+    scheduleWakeUp();
+}
+
+void SshTimerWheel::scheduleWakeUp()
+{
+    if (m_timerCount == 0) {
+        m_wakeUpTimer.stop();
+        return;
+    }
+
+    // The next tick with timers, or the next revolution of the first level, at which
+    // timers from the other levels move down.
+    const quint64 revolution = nextRevolution();
+    quint64 tick = m_nextTick;
+    while (tick < revolution) {
+        const SshTimerNode &slot = m_slots[0][tick & FirstLevelMask];
+        if (slot.next != &slot)
+            break;
+        ++tick;
+    }
+    wakeUpAt(tick);
+}
+
+// The next tick at which the first level starts over, possibly the upcoming one.
+quint64 SshTimerWheel::nextRevolution() const
+{
+    return (m_nextTick + FirstLevelMask) & ~FirstLevelMask;
+}
+
+void SshTimerWheel::wakeUpAt(quint64 tick)
+{
+    m_wakeUpTick = tick;
+    m_wakeUpTimer.start(int(qMax<qint64>(tick * TickInterval - m_clock.elapsed(), 0)));
+}
+
+
+void SshTimerMover::addTimer(SshTimer *timer, int remainingMsecs)
+{
+    timer->m_moving = true;
+    m_timers << qMakePair(timer, remainingMsecs);
+}
+
+void SshTimerMover::restartTimers()
+{
+    // Timers that were stopped or started again in the meantime are left alone.
+    for (int i = 0; i < m_timers.count(); ++i) {
+        SshTimer * const timer = m_timers.at(i).first;
+        if (timer->m_moving) {
+            timer->m_moving = false;
+            SshTimerWheel::instance()->add(timer, m_timers.at(i).second);
+        }
+    }
+    deleteLater();
+}
+
+} // namespace Internal
+} // namespace QSsh
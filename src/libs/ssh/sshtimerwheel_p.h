@@ -0,0 +1,156 @@
+/**************************************************************************
+**
+** This file is part of Qt Creator
+**
+** Copyright (c) 2012 Nokia Corporation and/or its subsidiary(-ies).
+**
+** Contact: http://www.qt-project.org/
+**
+**
+** GNU Lesser General Public License Usage
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.LGPL included in the packaging of this file.
+** Please review the following information to ensure the GNU Lesser General
+** Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights. These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** Other Usage
+**
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and Nokia.
+**
+**
+**************************************************************************/
+
+#ifndef SSHTIMERWHEEL_P_H
+#define SSHTIMERWHEEL_P_H
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QPair>
+#include <QTimer>
+
+namespace QSsh {
+namespace Internal {
+
+class SshTimerWheel;
+
+struct SshTimerNode
+{
+    SshTimerNode *prev;
+    SshTimerNode *next;
+};
+
+/*
+ * A single-shot timer that is much cheaper to start and stop than a QTimer,
+ * which matters for the reply timeouts of many short-lived channels.
+ * On expiry, the given slot or signal of the receiver is invoked, as in
+ * SshTimer(this, "handleTimeout"). The resolution is SshTimerWheel::TickInterval.
+ * The timer must be owned by the receiver. Like a QTimer, it follows the receiver
+ * to another thread.
+ */
+class SshTimer : private SshTimerNode
+{
+    friend class SshTimerWheel;
+    friend class SshTimerMover;
+public:
+    SshTimer(QObject *receiver, const char *member);
+    ~SshTimer();
+
+    int interval() const { return m_interval; }
+    void setInterval(int msecs) { m_interval = msecs; }
+
+    void start();
+    void start(int msecs);
+    void stop();
+    bool isActive() const { return next != 0 || m_moving; }
+
+private:
+    Q_DISABLE_COPY(SshTimer)
+
+    QObject * const m_receiver;
+    const char * const m_member;
+    int m_interval;
+    quint64 m_expiryTick;
+    SshTimerWheel *m_wheel; // The wheel the timer is in while active.
+    SshTimerWheel *m_filteringWheel; // The wheel watching the receiver for thread changes.
+    bool m_moving; // Waiting to be restarted in the receiver's new thread.
+};
+
+/*
+ * Keeps all SshTimers of a thread in a hierarchical timing wheel: The first
+ * level has a slot per tick, every further level a slot per revolution of the
+ * level below it. Starting and stopping a timer is O(1). A single QTimer wakes
+ * up only when timers are due or have to move down a level.
+ * The wheel filters the events of the receivers. When one of them moves to
+ * another thread, its active timers are taken out and restarted in the new
+ * thread's wheel with the time they had left.
+ */
+class SshTimerWheel : public QObject
+{
+    Q_OBJECT
+public:
+    static SshTimerWheel *instance();
+
+    void add(SshTimer *timer, int msecs);
+    void remove(SshTimer *timer);
+
+    static const int TickInterval = 100; // milli seconds
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event);
+
+private:
+    SshTimerWheel();
+
+    Q_SLOT void handleTimeout();
+
+    void moveTimers(QObject *receiver);
+
+    quint64 currentTick() const;
+    int insert(SshTimer *timer);
+    void cascade(int level);
+    void scheduleWakeUp();
+    quint64 nextRevolution() const;
+    void wakeUpAt(quint64 tick);
+
+    enum { Levels = 4, FirstLevelBits = 8, LevelBits = 6 };
+
+    SshTimerNode m_slots[Levels][1 << FirstLevelBits]; // Circular lists; the nodes are sentinels.
+    QElapsedTimer m_clock;
+    QTimer m_wakeUpTimer;
+    quint64 m_wakeUpTick;
+    quint64 m_nextTick; // Timers in earlier ticks have expired.
+    int m_timerCount;
+};
+
+/*
+ * Carries the timers of a receiver that is moving to another thread. It is a
+ * child of the receiver, so it moves along with it, and the queued call of
+ * restartTimers() is delivered in the new thread.
+ */
+class SshTimerMover : public QObject
+{
+    Q_OBJECT
+public:
+    SshTimerMover(QObject *receiver) : QObject(receiver) {}
+
+    void addTimer(SshTimer *timer, int remainingMsecs);
+
+    Q_INVOKABLE void restartTimers();
+
+private:
+    QList<QPair<SshTimer *, int> > m_timers;
+};
+
+} // namespace Internal
+} // namespace QSsh
+
+#endif // SSHTIMERWHEEL_P_H
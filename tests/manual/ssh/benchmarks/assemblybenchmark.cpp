@@ -0,0 +1,120 @@
+/**************************************************************************
+**
+** This file is part of Qt Creator
+**
+** Copyright (c) 2012 Nokia Corporation and/or its subsidiary(-ies).
+**
+** Contact: http://www.qt-project.org/
+**
+**
+** GNU Lesser General Public License Usage
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.LGPL included in the packaging of this file.
+** Please review the following information to ensure the GNU Lesser General
+** Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights. These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** Other Usage
+**
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and Nokia.
+**
+**
+**************************************************************************/
+
+#include "benchmarks.h"
+#include "loopbackserver.h"
+
+#include "sshconnection_p.h"
+#include "sshcopycount_p.h"
+#include "sshremoteprocess.h"
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QSharedPointer>
+
+using namespace QSsh;
+using namespace QSsh::Internal;
+
+/*
+ * Writes to a remote process on the loopback server, so that the data takes the
+ * library's real outgoing path: the channel's send queue,
+ * SshOutgoingPacket::generateChannelDataPacket() with aes128-ctr and
+ * hmac-sha2-256-etm@openssh.com, and SshSendFacility. The benchmarks build the
+ * library with QSSH_COUNT_COPIES, so that path counts the bytes it copies,
+ * including moves of the packet buffer and handing the packet to QTcpSocket.
+ * The throughput includes the server, which decrypts everything in the same
+ * thread.
+ */
+
+namespace {
+
+const qint64 BytesPerRun = 256 * 1024 * 1024;
+const qint64 WriteBufferLimit = 4 * 1024 * 1024;
+
+bool runWrites(LoopbackSshServer &server, SshConnectionPrivate &client,
+        SshRemoteProcess &process, const QByteArray &data, qint64 *nsecs,
+        double *copiesPerByte)
+{
+    const qint64 receivedBefore = server.channelDataReceived();
+    const quint64 copiedBefore = sshCopiedBytes();
+    QElapsedTimer timer;
+    timer.start();
+    qint64 written = 0;
+    while (server.channelDataReceived() - receivedBefore < BytesPerRun) {
+        while (written < BytesPerRun && process.bytesToWrite() < WriteBufferLimit) {
+            const qint64 bytes = process.write(data);
+            if (bytes <= 0)
+                return false;
+            written += bytes;
+        }
+        if (!processEvents(client))
+            return false;
+    }
+    *nsecs = timer.nsecsElapsed();
+    *copiesPerByte = double(sshCopiedBytes() - copiedBefore) / BytesPerRun;
+    return true;
+}
+
+} // anonymous namespace
+
+namespace Benchmarks {
+
+void runAssemblyBenchmark()
+{
+    LoopbackSshServer server;
+    if (!server.listen()) {
+        std::cerr << "  Could not listen on the loopback interface." << std::endl;
+        return;
+    }
+    SshConnectionPrivate client(0, server.connectionParameters());
+    if (!server.connectClient(client))
+        return;
+    const QList<QSharedPointer<SshRemoteProcess> > processes
+            = server.startProcesses(client, 1);
+    if (processes.isEmpty())
+        return;
+
+    const int payloadSizes[] = { 1024, 32 * 1024 };
+    for (size_t i = 0; i < sizeof payloadSizes / sizeof payloadSizes[0]; ++i) {
+        const QByteArray data(payloadSizes[i], 'x');
+        std::cout << " Write size " << data.size() << ":" << std::endl;
+        qint64 nsecs;
+        double copiesPerByte;
+        if (!runWrites(server, client, *processes.first(), data, &nsecs, &copiesPerByte)) {
+            std::cerr << "  Lost the connection to the loopback server." << std::endl;
+            return;
+        }
+        printThroughput("SshRemoteProcess::write()", BytesPerRun, nsecs);
+        std::cout << "    " << std::setprecision(2) << copiesPerByte
+                  << " bytes copied per byte written" << std::endl;
+    }
+}
+
+} // namespace Benchmarks
@@ -0,0 +1,69 @@
+/**************************************************************************
+**
+** This file is part of Qt Creator
+**
+** Copyright (c) 2012 Nokia Corporation and/or its subsidiary(-ies).
+**
+** Contact: http://www.qt-project.org/
+**
+**
+** GNU Lesser General Public License Usage
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.LGPL included in the packaging of this file.
+** Please review the following information to ensure the GNU Lesser General
+** Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights. These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** Other Usage
+**
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and Nokia.
+**
+**
+**************************************************************************/
+
+#ifndef BENCHMARKS_H
+#define BENCHMARKS_H
+
+#include <QtGlobal>
+
+#include <iomanip>
+#include <iostream>
+
+namespace Benchmarks {
+
+void runCipherBenchmark();
+void runMacBenchmark();
+void runKeyExchangeBenchmark();
+void runSmallPacketBenchmark();
+void runDispatchBenchmark();
+void runAssemblyBenchmark();
+void runSyscallBenchmark();
+void runWindowBenchmark();
+void runOutputBenchmark();
+void runLatencyBenchmark();
+void runTimerBenchmark();
+void runPipelineBenchmark();
+void runUploadBenchmark();
+
+inline double megaBytesPerSecond(qint64 bytes, qint64 nsecs)
+{
+    return nsecs > 0 ? (bytes / (1024.0 * 1024.0)) / (nsecs / 1e9) : 0.0;
+}
+
+inline void printThroughput(const char *label, qint64 bytes, qint64 nsecs)
+{
+    std::cout << "  " << std::left << std::setw(40) << label << std::right
+              << std::fixed << std::setprecision(1) << std::setw(10)
+              << megaBytesPerSecond(bytes, nsecs) << " MB/s" << std::endl;
+}
+
+} // namespace Benchmarks
+
+#endif // BENCHMARKS_H
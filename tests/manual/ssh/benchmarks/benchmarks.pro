@@ -0,0 +1,12 @@
+include(../loopback/loopback.pri)
+
+# With QSSH_COUNT_COPIES, the outgoing data path counts the bytes it copies.
+DEFINES += QSSH_COUNT_COPIES
+
+TARGET=benchmarks
+SOURCES += main.cpp cipherbenchmark.cpp macbenchmark.cpp kexbenchmark.cpp \
+    smallpacketbenchmark.cpp dispatchbenchmark.cpp assemblybenchmark.cpp \
+    syscallbenchmark.cpp windowbenchmark.cpp outputbenchmark.cpp \
+    latencybenchmark.cpp timerbenchmark.cpp pipelinebenchmark.cpp \
+    uploadbenchmark.cpp
+HEADERS += benchmarks.h
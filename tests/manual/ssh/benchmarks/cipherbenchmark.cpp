@@ -0,0 +1,123 @@
+/**************************************************************************
+**
+** This file is part of Qt Creator
+**
+** Copyright (c) 2012 Nokia Corporation and/or its subsidiary(-ies).
+**
+** Contact: http://www.qt-project.org/
+**
+**
+** GNU Lesser General Public License Usage
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.LGPL included in the packaging of this file.
+** Please review the following information to ensure the GNU Lesser General
+** Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights. These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** Other Usage
+**
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and Nokia.
+**
+**
+**************************************************************************/
+
+#include "benchmarks.h"
+
+#include <botan/auto_rng.h>
+#include <botan/cipher_filter.h>
+#include <botan/cipher_mode.h>
+#include <botan/pipe.h>
+
+#include <QByteArray>
+#include <QElapsedTimer>
+
+#include <memory>
+
+using namespace Botan;
+
+namespace {
+
+const int PacketSize = 32 * 1024; // Full-sized channel data packet.
+const int PacketCount = 8 * 1024;
+
+struct CipherInfo
+{
+    const char *rfcName;
+    const char *botanName;
+};
+
+const CipherInfo Ciphers[] = {
+    { "aes128-ctr", "AES-128/CTR" },
+    { "aes128-cbc", "AES-128/CBC/NoPadding" },
+    { "3des-cbc", "TripleDES/CBC/NoPadding" }
+};
+
+// What SshAbstractCryptoFacility::convert() used to do: one Pipe message per packet.
+qint64 encryptViaPipe(const char *algo, const SymmetricKey &key,
+    const InitializationVector &iv, QByteArray &packet)
+{
+    Cipher_Mode_Filter * const filter
+        = new Cipher_Mode_Filter(Cipher_Mode::create_or_throw(algo, ENCRYPTION).release());
+    filter->set_key(key);
+    filter->set_iv(iv);
+    Pipe pipe(filter);
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < PacketCount; ++i) {
+        pipe.process_msg(reinterpret_cast<const uint8_t *>(packet.constData()), packet.size());
+        pipe.read(reinterpret_cast<uint8_t *>(packet.data()), packet.size(),
+            pipe.message_count() - 1);
+    }
+    return timer.nsecsElapsed();
+}
+
+// What it does now: process the packet buffer in place.
+qint64 encryptInPlace(const char *algo, const SymmetricKey &key,
+    const InitializationVector &iv, QByteArray &packet)
+{
+    const std::unique_ptr<Cipher_Mode> mode = Cipher_Mode::create_or_throw(algo, ENCRYPTION);
+    mode->set_key(key);
+    mode->start(iv.bits_of());
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < PacketCount; ++i)
+        mode->process(reinterpret_cast<uint8_t *>(packet.data()), packet.size());
+    return timer.nsecsElapsed();
+}
+
+} // anonymous namespace
+
+namespace Benchmarks {
+
+void runCipherBenchmark()
+{
+    AutoSeeded_RNG rng;
+    QByteArray packet(PacketSize, 'x');
+    const qint64 totalBytes = qint64(PacketSize) * PacketCount;
+
+    for (size_t i = 0; i < sizeof Ciphers / sizeof Ciphers[0]; ++i) {
+        const CipherInfo &cipher = Ciphers[i];
+        const std::unique_ptr<Cipher_Mode> proto
+            = Cipher_Mode::create_or_throw(cipher.botanName, ENCRYPTION);
+        const SymmetricKey key(rng, proto->key_spec().maximum_keylength());
+        const InitializationVector iv(rng, proto->default_nonce_length());
+
+        std::cout << cipher.rfcName << ", " << PacketCount << " packets of "
+                  << PacketSize << " bytes:" << std::endl;
+        const qint64 pipeTime = encryptViaPipe(cipher.botanName, key, iv, packet);
+        const qint64 inPlaceTime = encryptInPlace(cipher.botanName, key, iv, packet);
+        printThroughput("Pipe/Cipher_Mode_Filter", totalBytes, pipeTime);
+        printThroughput("Cipher_Mode::process() in place", totalBytes, inPlaceTime);
+    }
+}
+
+} // namespace Benchmarks
@@ -0,0 +1,156 @@
+/**************************************************************************
+**
+** This file is part of Qt Creator
+**
+** Copyright (c) 2012 Nokia Corporation and/or its subsidiary(-ies).
+**
+** Contact: http://www.qt-project.org/
+**
+**
+** GNU Lesser General Public License Usage
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.LGPL included in the packaging of this file.
+** Please review the following information to ensure the GNU Lesser General
+** Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights. These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** Other Usage
+**
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and Nokia.
+**
+**
+**************************************************************************/
+
+#include "benchmarks.h"
+#include "loopbackserver.h"
+
+#include "sshconnection_p.h"
+#include "sshremoteprocess.h"
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QList>
+#include <QSharedPointer>
+
+using namespace QSsh;
+using namespace QSsh::Internal;
+
+/*
+ * Has the loopback server send small packets to remote processes of a real
+ * SshConnectionPrivate and measures how long the client takes per packet.
+ * CHANNEL_DATA takes the fast path in handleCurrentPacket(), while
+ * CHANNEL_EXTENDED_DATA goes through the handler table and its state check.
+ * With one channel, SshChannelManager finds it in m_lastChannel every time;
+ * with the channels taking turns, that cache never hits. Everything else,
+ * in particular decryption and the MAC check, is the same for all variants,
+ * so the differences between them are what dispatching contributes. The time
+ * the server spends building its packets is not counted.
+ */
+
+namespace {
+
+const int MaxPacketCount = 300 * 1000;
+const qint64 MaxBytesPerRun = 128 * 1024 * 1024;
+const int ChannelCount = 8;
+
+struct Variant
+{
+    const char *label;
+    int channelCount;
+    bool extendedData;
+};
+
+bool runDispatch(LoopbackSshServer &server, SshConnectionPrivate &client,
+        const QList<QSharedPointer<SshRemoteProcess> > &processes, const Variant &variant,
+        const QByteArray &payload, int packetCount, qint64 *nsecs)
+{
+    const QList<quint32> channels = server.channels();
+    const qint64 queueingBefore = server.nsecsSpentQueueing();
+    QElapsedTimer timer;
+    timer.start();
+    int packetsSent = 0;
+    qint64 bytesReceived = 0;
+    while (bytesReceived < qint64(packetCount) * payload.size()) {
+        while (packetsSent < packetCount) {
+            const quint32 channel = channels.at(packetsSent % variant.channelCount);
+            if (server.sendWindow(channel) < quint32(payload.size()))
+                break;
+            if (variant.extendedData)
+                server.queueExtendedData(channel, payload);
+            else
+                server.queueChannelData(channel, payload);
+            ++packetsSent;
+        }
+        server.flush();
+        if (!processEvents(client))
+            return false;
+        foreach (const QSharedPointer<SshRemoteProcess> &process, processes) {
+            bytesReceived += process->readAllStandardOutput().size();
+            bytesReceived += process->readAllStandardError().size();
+        }
+    }
+    *nsecs = timer.nsecsElapsed() - (server.nsecsSpentQueueing() - queueingBefore);
+    return true;
+}
+
+void printPerPacket(const char *label, int packetCount, qint64 nsecs)
+{
+    const double nsecsPerPacket = double(nsecs) / packetCount;
+    std::cout << "  " << std::left << std::setw(40) << label << std::right
+              << std::fixed << std::setprecision(1) << std::setw(10) << nsecsPerPacket
+              << " ns/packet" << std::setw(12) << 1e3 / nsecsPerPacket << " Mpackets/s"
+              << std::endl;
+}
+
+} // anonymous namespace
+
+namespace Benchmarks {
+
+void runDispatchBenchmark()
+{
+    LoopbackSshServer server;
+    if (!server.listen()) {
+        std::cerr << "  Could not listen on the loopback interface." << std::endl;
+        return;
+    }
+    SshConnectionPrivate client(0, server.connectionParameters());
+    if (!server.connectClient(client))
+        return;
+    const QList<QSharedPointer<SshRemoteProcess> > processes
+            = server.startProcesses(client, ChannelCount);
+    if (processes.isEmpty())
+        return;
+
+    const Variant variants[] = {
+        { "CHANNEL_DATA, one channel", 1, false },
+        { "CHANNEL_DATA, channels taking turns", ChannelCount, false },
+        { "CHANNEL_EXTENDED_DATA, one channel", 1, true }
+    };
+
+    // A single keystroke and a full packet as sent by OpenSSH during transfers.
+    const int payloadSizes[] = { 1, 32 * 1024 };
+    for (size_t i = 0; i < sizeof payloadSizes / sizeof payloadSizes[0]; ++i) {
+        const QByteArray payload(payloadSizes[i], 'x');
+        const int packetCount = int(qMin<qint64>(MaxPacketCount,
+                MaxBytesPerRun / payload.size()));
+        std::cout << " Payload size " << payload.size() << ":" << std::endl;
+        for (size_t j = 0; j < sizeof variants / sizeof variants[0]; ++j) {
+            qint64 nsecs;
+            if (!runDispatch(server, client, processes, variants[j], payload, packetCount,
+                    &nsecs)) {
+                std::cerr << "  Lost the connection to the loopback server." << std::endl;
+                return;
+            }
+            printPerPacket(variants[j].label, packetCount, nsecs);
+        }
+    }
+}
+
+} // namespace Benchmarks
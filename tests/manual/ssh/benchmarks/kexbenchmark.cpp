@@ -0,0 +1,120 @@
+/**************************************************************************
+**
+** This file is part of Qt Creator
+**
+** Copyright (c) 2012 Nokia Corporation and/or its subsidiary(-ies).
+**
+** Contact: http://www.qt-project.org/
+**
+**
+** GNU Lesser General Public License Usage
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.LGPL included in the packaging of this file.
+** Please review the following information to ensure the GNU Lesser General
+** Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights. These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** Other Usage
+**
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and Nokia.
+**
+**
+**************************************************************************/
+
+#include "benchmarks.h"
+#include "loopbackserver.h"
+
+#include "sshcapabilities_p.h"
+#include "sshconnection.h"
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QEventLoop>
+
+using namespace QSsh;
+using namespace QSsh::Internal;
+
+/*
+ * Times SshConnection::connectToHost() up to connected() against the loopback
+ * server, which offers only the key exchange method under test, so the client
+ * has to use it. Everything a real connection does is included: the TCP
+ * handshake, the version exchange, the key exchange with host key
+ * verification, and password authentication. The time the server spends on
+ * its side of the key exchange is not counted.
+ */
+
+namespace {
+
+struct Method
+{
+    const QByteArray &name;
+    int connectionCount;
+};
+
+bool connectOnce(const QByteArray &method, qint64 *nsecs)
+{
+    LoopbackSshServer server;
+    server.setKeyExchangeMethod(method);
+    if (!server.listen()) {
+        std::cerr << "  Could not listen on the loopback interface." << std::endl;
+        return false;
+    }
+    SshConnection connection(server.connectionParameters());
+    QEventLoop loop;
+    QObject::connect(&connection, SIGNAL(connected()), &loop, SLOT(quit()));
+    QObject::connect(&connection, SIGNAL(error(QSsh::SshError)), &loop, SLOT(quit()));
+    QElapsedTimer timer;
+    timer.start();
+    connection.connectToHost();
+    loop.exec();
+    if (connection.state() != SshConnection::Connected) {
+        std::cerr << "  Could not connect to the loopback server: "
+                  << qPrintable(connection.errorString()) << std::endl;
+        return false;
+    }
+    *nsecs = timer.nsecsElapsed() - server.nsecsSpentReceiving();
+    return true;
+}
+
+void printPerConnection(const char *label, qint64 nsecs, int count)
+{
+    const double usecs = double(nsecs) / count / 1000;
+    std::cout << "  " << std::left << std::setw(40) << label << std::right
+              << std::fixed << std::setprecision(1) << std::setw(10) << usecs
+              << " us/connection" << std::setw(10) << 1e6 / usecs << " connections/s"
+              << std::endl;
+}
+
+} // anonymous namespace
+
+namespace Benchmarks {
+
+void runKeyExchangeBenchmark()
+{
+    const Method methods[] = {
+        { SshCapabilities::Curve25519Sha256, 200 },
+        { SshCapabilities::EcdhNistp256, 200 },
+        { SshCapabilities::DiffieHellmanGroup14Sha1, 50 },
+        { SshCapabilities::DiffieHellmanGroup1Sha1, 100 }
+    };
+    for (size_t i = 0; i < sizeof methods / sizeof methods[0]; ++i) {
+        qint64 totalNsecs = 0;
+        for (int j = 0; j < methods[i].connectionCount; ++j) {
+            qint64 nsecs;
+            if (!connectOnce(methods[i].name, &nsecs))
+                return;
+            totalNsecs += nsecs;
+        }
+        printPerConnection(methods[i].name.constData(), totalNsecs,
+                methods[i].connectionCount);
+    }
+}
+
+} // namespace Benchmarks
@@ -0,0 +1,134 @@
+/**************************************************************************
+**
+** This file is part of Qt Creator
+**
+** Copyright (c) 2012 Nokia Corporation and/or its subsidiary(-ies).
+**
+** Contact: http://www.qt-project.org/
+**
+**
+** GNU Lesser General Public License Usage
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.LGPL included in the packaging of this file.
+** Please review the following information to ensure the GNU Lesser General
+** Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights. These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** Other Usage
+**
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and Nokia.
+**
+**
+**************************************************************************/
+
+#include "benchmarks.h"
+#include "loopbackserver.h"
+
+#include "sshconnection_p.h"
+#include "sshremoteprocess.h"
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QSharedPointer>
+
+using namespace QSsh;
+using namespace QSsh::Internal;
+
+/*
+ * Opens two channels on a real connection to the loopback server: a shell,
+ * whose keystrokes the server echoes, and a bulk upload that always has
+ * several megabytes waiting to be sent. Each keystroke is written once the
+ * previous one has come back, and the round trip is measured. Both channels
+ * go through the SshChannelScheduler in SshChannelManager::sendScheduledData(),
+ * which keeps only 128 KB of scheduled data in the socket and lets the
+ * channels take turns, so a keystroke does not queue up behind the upload's
+ * backlog. The server handles all traffic in the same thread, so it is the
+ * bottleneck of the link.
+ */
+
+namespace {
+
+const int KeystrokeCount = 2000;
+const qint64 BulkBacklog = 4 * 1024 * 1024;
+const int BulkWriteSize = 32 * 1024;
+
+bool runKeystrokes(LoopbackSshServer &server, SshConnectionPrivate &client,
+        SshRemoteProcess &shell, SshRemoteProcess &bulk, bool withBulk)
+{
+    const QByteArray bulkData(BulkWriteSize, 'b');
+    const qint64 bulkBytesBefore = server.channelDataReceived();
+    qint64 totalLatency = 0;
+    qint64 maxLatency = 0;
+    QElapsedTimer runTimer;
+    runTimer.start();
+    for (int i = 0; i < KeystrokeCount; ++i) {
+        QElapsedTimer keystrokeTimer;
+        keystrokeTimer.start();
+        shell.write("k", 1);
+        while (shell.readAllStandardOutput().isEmpty()) {
+            while (withBulk && bulk.bytesToWrite() < BulkBacklog)
+                bulk.write(bulkData);
+            if (!processEvents(client))
+                return false;
+        }
+        const qint64 latency = keystrokeTimer.nsecsElapsed();
+        totalLatency += latency;
+        maxLatency = qMax(maxLatency, latency);
+    }
+    const qint64 nsecs = runTimer.nsecsElapsed();
+
+    // Whatever the upload has left is not counted, so it must not delay the next run.
+    const qint64 bulkBytes = server.channelDataReceived() - bulkBytesBefore - KeystrokeCount;
+    while (bulk.bytesToWrite() > 0) {
+        if (!processEvents(client))
+            return false;
+    }
+
+    std::cout << "  " << std::left << std::setw(40)
+              << (withBulk ? "next to upload" : "idle connection") << std::right
+              << std::fixed << std::setprecision(1) << std::setw(10)
+              << double(totalLatency) / KeystrokeCount / 1000 << " us avg" << std::setw(10)
+              << maxLatency / 1000.0 << " us max" << std::setw(10)
+              << megaBytesPerSecond(bulkBytes, nsecs) << " MB/s bulk" << std::endl;
+    return true;
+}
+
+} // anonymous namespace
+
+namespace Benchmarks {
+
+void runLatencyBenchmark()
+{
+    LoopbackSshServer server;
+    if (!server.listen()) {
+        std::cerr << "  Could not listen on the loopback interface." << std::endl;
+        return;
+    }
+    SshConnectionPrivate client(0, server.connectionParameters());
+    if (!server.connectClient(client))
+        return;
+    const QList<QSharedPointer<SshRemoteProcess> > processes
+            = server.startProcesses(client, 2);
+    if (processes.isEmpty())
+        return;
+    server.setEchoing(server.channels().first(), true);
+
+    std::cout << " Keystroke round trip over the loopback server:" << std::endl;
+    const bool withBulk[] = { false, true };
+    for (size_t i = 0; i < sizeof withBulk / sizeof withBulk[0]; ++i) {
+        if (!runKeystrokes(server, client, *processes.first(), *processes.last(),
+                withBulk[i])) {
+            std::cerr << "  Lost the connection to the loopback server." << std::endl;
+            return;
+        }
+    }
+}
+
+} // namespace Benchmarks
@@ -0,0 +1,141 @@
+/**************************************************************************
+**
+** This file is part of Qt Creator
+**
+** Copyright (c) 2012 Nokia Corporation and/or its subsidiary(-ies).
+**
+** Contact: http://www.qt-project.org/
+**
+**
+** GNU Lesser General Public License Usage
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.LGPL included in the packaging of this file.
+** Please review the following information to ensure the GNU Lesser General
+** Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights. These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** Other Usage
+**
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and Nokia.
+**
+**
+**************************************************************************/
+
+#include "benchmarks.h"
+
+#include <botan/auto_rng.h>
+#include <botan/cipher_mode.h>
+#include <botan/hash.h>
+#include <botan/hmac.h>
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QtEndian>
+
+#include <memory>
+
+using namespace Botan;
+
+namespace {
+
+const int PacketSizes[] = { 64, 1024, 32 * 1024 };
+const qint64 BytesPerRun = 256 * 1024 * 1024;
+
+struct MacInfo
+{
+    const char *rfcName;
+    const char *hashName;
+};
+
+const MacInfo Macs[] = {
+    { "hmac-sha1", "SHA-1" },
+    { "hmac-sha2-256", "SHA-256" },
+    { "hmac-sha2-512", "SHA-512" }
+};
+
+// Computes and compares the MAC the way SshAbstractCryptoFacility::checkMac() does.
+qint64 verifyPackets(HMAC &hMac, QByteArray &packet, int count)
+{
+    const size_t macLength = hMac.output_length();
+    secure_vector<byte> expected(macLength);
+    int mismatches = 0; // Keeps the comparison from being optimized away.
+    QElapsedTimer timer;
+    timer.start();
+    for (int seqNr = 0; seqNr < count; ++seqNr) {
+        const quint32 seqNrBe = qToBigEndian<quint32>(seqNr);
+        hMac.update(reinterpret_cast<const byte *>(&seqNrBe), sizeof seqNrBe);
+        hMac.update(reinterpret_cast<const byte *>(packet.constData()), packet.size());
+        hMac.final(expected.data());
+        if (!same_mem(expected.data(), reinterpret_cast<const byte *>(packet.constData()),
+                macLength)) {
+            ++mismatches;
+        }
+    }
+    const qint64 nsecs = timer.nsecsElapsed();
+    if (mismatches != count)
+        std::cerr << "Unexpected MAC match." << std::endl;
+    return nsecs;
+}
+
+// Rejecting a corrupt packet: MAC-then-encrypt has to decrypt it first.
+qint64 rejectMacThenEncrypt(Cipher_Mode &cipher, HMAC &hMac, QByteArray &packet, int count)
+{
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < count; ++i)
+        cipher.process(reinterpret_cast<byte *>(packet.data()), packet.size());
+    const qint64 decryptionTime = timer.nsecsElapsed();
+    return decryptionTime + verifyPackets(hMac, packet, count);
+}
+
+void printPerPacket(const char *label, qint64 nsecs, int count)
+{
+    std::cout << "  " << std::left << std::setw(40) << label << std::right
+              << std::fixed << std::setprecision(1) << std::setw(10)
+              << double(nsecs) / count << " ns/packet" << std::endl;
+}
+
+} // anonymous namespace
+
+namespace Benchmarks {
+
+void runMacBenchmark()
+{
+    AutoSeeded_RNG rng;
+    for (size_t i = 0; i < sizeof PacketSizes / sizeof PacketSizes[0]; ++i) {
+        const int packetSize = PacketSizes[i];
+        const int packetCount = BytesPerRun / packetSize;
+        QByteArray packet(packetSize, 'x');
+        std::cout << "Verifying " << packetCount << " packets of " << packetSize
+                  << " bytes:" << std::endl;
+
+        for (size_t j = 0; j < sizeof Macs / sizeof Macs[0]; ++j) {
+            HMAC hMac(HashFunction::create_or_throw(Macs[j].hashName).release());
+            hMac.set_key(rng.random_vec(hMac.output_length()));
+            printPerPacket(Macs[j].rfcName, verifyPackets(hMac, packet, packetCount),
+                    packetCount);
+        }
+
+        // A corrupt packet costs a MAC computation with encrypt-then-MAC,
+        // but a decryption plus a MAC computation otherwise.
+        const std::unique_ptr<Cipher_Mode> cipher
+            = Cipher_Mode::create_or_throw("AES-128/CTR", DECRYPTION);
+        cipher->set_key(rng.random_vec(cipher->key_spec().maximum_keylength()));
+        cipher->start(rng.random_vec(cipher->default_nonce_length()));
+        HMAC hMac(HashFunction::create_or_throw("SHA-256").release());
+        hMac.set_key(rng.random_vec(hMac.output_length()));
+        printPerPacket("reject, aes128-ctr + hmac-sha2-256",
+                rejectMacThenEncrypt(*cipher, hMac, packet, packetCount), packetCount);
+        printPerPacket("reject, aes128-ctr + hmac-sha2-256-etm",
+                verifyPackets(hMac, packet, packetCount), packetCount);
+    }
+}
+
+} // namespace Benchmarks
@@ -0,0 +1,96 @@
+/**************************************************************************
+**
+** This file is part of Qt Creator
+**
+** Copyright (c) 2012 Nokia Corporation and/or its subsidiary(-ies).
+**
+** Contact: http://www.qt-project.org/
+**
+**
+** GNU Lesser General Public License Usage
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.LGPL included in the packaging of this file.
+** Please review the following information to ensure the GNU Lesser General
+** Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights. These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** Other Usage
+**
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and Nokia.
+**
+**
+**************************************************************************/
+
+#include "benchmarks.h"
+
+#include <QCoreApplication>
+#include <QStringList>
+
+#include <cstdlib>
+#include <iostream>
+
+namespace {
+
+struct Benchmark
+{
+    const char *name;
+    void (*run)();
+};
+
+const Benchmark AllBenchmarks[] = {
+    { "cipher", &Benchmarks::runCipherBenchmark },
+    { "mac", &Benchmarks::runMacBenchmark },
+    { "kex", &Benchmarks::runKeyExchangeBenchmark },
+    { "smallpackets", &Benchmarks::runSmallPacketBenchmark },
+    { "dispatch", &Benchmarks::runDispatchBenchmark },
+    { "assembly", &Benchmarks::runAssemblyBenchmark },
+    { "syscalls", &Benchmarks::runSyscallBenchmark },
+    { "window", &Benchmarks::runWindowBenchmark },
+    { "output", &Benchmarks::runOutputBenchmark },
+    { "latency", &Benchmarks::runLatencyBenchmark },
+    { "timers", &Benchmarks::runTimerBenchmark },
+    { "pipeline", &Benchmarks::runPipelineBenchmark },
+    { "upload", &Benchmarks::runUploadBenchmark }
+};
+
+void printUsage(const char *appName)
+{
+    std::cerr << "Usage: " << appName << " [benchmark ...]" << std::endl
+              << "Available benchmarks:";
+    for (size_t i = 0; i < sizeof AllBenchmarks / sizeof AllBenchmarks[0]; ++i)
+        std::cerr << ' ' << AllBenchmarks[i].name;
+    std::cerr << std::endl << "Without arguments, all benchmarks are run." << std::endl;
+}
+
+} // anonymous namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QStringList names = app.arguments().mid(1);
+    const size_t benchmarkCount = sizeof AllBenchmarks / sizeof AllBenchmarks[0];
+    if (names.isEmpty()) {
+        for (size_t i = 0; i < benchmarkCount; ++i)
+            names << QLatin1String(AllBenchmarks[i].name);
+    }
+
+    foreach (const QString &name, names) {
+        size_t i = 0;
+        while (i < benchmarkCount && name != QLatin1String(AllBenchmarks[i].name))
+            ++i;
+        if (i == benchmarkCount) {
+            printUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        std::cout << "Running benchmark '" << AllBenchmarks[i].name << "'..." << std::endl;
+        AllBenchmarks[i].run();
+    }
+    return EXIT_SUCCESS;
+}
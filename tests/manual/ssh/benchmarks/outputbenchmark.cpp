@@ -0,0 +1,191 @@
+/**************************************************************************
+**
+** This file is part of Qt Creator
+**
+** Copyright (c) 2012 Nokia Corporation and/or its subsidiary(-ies).
+**
+** Contact: http://www.qt-project.org/
+**
+**
+** GNU Lesser General Public License Usage
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.LGPL included in the packaging of this file.
+** Please review the following information to ensure the GNU Lesser General
+** Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights. These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** Other Usage
+**
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and Nokia.
+**
+**
+**************************************************************************/
+
+#include "benchmarks.h"
+#include "loopbackserver.h"
+
+#include "sshconnection_p.h"
+#include "sshremoteprocess.h"
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QObject>
+#include <QSharedPointer>
+
+using namespace QSsh;
+using namespace QSsh::Internal;
+
+/*
+ * Has the loopback server stream command output to a remote process of a real
+ * SshConnectionPrivate. SshRemoteProcessPrivate::handleChannelDataInternal()
+ * stores the data of every packet in the process's SshReadQueue, and a slot
+ * connected to readyReadStandardOutput() takes it out again: either all at
+ * once with readAllStandardOutput(), in small pieces like a parser would with
+ * read(), or chunk by chunk with readChunk(). Decryption is the same for all
+ * variants, so the differences between them come from the read side. The time
+ * the server spends building its packets is not counted.
+ */
+
+namespace {
+
+const qint64 BulkBytes = 256 * 1024 * 1024;
+const int BulkPacketSize = 32 * 1024;
+const qint64 ChattyBytes = 16 * 1024 * 1024;
+const int ChattyPacketSize = 100;
+const int SmallReadSize = 512;
+
+enum ReadMode { ReadAll, ReadSmallPieces, ReadChunks };
+
+class Reader : public QObject
+{
+    Q_OBJECT
+public:
+    Reader(SshRemoteProcess &process, ReadMode mode)
+        : bytesRead(0), checksum(0), m_process(process), m_mode(mode)
+    {
+        connect(&process, SIGNAL(readyReadStandardOutput()), SLOT(handleReadyRead()));
+    }
+
+    qint64 bytesRead;
+    quint32 checksum; // Keeps the compiler from dropping the reads.
+
+public slots:
+    void handleReadyRead()
+    {
+        switch (m_mode) {
+        case ReadAll:
+            account(m_process.readAllStandardOutput());
+            break;
+        case ReadSmallPieces: {
+            char piece[SmallReadSize];
+            qint64 pieceSize;
+            while ((pieceSize = m_process.read(piece, sizeof piece)) > 0) {
+                bytesRead += pieceSize;
+                checksum += quint8(piece[0]);
+            }
+            break;
+        }
+        case ReadChunks:
+            for (QByteArray chunk = m_process.readChunk(); !chunk.isEmpty();
+                 chunk = m_process.readChunk()) {
+                account(chunk);
+            }
+            break;
+        }
+    }
+
+private:
+    void account(const QByteArray &data)
+    {
+        bytesRead += data.size();
+        if (!data.isEmpty())
+            checksum += quint8(data.at(0));
+    }
+
+    SshRemoteProcess &m_process;
+    const ReadMode m_mode;
+};
+
+bool runStream(LoopbackSshServer &server, SshConnectionPrivate &client,
+        SshRemoteProcess &process, ReadMode mode, qint64 totalBytes, int packetSize,
+        const char *label)
+{
+    const quint32 channel = server.channels().first();
+    const QByteArray payload(packetSize, 'o');
+    Reader reader(process, mode);
+    const qint64 queueingBefore = server.nsecsSpentQueueing();
+    QElapsedTimer timer;
+    timer.start();
+    qint64 sent = 0;
+    while (reader.bytesRead < totalBytes) {
+        while (sent < totalBytes && server.sendWindow(channel) >= quint32(packetSize)) {
+            server.queueChannelData(channel, payload);
+            sent += packetSize;
+        }
+        server.flush();
+        if (!processEvents(client)) {
+            std::cerr << "  Lost the connection to the loopback server." << std::endl;
+            return false;
+        }
+    }
+    printThroughput(label, totalBytes,
+            timer.nsecsElapsed() - (server.nsecsSpentQueueing() - queueingBefore));
+    return true;
+}
+
+} // anonymous namespace
+
+namespace Benchmarks {
+
+void runOutputBenchmark()
+{
+    LoopbackSshServer server;
+    if (!server.listen()) {
+        std::cerr << "  Could not listen on the loopback interface." << std::endl;
+        return;
+    }
+    SshConnectionPrivate client(0, server.connectionParameters());
+    if (!server.connectClient(client))
+        return;
+    const QList<QSharedPointer<SshRemoteProcess> > processes
+            = server.startProcesses(client, 1);
+    if (processes.isEmpty())
+        return;
+    SshRemoteProcess &process = *processes.first();
+
+    std::cout << " " << BulkBytes / (1024 * 1024) << " MB in " << BulkPacketSize / 1024
+              << " KB packets, reading everything:" << std::endl;
+    if (!runStream(server, client, process, ReadAll, BulkBytes, BulkPacketSize,
+                   "readAllStandardOutput()")
+            || !runStream(server, client, process, ReadChunks, BulkBytes, BulkPacketSize,
+                          "readChunk()")) {
+        return;
+    }
+
+    std::cout << " " << BulkBytes / (1024 * 1024) << " MB in " << BulkPacketSize / 1024
+              << " KB packets, reading " << SmallReadSize << " bytes at a time:" << std::endl;
+    if (!runStream(server, client, process, ReadSmallPieces, BulkBytes, BulkPacketSize,
+                   "read()")) {
+        return;
+    }
+
+    std::cout << " " << ChattyBytes / (1024 * 1024) << " MB in " << ChattyPacketSize
+              << " byte packets, reading everything:" << std::endl;
+    if (!runStream(server, client, process, ReadAll, ChattyBytes, ChattyPacketSize,
+                   "readAllStandardOutput()")) {
+        return;
+    }
+    runStream(server, client, process, ReadChunks, ChattyBytes, ChattyPacketSize,
+              "readChunk()");
+}
+
+} // namespace Benchmarks
+
+#include "outputbenchmark.moc"
@@ -0,0 +1,131 @@
+/**************************************************************************
+**
+** This file is part of Qt Creator
+**
+** Copyright (c) 2012 Nokia Corporation and/or its subsidiary(-ies).
+**
+** Contact: http://www.qt-project.org/
+**
+**
+** GNU Lesser General Public License Usage
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.LGPL included in the packaging of this file.
+** Please review the following information to ensure the GNU Lesser General
+** Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights. These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** Other Usage
+**
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and Nokia.
+**
+**
+**************************************************************************/
+
+#include "benchmarks.h"
+
+#include "sftprequestpipeline_p.h"
+
+#include <QQueue>
+
+using QSsh::Internal::SftpRequestPipeline;
+
+/*
+ * Simulates an SFTP download over links with different round trip times and
+ * bandwidths. Every READ request takes half a round trip to the server, whose
+ * 32000 byte reply then queues for the link and takes another half round trip
+ * back. The client sends a new request for every reply, keeping a fixed number
+ * of them in flight (the former behavior) or as many as SftpRequestPipeline
+ * asks for. Time is simulated, so the results do not depend on the machine.
+ */
+
+namespace {
+
+const qint64 SimulatedTime = 30 * 1000 * 1000; // In microseconds.
+const quint32 ChunkSize = 32000;
+const quint32 ReplySize = ChunkSize + 13 + 9 + 36; // SFTP, SSH channel and packet overhead.
+
+struct Link
+{
+    int roundTripTime; // In milliseconds.
+    int megaBitsPerSecond;
+};
+
+struct Request
+{
+    quint32 id;
+    qint64 time;
+};
+
+void simulate(const Link &link, bool adaptive)
+{
+    SftpRequestPipeline pipeline;
+    if (!adaptive)
+        pipeline.setDepthLimits(SftpRequestPipeline::InitialDepth, SftpRequestPipeline::InitialDepth);
+    const qint64 oneWayDelay = link.roundTripTime * 1000 / 2;
+    const double microSecsPerByte = 8.0 / link.megaBitsPerSecond;
+    QQueue<Request> toServer;
+    QQueue<Request> toClient;
+    qint64 linkFreeAt = 0;
+    qint64 now = 0;
+    qint64 bytes = 0;
+    int inFlight = 0;
+    quint32 nextRequestId = 0;
+
+    while (true) {
+        while (inFlight < pipeline.depth()) {
+            const Request request = { nextRequestId++, now + oneWayDelay };
+            pipeline.requestSent(request.id, now);
+            toServer.enqueue(request);
+            ++inFlight;
+        }
+
+        if (!toServer.isEmpty()
+                && (toClient.isEmpty() || toServer.head().time <= toClient.head().time)) {
+            Request request = toServer.dequeue();
+            const qint64 sendStart = qMax(request.time, linkFreeAt);
+            linkFreeAt = sendStart + qint64(ReplySize * microSecsPerByte);
+            request.time = linkFreeAt + oneWayDelay;
+            toClient.enqueue(request);
+            continue;
+        }
+
+        const Request reply = toClient.dequeue();
+        now = reply.time;
+        if (now >= SimulatedTime)
+            break;
+        bytes += ChunkSize;
+        pipeline.replyReceived(reply.id, now);
+        --inFlight;
+    }
+
+    std::cout << "  " << std::left << std::setw(10) << (adaptive ? "adaptive" : "fixed")
+              << std::right << std::fixed << std::setprecision(1) << std::setw(10)
+              << Benchmarks::megaBytesPerSecond(bytes, SimulatedTime * 1000) << " MB/s"
+              << std::setw(8) << pipeline.depth() << " requests in flight" << std::endl;
+}
+
+} // anonymous namespace
+
+namespace Benchmarks {
+
+void runPipelineBenchmark()
+{
+    const Link links[] = { { 1, 1000 }, { 20, 100 }, { 100, 100 }, { 100, 1000 },
+                           { 300, 1000 } };
+    for (size_t i = 0; i < sizeof links / sizeof links[0]; ++i) {
+        std::cout << " Download over a link with " << links[i].roundTripTime
+                  << " ms round trip time and " << links[i].megaBitsPerSecond
+                  << " Mbit/s:" << std::endl;
+        simulate(links[i], false);
+        simulate(links[i], true);
+    }
+}
+
+} // namespace Benchmarks
@@ -0,0 +1,127 @@
+/**************************************************************************
+**
+** This file is part of Qt Creator
+**
+** Copyright (c) 2012 Nokia Corporation and/or its subsidiary(-ies).
+**
+** Contact: http://www.qt-project.org/
+**
+**
+** GNU Lesser General Public License Usage
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.LGPL included in the packaging of this file.
+** Please review the following information to ensure the GNU Lesser General
+** Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights. These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** Other Usage
+**
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and Nokia.
+**
+**
+**************************************************************************/
+
+#include "benchmarks.h"
+#include "loopbackserver.h"
+
+#include "sshconnection_p.h"
+#include "sshrandompool_p.h"
+#include "sshremoteprocess.h"
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QSharedPointer>
+
+using namespace QSsh;
+using namespace QSsh::Internal;
+
+/*
+ * Writes single keystrokes to a remote process on the loopback server, as
+ * interactive sessions do. Every write() goes through the channel scheduler
+ * into SshSendFacility::sendChannelDataPacket(), which has SshOutgoingPacket
+ * build a packet with 10 bytes of payload, random padding, aes128-ctr and
+ * hmac-sha2-256-etm@openssh.com. This is done once with the padding taken
+ * from the SshRandomPool and once with the pool disabled, i.e. with a call to
+ * the RNG for every packet. The time the server spends decrypting is not
+ * counted.
+ */
+
+namespace {
+
+const int KeystrokeCount = 256 * 1000;
+
+// Keystrokes written before the event loop runs, as when pasting into a
+// terminal, so that the write(2) calls do not dominate.
+const int KeystrokesPerBatch = 64;
+
+bool sendKeystrokes(LoopbackSshServer &server, SshConnectionPrivate &client,
+        SshRemoteProcess &process, qint64 *nsecs)
+{
+    const qint64 receivedBefore = server.channelDataReceived();
+    const qint64 receivingBefore = server.nsecsSpentReceiving();
+    QElapsedTimer timer;
+    timer.start();
+    for (int sent = 0; sent < KeystrokeCount; sent += KeystrokesPerBatch) {
+        for (int i = 0; i < KeystrokesPerBatch; ++i) {
+            if (process.write("x", 1) != 1)
+                return false;
+        }
+        while (server.channelDataReceived() - receivedBefore < sent + KeystrokesPerBatch) {
+            if (!processEvents(client))
+                return false;
+        }
+    }
+    *nsecs = timer.nsecsElapsed() - (server.nsecsSpentReceiving() - receivingBefore);
+    return true;
+}
+
+void printPacketsPerSecond(const char *label, qint64 nsecs)
+{
+    std::cout << "  " << std::left << std::setw(40) << label << std::right
+              << std::fixed << std::setprecision(0) << std::setw(10)
+              << KeystrokeCount / (nsecs / 1e9) << " packets/s" << std::endl;
+}
+
+} // anonymous namespace
+
+namespace Benchmarks {
+
+void runSmallPacketBenchmark()
+{
+    LoopbackSshServer server;
+    if (!server.listen()) {
+        std::cerr << "  Could not listen on the loopback interface." << std::endl;
+        return;
+    }
+    SshConnectionPrivate client(0, server.connectionParameters());
+    if (!server.connectClient(client))
+        return;
+    const QList<QSharedPointer<SshRemoteProcess> > processes
+            = server.startProcesses(client, 1);
+    if (processes.isEmpty())
+        return;
+
+    std::cout << " Sending " << KeystrokeCount << " single keystrokes:" << std::endl;
+    const bool poolEnabled[] = { false, true };
+    for (size_t i = 0; i < sizeof poolEnabled / sizeof poolEnabled[0]; ++i) {
+        SshRandomPool::setEnabled(poolEnabled[i]);
+        qint64 nsecs;
+        const bool success = sendKeystrokes(server, client, *processes.first(), &nsecs);
+        SshRandomPool::setEnabled(true);
+        if (!success) {
+            std::cerr << "  Lost the connection to the loopback server." << std::endl;
+            return;
+        }
+        printPacketsPerSecond(poolEnabled[i] ? "padding from random pool"
+                : "padding directly from RNG", nsecs);
+    }
+}
+
+} // namespace Benchmarks
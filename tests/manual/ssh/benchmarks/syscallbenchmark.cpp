@@ -0,0 +1,211 @@
+/**************************************************************************
+**
+** This file is part of Qt Creator
+**
+** Copyright (c) 2012 Nokia Corporation and/or its subsidiary(-ies).
+**
+** Contact: http://www.qt-project.org/
+**
+**
+** GNU Lesser General Public License Usage
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.LGPL included in the packaging of this file.
+** Please review the following information to ensure the GNU Lesser General
+** Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights. These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** Other Usage
+**
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and Nokia.
+**
+**
+**************************************************************************/
+
+#include "benchmarks.h"
+#include "loopbackserver.h"
+
+#include "sshconnection_p.h"
+#include "sshpacket_p.h"
+#include "sshsendfacility_p.h"
+
+#include <QByteArray>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QHostAddress>
+#include <QList>
+#include <QTcpServer>
+#include <QTcpSocket>
+
+using namespace QSsh::Internal;
+
+/*
+ * Counts the write(2) calls that SshSendFacility makes. QAbstractSocket emits
+ * bytesWritten() once for every successful write, so the number of signals is
+ * the number of syscalls.
+ * First, the facility is driven directly on a local TCP connection. It sends
+ * bursts like those it sends while handling one batch of incoming data: a few
+ * window adjustments, SFTP read requests and data packets. Each burst is sent
+ * once packet by packet and once inside an SshSendFacilityCork. The facility
+ * has no keys here, i.e. it sends packets the way it does before the first key
+ * exchange, which does not change the number of writes. Note that QTcpSocket
+ * keeps larger QByteArrays passed to write() as separate chunks of its write
+ * buffer and sends one chunk per syscall, so the uncorked variant needs several
+ * event loop iterations for a burst.
+ * Then the loopback server sends bursts of global requests to a real
+ * SshConnectionPrivate, which answers all of them from one call of
+ * handleIncomingData().
+ */
+
+namespace {
+
+const int BurstCount = 5000;
+const int PacketsPerBurst = 16;
+const int RequestBurstCount = 2000;
+const int RequestsPerBurst = 16;
+
+class WriteCounter : public QObject
+{
+    Q_OBJECT
+public:
+    WriteCounter() : count(0) {}
+    int count;
+
+public slots:
+    void handleBytesWritten() { ++count; }
+};
+
+void sendBurst(SshSendFacility &facility)
+{
+    const QByteArray readRequest(29, 'r'); // The size of an SSH_FXP_READ request.
+    const QByteArray data(32 * 1024, 'd');
+    for (int i = 0; i < 4; ++i)
+        facility.sendWindowAdjustPacket(i, 256 * 1024);
+    for (int i = 0; i < 8; ++i)
+        facility.sendChannelDataPacket(0, readRequest);
+    for (int i = 0; i < 4; ++i)
+        facility.sendChannelDataPacket(1, data);
+}
+
+void waitUntilWritten(QTcpSocket &socket, QTcpSocket &peer)
+{
+    while (socket.bytesToWrite() > 0) {
+        QCoreApplication::processEvents();
+        peer.readAll();
+    }
+    QCoreApplication::processEvents();
+    peer.readAll();
+}
+
+void runFacilityBursts(bool corked, int *writeCount, qint64 *nsecs)
+{
+    QTcpServer server;
+    server.listen(QHostAddress::LocalHost);
+    QTcpSocket socket;
+    socket.connectToHost(QHostAddress::LocalHost, server.serverPort());
+    socket.waitForConnected();
+    server.waitForNewConnection(5000);
+    QTcpSocket * const peer = server.nextPendingConnection();
+    if (!peer) {
+        std::cerr << "  Could not set up local connection." << std::endl;
+        return;
+    }
+    socket.setSocketOption(QAbstractSocket::LowDelayOption, 1);
+
+    SshSendFacility facility(&socket);
+    WriteCounter counter;
+    QObject::connect(&socket, SIGNAL(bytesWritten(qint64)), &counter,
+            SLOT(handleBytesWritten()));
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < BurstCount; ++i) {
+        if (corked) {
+            SshSendFacilityCork cork(facility);
+            sendBurst(facility);
+        } else {
+            sendBurst(facility);
+        }
+        waitUntilWritten(socket, *peer);
+    }
+    *nsecs = timer.nsecsElapsed();
+    *writeCount = counter.count;
+    delete peer;
+}
+
+bool runRequestBursts(int *writeCount, qint64 *nsecs)
+{
+    LoopbackSshServer server;
+    if (!server.listen()) {
+        std::cerr << "  Could not listen on the loopback interface." << std::endl;
+        return false;
+    }
+    SshConnectionPrivate client(0, server.connectionParameters());
+    if (!server.connectClient(client))
+        return false;
+    const QList<QTcpSocket *> sockets = client.findChildren<QTcpSocket *>();
+    Q_ASSERT(sockets.count() == 1);
+
+    WriteCounter counter;
+    QObject::connect(sockets.first(), SIGNAL(bytesWritten(qint64)), &counter,
+            SLOT(handleBytesWritten()));
+    const QByteArray request = QByteArray(1, SSH_MSG_GLOBAL_REQUEST)
+            + AbstractSshPacket::encodeString("keepalive@openssh.com") + char(1);
+    const qint64 queueingBefore = server.nsecsSpentQueueing();
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < RequestBurstCount; ++i) {
+        const int repliesBefore = server.requestFailuresReceived();
+        for (int j = 0; j < RequestsPerBurst; ++j)
+            server.queuePacket(request);
+        server.flush();
+        while (server.requestFailuresReceived() - repliesBefore < RequestsPerBurst) {
+            if (!processEvents(client)) {
+                std::cerr << "  Lost the connection to the loopback server." << std::endl;
+                return false;
+            }
+        }
+    }
+    *nsecs = timer.nsecsElapsed() - (server.nsecsSpentQueueing() - queueingBefore);
+    *writeCount = counter.count;
+    return true;
+}
+
+void printWrites(const char *label, int burstCount, int writeCount, qint64 nsecs)
+{
+    std::cout << "  " << std::left << std::setw(40) << label << std::right
+              << std::fixed << std::setprecision(2) << std::setw(10)
+              << double(writeCount) / burstCount << " writes/burst" << std::setw(10)
+              << std::setprecision(1) << double(nsecs) / burstCount / 1000 << " us/burst"
+              << std::endl;
+}
+
+} // anonymous namespace
+
+namespace Benchmarks {
+
+void runSyscallBenchmark()
+{
+    std::cout << " " << BurstCount << " bursts of " << PacketsPerBurst
+              << " packets from SshSendFacility:" << std::endl;
+    int writeCount = 0;
+    qint64 nsecs = 0;
+    runFacilityBursts(false, &writeCount, &nsecs);
+    printWrites("one socket write per packet", BurstCount, writeCount, nsecs);
+    runFacilityBursts(true, &writeCount, &nsecs);
+    printWrites("SshSendFacilityCork", BurstCount, writeCount, nsecs);
+
+    std::cout << " " << RequestBurstCount << " bursts of " << RequestsPerBurst
+              << " global requests to SshConnectionPrivate:" << std::endl;
+    if (runRequestBursts(&writeCount, &nsecs))
+        printWrites("replies from handleIncomingData()", RequestBurstCount, writeCount, nsecs);
+}
+
+} // namespace Benchmarks
+
+#include "syscallbenchmark.moc"
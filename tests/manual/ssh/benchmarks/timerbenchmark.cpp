@@ -0,0 +1,116 @@
+/**************************************************************************
+**
+** This file is part of Qt Creator
+**
+** Copyright (c) 2012 Nokia Corporation and/or its subsidiary(-ies).
+**
+** Contact: http://www.qt-project.org/
+**
+**
+** GNU Lesser General Public License Usage
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.LGPL included in the packaging of this file.
+** Please review the following information to ensure the GNU Lesser General
+** Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights. These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** Other Usage
+**
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and Nokia.
+**
+**
+**************************************************************************/
+
+#include "benchmarks.h"
+
+#include "sshtimerwheel_p.h"
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QTimer>
+
+using QSsh::Internal::SshTimer;
+
+/*
+ * Measures the cost of what every channel does with its reply timeout: start it
+ * when a request goes out and stop it when the reply comes in. With a QTimer
+ * per channel, each of these registers or unregisters a timer with the event
+ * dispatcher, whose cost grows with the number of active timers. SshTimer only
+ * links itself into a slot of the thread's SshTimerWheel.
+ */
+
+namespace {
+
+const int RoundCount = 20;
+const int ReplyTimeout = 10000;
+
+class Channel : public QObject
+{
+    Q_OBJECT
+signals:
+    void timeout();
+};
+
+template <typename Timer> void startAndStop(QList<Timer *> &timers)
+{
+    for (int i = 0; i < timers.count(); ++i)
+        timers.at(i)->start(ReplyTimeout + i % 1000);
+    for (int i = 0; i < timers.count(); ++i)
+        timers.at(i)->stop();
+}
+
+void measure(int channelCount)
+{
+    QList<Channel *> channels;
+    QList<QTimer *> qTimers;
+    QList<SshTimer *> sshTimers;
+    for (int i = 0; i < channelCount; ++i) {
+        channels << new Channel;
+        QTimer * const timer = new QTimer(channels.last());
+        timer->setSingleShot(true);
+        QObject::connect(timer, SIGNAL(timeout()), channels.last(), SIGNAL(timeout()));
+        qTimers << timer;
+        sshTimers << new SshTimer(channels.last(), "timeout");
+    }
+
+    QElapsedTimer clock;
+    clock.start();
+    for (int round = 0; round < RoundCount; ++round)
+        startAndStop(qTimers);
+    const qint64 qTimerNsecs = clock.nsecsElapsed();
+    clock.start();
+    for (int round = 0; round < RoundCount; ++round)
+        startAndStop(sshTimers);
+    const qint64 sshTimerNsecs = clock.nsecsElapsed();
+
+    const double operations = 2.0 * RoundCount * channelCount;
+    std::cout << "  " << std::setw(6) << channelCount << " channels:" << std::fixed
+              << std::setprecision(1) << std::setw(10) << qTimerNsecs / operations
+              << " ns per QTimer start/stop" << std::setw(10) << sshTimerNsecs / operations
+              << " ns per SshTimer start/stop" << std::endl;
+
+    qDeleteAll(sshTimers);
+    qDeleteAll(channels);
+}
+
+} // anonymous namespace
+
+namespace Benchmarks {
+
+void runTimerBenchmark()
+{
+    const int channelCounts[] = { 10, 1000, 10000 };
+    for (size_t i = 0; i < sizeof channelCounts / sizeof channelCounts[0]; ++i)
+        measure(channelCounts[i]);
+}
+
+} // namespace Benchmarks
+
+#include "timerbenchmark.moc"
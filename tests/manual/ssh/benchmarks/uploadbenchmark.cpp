@@ -0,0 +1,151 @@
+/**************************************************************************
+**
+** This file is part of Qt Creator
+**
+** Copyright (c) 2012 Nokia Corporation and/or its subsidiary(-ies).
+**
+** Contact: http://www.qt-project.org/
+**
+**
+** GNU Lesser General Public License Usage
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.LGPL included in the packaging of this file.
+** Please review the following information to ensure the GNU Lesser General
+** Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights. These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** Other Usage
+**
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and Nokia.
+**
+**
+**************************************************************************/
+
+#include "benchmarks.h"
+
+#include "sftpmappedfile_p.h"
+
+#include <QByteArray>
+#include <QTemporaryFile>
+
+#include <ctime>
+
+using QSsh::Internal::SftpMappedFile;
+
+/*
+ * Builds the SSH packets of an upload from a local file, as
+ * SftpChannelPrivate::sendWriteRequest() does: The data of every WRITE request
+ * is appended to the SFTP packet, which is then appended to the SSH packet.
+ * The data comes either from QFile::read(), which copies it from the page cache
+ * into a new QByteArray, or from SftpMappedFile, which refers to the page cache
+ * directly. Encryption is left out, as it is the same for both. The file is read
+ * once beforehand, so all of it is in the page cache.
+ */
+
+namespace {
+
+const qint64 FileSize = 256 * 1024 * 1024;
+const int ChunkSize = 32000; // AbstractSftpPacket::MaxDataSize
+const int Rounds = 4;
+
+struct UploadResult
+{
+    qint64 bytes;
+    qint64 bytesCopied;
+    double cpuSeconds;
+};
+
+bool createFile(QTemporaryFile &file)
+{
+    if (!file.open())
+        return false;
+    QByteArray block(1024 * 1024, 0);
+    for (int i = 0; i < block.size(); ++i)
+        block[i] = char(i * 7);
+    for (qint64 written = 0; written < FileSize; written += block.size()) {
+        if (file.write(block) != block.size())
+            return false;
+    }
+    return file.flush();
+}
+
+// Returns the number of bytes copied.
+qint64 sendChunk(const QByteArray &data, QByteArray &sftpPacket, QByteArray &sshPacket)
+{
+    sftpPacket.resize(0);
+    sftpPacket.append(QByteArray(29, 's')); // Length, type, id, handle, offset, data length.
+    sftpPacket.append(data);
+    sshPacket.resize(0);
+    sshPacket.append(QByteArray(14, 'h')); // Packet length, padding length, channel data header.
+    sshPacket.append(sftpPacket);
+    return data.size() + sftpPacket.size();
+}
+
+UploadResult upload(QFile &file, bool mapped)
+{
+    UploadResult result = { 0, 0, 0 };
+    QByteArray sftpPacket;
+    QByteArray sshPacket;
+    const std::clock_t start = std::clock();
+    for (int round = 0; round < Rounds; ++round) {
+        file.seek(0);
+        SftpMappedFile mappedFile;
+        if (mapped && !mappedFile.open(&file)) {
+            std::cerr << "  Could not map file." << std::endl;
+            return result;
+        }
+        forever {
+            QByteArray data;
+            if (mapped) {
+                data = mappedFile.read(ChunkSize);
+            } else {
+                data = file.read(ChunkSize);
+                result.bytesCopied += data.size();
+            }
+            if (data.isEmpty())
+                break;
+            result.bytesCopied += sendChunk(data, sftpPacket, sshPacket);
+            result.bytes += data.size();
+        }
+    }
+    result.cpuSeconds = double(std::clock() - start) / CLOCKS_PER_SEC;
+    return result;
+}
+
+void printUpload(const char *label, const UploadResult &result)
+{
+    const double gigaBytes = result.bytes / (1024.0 * 1024.0 * 1024.0);
+    std::cout << "  " << std::left << std::setw(40) << label << std::right
+              << std::fixed << std::setprecision(2) << std::setw(10)
+              << (result.bytes ? double(result.bytesCopied) / result.bytes : 0.0)
+              << " copies/byte" << std::setw(10) << std::setprecision(3)
+              << (gigaBytes > 0 ? result.cpuSeconds / gigaBytes : 0.0) << " CPU s/GB"
+              << std::endl;
+}
+
+} // anonymous namespace
+
+namespace Benchmarks {
+
+void runUploadBenchmark()
+{
+    QTemporaryFile file;
+    if (!createFile(file)) {
+        std::cerr << "  Could not create temporary file." << std::endl;
+        return;
+    }
+    std::cout << " " << Rounds << " uploads of " << FileSize / (1024 * 1024)
+              << " MB in WRITE requests of " << ChunkSize << " bytes:" << std::endl;
+    upload(file, false);
+    printUpload("QFile::read()", upload(file, false));
+    printUpload("memory-mapped", upload(file, true));
+}
+
+} // namespace Benchmarks
@@ -0,0 +1,201 @@
+/**************************************************************************
+**
+** This file is part of Qt Creator
+**
+** Copyright (c) 2012 Nokia Corporation and/or its subsidiary(-ies).
+**
+** Contact: http://www.qt-project.org/
+**
+**
+** GNU Lesser General Public License Usage
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.LGPL included in the packaging of this file.
+** Please review the following information to ensure the GNU Lesser General
+** Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights. These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** Other Usage
+**
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and Nokia.
+**
+**
+**************************************************************************/
+
+#include "benchmarks.h"
+
+#include "sshreceivewindow_p.h"
+
+#include <QQueue>
+
+using QSsh::Internal::SshReceiveWindow;
+using QSsh::Internal::SshReceiveWindowBudget;
+
+/*
+ * Simulates a bulk transfer from the server over links with different round
+ * trip times and bandwidths. The sender transmits 32 KB packets as long as the
+ * window allows; the receiver reads everything immediately and grants more
+ * window via SSH_MSG_CHANNEL_WINDOW_ADJUST once half of it has been used, which
+ * then takes half a round trip to arrive. Fixed window sizes are compared with
+ * SshReceiveWindow. Time is simulated, so the results do not depend on the
+ * machine; they show how throughput is capped at window size / round trip time.
+ */
+
+namespace {
+
+const qint64 SimulatedTime = 20 * 1000 * 1000; // In microseconds.
+const quint32 PacketSize = 32 * 1024;
+
+struct Link
+{
+    int roundTripTime; // In milliseconds.
+    int megaBitsPerSecond;
+};
+
+struct InFlight
+{
+    qint64 arrivalTime;
+    quint32 bytes;
+};
+
+class FixedWindow
+{
+public:
+    FixedWindow(quint32 size) : m_size(size), m_remaining(size) {}
+
+    quint32 size() const { return m_size; }
+
+    quint32 consume(quint32 bytes)
+    {
+        m_remaining -= bytes;
+        if (m_remaining >= m_size / 2)
+            return 0;
+        const quint32 bytesToAdd = m_size - m_remaining;
+        m_remaining = m_size;
+        return bytesToAdd;
+    }
+
+private:
+    const quint32 m_size;
+    quint32 m_remaining;
+};
+
+quint32 consume(FixedWindow &window, quint32 bytes, qint64 /* now */)
+{
+    return window.consume(bytes);
+}
+
+quint32 consume(SshReceiveWindow &window, quint32 bytes, qint64 now)
+{
+    window.receive(bytes);
+    return window.consume(bytes, now / 1000);
+}
+
+// Returns the number of bytes transferred in SimulatedTime; the final window
+// size is stored in finalWindowSize.
+template<typename Window> qint64 simulate(const Link &link, Window &window,
+    quint32 initialWindowSize, quint32 *finalWindowSize)
+{
+    const qint64 oneWayDelay = link.roundTripTime * 1000 / 2;
+    const double microSecsPerByte = 8.0 / link.megaBitsPerSecond;
+    QQueue<InFlight> data;
+    QQueue<InFlight> adjustments;
+    quint32 senderWindow = initialWindowSize;
+    qint64 linkFreeTime = 0;
+    qint64 bytesReceived = 0;
+    qint64 now = 0;
+
+    while (now < SimulatedTime) {
+        if (senderWindow > 0 && linkFreeTime <= now) {
+            const quint32 bytes = qMin(senderWindow, PacketSize);
+            senderWindow -= bytes;
+            linkFreeTime = now + qint64(bytes * microSecsPerByte);
+            const InFlight packet = { linkFreeTime + oneWayDelay, bytes };
+            data.enqueue(packet);
+            continue;
+        }
+
+        qint64 next = SimulatedTime;
+        if (senderWindow > 0)
+            next = qMin(next, linkFreeTime);
+        if (!data.isEmpty())
+            next = qMin(next, data.head().arrivalTime);
+        if (!adjustments.isEmpty())
+            next = qMin(next, adjustments.head().arrivalTime);
+        now = next;
+
+        while (!data.isEmpty() && data.head().arrivalTime <= now) {
+            const quint32 bytes = data.dequeue().bytes;
+            bytesReceived += bytes;
+            const quint32 bytesToAdd = consume(window, bytes, now);
+            if (bytesToAdd > 0) {
+                const InFlight adjustment = { now + oneWayDelay, bytesToAdd };
+                adjustments.enqueue(adjustment);
+            }
+        }
+        while (!adjustments.isEmpty() && adjustments.head().arrivalTime <= now)
+            senderWindow += adjustments.dequeue().bytes;
+    }
+
+    *finalWindowSize = window.size();
+    return bytesReceived;
+}
+
+void printResult(qint64 bytes, quint32 windowSize)
+{
+    std::cout << std::setw(9) << std::fixed << std::setprecision(1)
+              << Benchmarks::megaBytesPerSecond(bytes, SimulatedTime * 1000);
+    if (windowSize)
+        std::cout << " (" << windowSize / 1024 << " KB)";
+}
+
+} // anonymous namespace
+
+namespace Benchmarks {
+
+void runWindowBenchmark()
+{
+    const Link links[] = {
+        { 1, 100 }, { 1, 1000 }, { 20, 100 }, { 20, 1000 },
+        { 100, 100 }, { 100, 1000 }, { 300, 100 }, { 300, 1000 }
+    };
+    const quint32 fixedSizes[] = { 64 * 1024, 256 * 1024, 2 * 1024 * 1024, 16 * 1024 * 1024 };
+    const int fixedSizeCount = sizeof fixedSizes / sizeof fixedSizes[0];
+
+    std::cout << " Throughput in MB/s for fixed windows and the adaptive one "
+                 "(final size in parentheses):" << std::endl
+              << "  RTT   Mbit/s";
+    for (int i = 0; i < fixedSizeCount; ++i)
+        std::cout << std::setw(7) << fixedSizes[i] / 1024 << " KB";
+    std::cout << "   adaptive" << std::endl;
+
+    for (size_t i = 0; i < sizeof links / sizeof links[0]; ++i) {
+        const Link &link = links[i];
+        std::cout << std::setw(5) << link.roundTripTime << "ms"
+                  << std::setw(7) << link.megaBitsPerSecond;
+        for (int j = 0; j < fixedSizeCount; ++j) {
+            FixedWindow window(fixedSizes[j]);
+            quint32 finalSize;
+            printResult(simulate(link, window, fixedSizes[j], &finalSize), 0);
+        }
+
+        SshReceiveWindowBudget budget(128 * 1024 * 1024);
+        budget.addRoundTripTimeSample(link.roundTripTime);
+        SshReceiveWindow window;
+        window.setBudget(&budget);
+        quint32 finalSize;
+        const quint32 initialSize = window.open(0);
+        const qint64 bytes = simulate(link, window, initialSize, &finalSize);
+        printResult(bytes, finalSize);
+        window.close();
+        std::cout << std::endl;
+    }
+}
+
+} // namespace Benchmarks
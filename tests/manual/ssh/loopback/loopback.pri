@@ -0,0 +1,17 @@
+QT = core gui network
+
+include($$PWD/../../../../qssh.pri)
+
+# Programs that talk to the loopback server drive library internals, which
+# are not exported, so they build the library's sources into themselves
+# instead of linking against it.
+include($$IDE_SOURCE_TREE/src/libs/ssh/ssh-lib.pri)
+DEFINES += QSSH_LIBRARY
+INCLUDEPATH += $$IDE_SOURCE_TREE/src/libs/ssh $$PWD
+
+SOURCES += $$PWD/loopbackserver.cpp
+HEADERS += $$PWD/loopbackserver.h
+
+CONFIG   += console
+CONFIG   -= app_bundle
+TEMPLATE = app
@@ -0,0 +1,514 @@
+/**************************************************************************
+**
+** This file is part of Qt Creator
+**
+** Copyright (c) 2012 Nokia Corporation and/or its subsidiary(-ies).
+**
+** Contact: http://www.qt-project.org/
+**
+**
+** GNU Lesser General Public License Usage
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.LGPL included in the packaging of this file.
+** Please review the following information to ensure the GNU Lesser General
+** Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights. These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** Other Usage
+**
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and Nokia.
+**
+**
+**************************************************************************/
+
+#include "loopbackserver.h"
+
+#include "sshbotanconversions_p.h"
+#include "sshcapabilities_p.h"
+#include "sshconnection_p.h"
+#include "sshpacket_p.h"
+#include "sshpacketparser_p.h"
+#include "sshremoteprocess.h"
+
+#include <botan/auto_rng.h>
+#include <botan/cipher_mode.h>
+#include <botan/curve25519.h>
+#include <botan/dh.h>
+#include <botan/dl_group.h>
+#include <botan/ec_group.h>
+#include <botan/ecdh.h>
+#include <botan/ed25519.h>
+#include <botan/hash.h>
+#include <botan/hmac.h>
+#include <botan/numthry.h>
+#include <botan/pubkey.h>
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QHostAddress>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QtEndian>
+
+#include <cstring>
+#include <iostream>
+#include <memory>
+
+using namespace Botan;
+using namespace QSsh;
+using namespace QSsh::Internal;
+
+namespace {
+
+const QByteArray ServerId("SSH-2.0-QSshLoopback");
+const quint32 InitialWindowSize = 16 * 1024 * 1024;
+const quint32 MaxPacketSize = 256 * 1024;
+const int BlockSize = 16;
+const int MacLength = 32;
+
+QByteArray encodeString(const QByteArray &string)
+{
+    return AbstractSshPacket::encodeString(string);
+}
+
+QByteArray encodeInt(quint32 value)
+{
+    return AbstractSshPacket::encodeInt(value);
+}
+
+QByteArray hashData(HashFunction &hash, const QByteArray &data)
+{
+    return convertByteArray(hash.process(convertByteArray(data), data.size()));
+}
+
+} // anonymous namespace
+
+struct LoopbackSshServer::Crypto
+{
+    Crypto() : hostKey(rng) {}
+
+    AutoSeeded_RNG rng;
+    const Ed25519_PrivateKey hostKey;
+};
+
+struct LoopbackSshServer::DirectionKeys
+{
+    std::unique_ptr<Cipher_Mode> cipher;
+    std::unique_ptr<HMAC> hMac;
+};
+
+LoopbackSshServer::LoopbackSshServer()
+    : m_server(new QTcpServer(this)), m_socket(0), m_crypto(new Crypto),
+      m_keyExchangeMethod(SshCapabilities::Curve25519Sha256),
+      m_outgoingSeqNr(0), m_incomingSeqNr(0), m_kexInitSent(false), m_incomingOffset(0),
+      m_nsecsSpentQueueing(0), m_nsecsSpentReceiving(0), m_channelDataReceived(0),
+      m_requestFailuresReceived(0), m_keyExchangesCompleted(0), m_keepAlivesAnswered(0)
+{
+    connect(m_server, SIGNAL(newConnection()), SLOT(handleNewConnection()));
+}
+
+LoopbackSshServer::~LoopbackSshServer()
+{
+}
+
+bool LoopbackSshServer::listen()
+{
+    return m_server->listen(QHostAddress::LocalHost);
+}
+
+SshConnectionParameters LoopbackSshServer::connectionParameters() const
+{
+    SshConnectionParameters parameters;
+    parameters.host = QLatin1String("127.0.0.1");
+    parameters.port = m_server->serverPort();
+    parameters.userName = QLatin1String("loopback");
+    parameters.password = QLatin1String("loopback");
+    parameters.authenticationType = SshConnectionParameters::AuthenticationByPassword;
+    parameters.timeout = 10;
+    parameters.rekeyAfterBytes = 0;
+    parameters.rekeyAfterSeconds = 0;
+    return parameters;
+}
+
+bool LoopbackSshServer::connectClient(SshConnectionPrivate &client)
+{
+    client.connectToHost();
+    while (client.state() != ConnectionEstablished) {
+        if (!processEvents(client)) {
+            std::cerr << "  Could not connect to the loopback server: "
+                      << qPrintable(client.errorString()) << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+QList<QSharedPointer<SshRemoteProcess> > LoopbackSshServer::startProcesses(
+        SshConnectionPrivate &client, int count)
+{
+    QList<QSharedPointer<SshRemoteProcess> > processes;
+    for (int i = 0; i < count; ++i) {
+        processes << client.createRemoteProcess("cat");
+        processes.last()->start();
+    }
+    foreach (const QSharedPointer<SshRemoteProcess> &process, processes) {
+        while (!process->isRunning()) {
+            if (!processEvents(client))
+                return QList<QSharedPointer<SshRemoteProcess> >();
+        }
+    }
+    return processes;
+}
+
+bool LoopbackSshServer::pingClient(SshConnectionPrivate &client)
+{
+    const int failures = m_requestFailuresReceived;
+    queuePacket(QByteArray(1, SSH_MSG_GLOBAL_REQUEST)
+            + encodeString("keepalive@openssh.com") + char(1));
+    flush();
+    while (m_requestFailuresReceived == failures) {
+        if (!processEvents(client))
+            return false;
+    }
+    return true;
+}
+
+void LoopbackSshServer::setEchoing(quint32 channel, bool echo)
+{
+    if (echo)
+        m_echoChannels.insert(channel);
+    else
+        m_echoChannels.remove(channel);
+}
+
+void LoopbackSshServer::handleNewConnection()
+{
+    if (m_socket) {
+        delete m_server->nextPendingConnection();
+        return;
+    }
+    m_socket = m_server->nextPendingConnection();
+    m_socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+    connect(m_socket, SIGNAL(readyRead()), SLOT(handleIncomingData()));
+    m_outgoingData = ServerId + "\r\n";
+    sendKeyExchangeInit();
+    flush();
+}
+
+void LoopbackSshServer::sendKeyExchangeInit()
+{
+    m_serverKexInit = QByteArray(1, SSH_MSG_KEXINIT);
+    m_serverKexInit += convertByteArray(m_crypto->rng.random_vec(16));
+    m_serverKexInit += encodeString(m_keyExchangeMethod);
+    m_serverKexInit += encodeString(SshCapabilities::PubKeyEd25519);
+    m_serverKexInit += encodeString(SshCapabilities::CryptAlgoAes128ctr);
+    m_serverKexInit += encodeString(SshCapabilities::CryptAlgoAes128ctr);
+    m_serverKexInit += encodeString(SshCapabilities::HMacSha256Etm);
+    m_serverKexInit += encodeString(SshCapabilities::HMacSha256Etm);
+    m_serverKexInit += encodeString(SshCapabilities::CompressionNone);
+    m_serverKexInit += encodeString(SshCapabilities::CompressionNone);
+    m_serverKexInit += encodeString(QByteArray());
+    m_serverKexInit += encodeString(QByteArray());
+    m_serverKexInit += char(0); // No guessed packet.
+    m_serverKexInit += encodeInt(0); // Reserved.
+    queuePacket(m_serverKexInit);
+    m_kexInitSent = true;
+}
+
+void LoopbackSshServer::handleIncomingData()
+{
+    QElapsedTimer timer;
+    timer.start();
+    m_incomingData += m_socket->readAll();
+    if (m_clientId.isEmpty()) {
+        const int newLinePos = m_incomingData.indexOf("\r\n");
+        if (newLinePos == -1)
+            return;
+        m_clientId = m_incomingData.left(newLinePos);
+        m_incomingOffset = newLinePos + 2;
+    }
+
+    for (QByteArray payload = takeClientPacket(); !payload.isEmpty();
+            payload = takeClientPacket()) {
+        handleClientPacket(payload);
+    }
+    m_incomingData.remove(0, m_incomingOffset);
+    m_incomingOffset = 0;
+    m_nsecsSpentReceiving += timer.nsecsElapsed();
+    flush();
+}
+
+// Returns the payload of the next complete packet, or an empty array.
+QByteArray LoopbackSshServer::takeClientPacket()
+{
+    if (m_incomingData.size() - m_incomingOffset < 4)
+        return QByteArray();
+    char * const packet = m_incomingData.data() + m_incomingOffset;
+    const quint32 length = qFromBigEndian<quint32>(reinterpret_cast<uchar *>(packet));
+    const int macLength = m_decrypter ? MacLength : 0;
+    if (m_incomingData.size() - m_incomingOffset < int(4 + length + macLength))
+        return QByteArray();
+
+    // Nothing here needs to be protected, so the MAC does not get checked.
+    if (m_decrypter)
+        m_decrypter->cipher->process(reinterpret_cast<byte *>(packet + 4), length);
+    m_incomingOffset += 4 + length + macLength;
+    ++m_incomingSeqNr;
+    const int paddingLength = static_cast<quint8>(packet[4]);
+    return QByteArray(packet + 5, length - paddingLength - 1);
+}
+
+void LoopbackSshServer::handleClientPacket(const QByteArray &payload)
+{
+    switch (static_cast<quint8>(payload.at(0))) {
+    case SSH_MSG_KEXINIT:
+        // The client starts every re-exchange, so this is where ours begins.
+        if (!m_kexInitSent)
+            sendKeyExchangeInit();
+        m_clientKexInit = payload;
+        break;
+    case SSH_MSG_KEXDH_INIT: // Same as SSH_MSG_KEX_ECDH_INIT.
+        handleKexDhInit(payload);
+        break;
+    case SSH_MSG_NEWKEYS:
+        m_decrypter.reset(m_nextDecrypter.take());
+        m_kexInitSent = false;
+        ++m_keyExchangesCompleted;
+        break;
+    case SSH_MSG_SERVICE_REQUEST: {
+        quint32 offset = 1;
+        const QByteArray service = SshPacketParser::asString(payload, &offset);
+        queuePacket(QByteArray(1, SSH_MSG_SERVICE_ACCEPT) + encodeString(service));
+        break;
+    }
+    case SSH_MSG_USERAUTH_REQUEST:
+        queuePacket(QByteArray(1, SSH_MSG_USERAUTH_SUCCESS));
+        break;
+    case SSH_MSG_GLOBAL_REQUEST: {
+        quint32 offset = 1;
+        SshPacketParser::asString(payload, &offset);
+        if (SshPacketParser::asBool(payload, &offset))
+            queuePacket(QByteArray(1, SSH_MSG_REQUEST_FAILURE));
+        break;
+    }
+    case SSH_MSG_REQUEST_FAILURE:
+        ++m_requestFailuresReceived;
+        break;
+    case SSH_MSG_CHANNEL_OPEN:
+        handleChannelOpen(payload);
+        break;
+    case SSH_MSG_CHANNEL_REQUEST:
+        handleChannelRequest(payload);
+        break;
+    case SSH_MSG_CHANNEL_WINDOW_ADJUST: {
+        const quint32 channel = SshPacketParser::asUint32(payload, 1);
+        m_sendWindows[channel] += SshPacketParser::asUint32(payload, 5);
+        break;
+    }
+    case SSH_MSG_CHANNEL_DATA:
+        handleChannelData(payload);
+        break;
+    case SSH_MSG_CHANNEL_CLOSE: {
+        const quint32 channel = SshPacketParser::asUint32(payload, 1);
+        m_channels.removeOne(channel);
+        m_sendWindows.remove(channel);
+        m_unacknowledgedData.remove(channel);
+        m_echoChannels.remove(channel);
+        queuePacket(QByteArray(1, SSH_MSG_CHANNEL_CLOSE) + encodeInt(channel));
+        break;
+    }
+    case SSH_MSG_INVALID:
+        // That is what the client's keep-alive relies on.
+        queuePacket(QByteArray(1, SSH_MSG_UNIMPLEMENTED) + encodeInt(m_incomingSeqNr - 1));
+        ++m_keepAlivesAnswered;
+        break;
+    default:
+        break;
+    }
+}
+
+void LoopbackSshServer::handleKexDhInit(const QByteArray &payload)
+{
+    // The public values are strings for the ECDH methods and mpints for plain DH.
+    quint32 offset = 1;
+    QByteArray clientValue;
+    QByteArray serverValue;
+    if (isEcdhKeyExchangeAlgo(m_keyExchangeMethod)) {
+        const QByteArray clientQ = SshPacketParser::asString(payload, &offset);
+        std::unique_ptr<PK_Key_Agreement_Key> ecdhKey;
+        if (isCurve25519KeyExchangeAlgo(m_keyExchangeMethod)) {
+            ecdhKey.reset(new Curve25519_PrivateKey(m_crypto->rng));
+        } else {
+            ecdhKey.reset(new ECDH_PrivateKey(m_crypto->rng,
+                    EC_Group(botanKeyExchangeAlgoName(m_keyExchangeMethod))));
+        }
+        PK_Key_Agreement agreement(*ecdhKey, m_crypto->rng, "Raw");
+        m_k = AbstractSshPacket::encodeMpInt(BigInt::decode(agreement.derive_key(0,
+                convertByteArray(clientQ), clientQ.size()).bits_of()));
+        clientValue = encodeString(clientQ);
+        serverValue = encodeString(convertByteArray(ecdhKey->public_value()));
+    } else {
+        const BigInt e = SshPacketParser::asBigInt(payload, &offset);
+        const DL_Group group(botanKeyExchangeAlgoName(m_keyExchangeMethod));
+        const DH_PrivateKey dhKey(m_crypto->rng, group);
+        m_k = AbstractSshPacket::encodeMpInt(power_mod(e, dhKey.get_x(), group.get_p()));
+        clientValue = AbstractSshPacket::encodeMpInt(e);
+        serverValue = AbstractSshPacket::encodeMpInt(dhKey.get_y());
+    }
+
+    const QByteArray hostKeyBlob = encodeString(SshCapabilities::PubKeyEd25519)
+            + encodeString(convertByteArray(m_crypto->hostKey.get_public_key()));
+    const QByteArray hashInput = encodeString(m_clientId) + encodeString(ServerId)
+            + encodeString(m_clientKexInit) + encodeString(m_serverKexInit)
+            + encodeString(hostKeyBlob) + clientValue + serverValue + m_k;
+    m_h = hashData(*HashFunction::create_or_throw(
+            botanKeyExchangeHashName(m_keyExchangeMethod)), hashInput);
+    if (m_sessionId.isEmpty())
+        m_sessionId = m_h;
+
+    PK_Signer signer(m_crypto->hostKey, m_crypto->rng, "Pure");
+    const QByteArray signature = convertByteArray(signer.sign_message(
+            convertByteArray(m_h), m_h.size(), m_crypto->rng));
+    queuePacket(QByteArray(1, SSH_MSG_KEXDH_REPLY) + encodeString(hostKeyBlob)
+            + serverValue + encodeString(encodeString(SshCapabilities::PubKeyEd25519)
+            + encodeString(signature)));
+    queuePacket(QByteArray(1, SSH_MSG_NEWKEYS));
+
+    // RFC 4253, 7.2: The client sends with A, C and E and receives with B, D and F.
+    m_encrypter.reset(createKeys(true, 'B', 'D', 'F'));
+    m_nextDecrypter.reset(createKeys(false, 'A', 'C', 'E'));
+}
+
+QByteArray LoopbackSshServer::deriveKey(char letter, int length) const
+{
+    // RFC 4253, 7.2: Keys longer than the hash are extended with HASH(K || H || key so far).
+    const std::unique_ptr<HashFunction> hash = HashFunction::create_or_throw(
+            botanKeyExchangeHashName(m_keyExchangeMethod));
+    QByteArray key = hashData(*hash, m_k + m_h + letter + m_sessionId);
+    while (key.size() < length)
+        key += hashData(*hash, m_k + m_h + key);
+    return key.left(length);
+}
+
+LoopbackSshServer::DirectionKeys *LoopbackSshServer::createKeys(bool encrypt,
+        char ivLetter, char keyLetter, char macLetter) const
+{
+    DirectionKeys * const keys = new DirectionKeys;
+    keys->cipher.reset(Cipher_Mode::create_or_throw(
+            botanCipherModeName(SshCapabilities::CryptAlgoAes128ctr),
+            encrypt ? ENCRYPTION : DECRYPTION).release());
+    const QByteArray key = deriveKey(keyLetter, 16);
+    keys->cipher->set_key(convertByteArray(key), key.size());
+    const QByteArray iv = deriveKey(ivLetter, BlockSize);
+    keys->cipher->start(convertByteArray(iv), iv.size());
+    keys->hMac.reset(new HMAC(HashFunction::create_or_throw(
+            botanHMacAlgoName(SshCapabilities::HMacSha256Etm)).release()));
+    const QByteArray macKey = deriveKey(macLetter, MacLength);
+    keys->hMac->set_key(convertByteArray(macKey), macKey.size());
+    return keys;
+}
+
+void LoopbackSshServer::handleChannelOpen(const QByteArray &payload)
+{
+    quint32 offset = 1;
+    SshPacketParser::asString(payload, &offset);
+    const quint32 channel = SshPacketParser::asUint32(payload, &offset);
+    m_channels << channel;
+    m_sendWindows.insert(channel, SshPacketParser::asUint32(payload, &offset));
+    m_unacknowledgedData.insert(channel, 0);
+
+    // The server uses the client's channel numbers for its own channels.
+    queuePacket(QByteArray(1, SSH_MSG_CHANNEL_OPEN_CONFIRMATION) + encodeInt(channel)
+            + encodeInt(channel) + encodeInt(InitialWindowSize) + encodeInt(MaxPacketSize));
+}
+
+void LoopbackSshServer::handleChannelRequest(const QByteArray &payload)
+{
+    quint32 offset = 1;
+    const quint32 channel = SshPacketParser::asUint32(payload, &offset);
+    SshPacketParser::asString(payload, &offset);
+    if (SshPacketParser::asBool(payload, &offset))
+        queuePacket(QByteArray(1, SSH_MSG_CHANNEL_SUCCESS) + encodeInt(channel));
+}
+
+void LoopbackSshServer::handleChannelData(const QByteArray &payload)
+{
+    const quint32 channel = SshPacketParser::asUint32(payload, 1);
+    const quint32 length = SshPacketParser::asUint32(payload, 5);
+    m_channelDataReceived += length;
+    if (m_echoChannels.contains(channel))
+        queueChannelData(channel, payload.mid(9, length));
+
+    // Like OpenSSH, give the window back once half of it has been used.
+    quint32 &unacknowledged = m_unacknowledgedData[channel];
+    unacknowledged += length;
+    if (unacknowledged >= InitialWindowSize / 2) {
+        queuePacket(QByteArray(1, SSH_MSG_CHANNEL_WINDOW_ADJUST) + encodeInt(channel)
+                + encodeInt(unacknowledged));
+        unacknowledged = 0;
+    }
+}
+
+void LoopbackSshServer::queuePacket(const QByteArray &payload)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    // With encrypt-then-MAC, the length field is neither encrypted nor padded.
+    const int blockSize = m_encrypter ? BlockSize : 8;
+    const int paddedSize = 1 + payload.size() + (m_encrypter ? 0 : 4);
+    int paddingLength = blockSize - paddedSize % blockSize;
+    if (paddingLength < 4)
+        paddingLength += blockSize;
+    const int packetSize = 4 + 1 + payload.size() + paddingLength;
+
+    const int oldSize = m_outgoingData.size();
+    m_outgoingData.resize(oldSize + packetSize + (m_encrypter ? MacLength : 0));
+    char * const packet = m_outgoingData.data() + oldSize;
+    qToBigEndian<quint32>(packetSize - 4, reinterpret_cast<uchar *>(packet));
+    packet[4] = paddingLength;
+    std::memcpy(packet + 5, payload.constData(), payload.size());
+    std::memset(packet + 5 + payload.size(), 0, paddingLength);
+    if (m_encrypter) {
+        m_encrypter->cipher->process(reinterpret_cast<byte *>(packet + 4), packetSize - 4);
+        m_encrypter->hMac->update_be(m_outgoingSeqNr);
+        m_encrypter->hMac->update(reinterpret_cast<const byte *>(packet), packetSize);
+        m_encrypter->hMac->final(reinterpret_cast<byte *>(packet + packetSize));
+    }
+    ++m_outgoingSeqNr;
+    m_nsecsSpentQueueing += timer.nsecsElapsed();
+}
+
+void LoopbackSshServer::queueChannelData(quint32 channel, const QByteArray &data)
+{
+    m_sendWindows[channel] -= data.size();
+    queuePacket(QByteArray(1, SSH_MSG_CHANNEL_DATA) + encodeInt(channel)
+            + encodeString(data));
+}
+
+void LoopbackSshServer::queueExtendedData(quint32 channel, const QByteArray &data)
+{
+    m_sendWindows[channel] -= data.size();
+    queuePacket(QByteArray(1, SSH_MSG_CHANNEL_EXTENDED_DATA) + encodeInt(channel)
+            + encodeInt(SSH_EXTENDED_DATA_STDERR) + encodeString(data));
+}
+
+void LoopbackSshServer::flush()
+{
+    if (m_socket && !m_outgoingData.isEmpty())
+        m_socket->write(m_outgoingData);
+    m_outgoingData.clear();
+}
+
+bool processEvents(const SshConnectionPrivate &client)
+{
+    QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+    return client.state() != SocketUnconnected;
+}
@@ -0,0 +1,170 @@
+/**************************************************************************
+**
+** This file is part of Qt Creator
+**
+** Copyright (c) 2012 Nokia Corporation and/or its subsidiary(-ies).
+**
+** Contact: http://www.qt-project.org/
+**
+**
+** GNU Lesser General Public License Usage
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.LGPL included in the packaging of this file.
+** Please review the following information to ensure the GNU Lesser General
+** Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights. These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** Other Usage
+**
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and Nokia.
+**
+**
+**************************************************************************/
+
+#ifndef LOOPBACKSERVER_H
+#define LOOPBACKSERVER_H
+
+#include "sshconnection.h"
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QScopedPointer>
+#include <QSet>
+#include <QSharedPointer>
+
+QT_BEGIN_NAMESPACE
+class QTcpServer;
+class QTcpSocket;
+QT_END_NAMESPACE
+
+namespace QSsh {
+class SshRemoteProcess;
+namespace Internal { class SshConnectionPrivate; }
+}
+
+/*
+ * Just enough of an SSH server for a real SshConnectionPrivate to connect to
+ * it over the loopback interface, so that benchmarks and tests can drive the
+ * library's own code paths. It offers a single key exchange method, by default
+ * curve25519-sha256, with an ssh-ed25519 host key, as well as aes128-ctr,
+ * hmac-sha2-256-etm@openssh.com and no compression. It accepts any password
+ * and grants every channel request. It takes part in key re-exchanges started
+ * by the client and answers keep-alives with SSH_MSG_UNIMPLEMENTED. Channel
+ * data from the client is counted and dropped, unless the channel has been set
+ * to echo it. Packets for the client are collected by the queue functions and
+ * written to the socket in one go by flush().
+ */
+class LoopbackSshServer : public QObject
+{
+    Q_OBJECT
+public:
+    LoopbackSshServer();
+    ~LoopbackSshServer();
+
+    // One of SshCapabilities::KeyExchangeMethods. Must be set before the client connects.
+    void setKeyExchangeMethod(const QByteArray &method) { m_keyExchangeMethod = method; }
+
+    bool listen();
+    QSsh::SshConnectionParameters connectionParameters() const;
+
+    // Connects the client and runs the event loop until it has authenticated.
+    bool connectClient(QSsh::Internal::SshConnectionPrivate &client);
+
+    // Starts that many remote processes and runs the event loop until they are running.
+    QList<QSharedPointer<QSsh::SshRemoteProcess> > startProcesses(
+            QSsh::Internal::SshConnectionPrivate &client, int count);
+
+    // Sends a global request and runs the event loop until the client has turned it down.
+    // As the client handles packets in order, it has then dealt with everything before it.
+    bool pingClient(QSsh::Internal::SshConnectionPrivate &client);
+
+    // The client's numbers for the channels it has opened, in the order of opening.
+    QList<quint32> channels() const { return m_channels; }
+
+    // Sends the channel's data back to the client right away, like a remote shell
+    // echoing keystrokes.
+    void setEchoing(quint32 channel, bool echo);
+
+    // How much channel data the client currently accepts on the channel.
+    quint32 sendWindow(quint32 channel) const { return m_sendWindows.value(channel); }
+
+    void queuePacket(const QByteArray &payload);
+    void queueChannelData(quint32 channel, const QByteArray &data);
+    void queueExtendedData(quint32 channel, const QByteArray &data);
+    void flush();
+
+    // Time spent in the queue functions, i.e. mostly encrypting.
+    qint64 nsecsSpentQueueing() const { return m_nsecsSpentQueueing; }
+
+    // Time spent handling the client's packets, i.e. mostly decrypting.
+    qint64 nsecsSpentReceiving() const { return m_nsecsSpentReceiving; }
+
+    qint64 channelDataReceived() const { return m_channelDataReceived; }
+    int requestFailuresReceived() const { return m_requestFailuresReceived; }
+    int keyExchangesCompleted() const { return m_keyExchangesCompleted; }
+    int keepAlivesAnswered() const { return m_keepAlivesAnswered; }
+
+private slots:
+    void handleNewConnection();
+    void handleIncomingData();
+
+private:
+    struct Crypto;
+    struct DirectionKeys;
+
+    QByteArray takeClientPacket();
+    void handleClientPacket(const QByteArray &payload);
+    void handleKexDhInit(const QByteArray &payload);
+    void handleChannelOpen(const QByteArray &payload);
+    void handleChannelRequest(const QByteArray &payload);
+    void handleChannelData(const QByteArray &payload);
+    void sendKeyExchangeInit();
+    QByteArray deriveKey(char letter, int length) const;
+    DirectionKeys *createKeys(bool encrypt, char ivLetter, char keyLetter, char macLetter) const;
+
+    QTcpServer * const m_server;
+    QTcpSocket *m_socket;
+    const QScopedPointer<Crypto> m_crypto;
+    QByteArray m_keyExchangeMethod;
+    QScopedPointer<DirectionKeys> m_encrypter;
+    QScopedPointer<DirectionKeys> m_decrypter;
+    QScopedPointer<DirectionKeys> m_nextDecrypter;
+    quint32 m_outgoingSeqNr;
+    quint32 m_incomingSeqNr;
+    bool m_kexInitSent;
+
+    QByteArray m_incomingData;
+    int m_incomingOffset;
+    QByteArray m_outgoingData;
+    QByteArray m_clientId;
+    QByteArray m_clientKexInit;
+    QByteArray m_serverKexInit;
+    QByteArray m_k;
+    QByteArray m_h;
+    QByteArray m_sessionId;
+
+    QList<quint32> m_channels;
+    QHash<quint32, quint32> m_sendWindows;
+    QHash<quint32, quint32> m_unacknowledgedData;
+    QSet<quint32> m_echoChannels;
+    qint64 m_nsecsSpentQueueing;
+    qint64 m_nsecsSpentReceiving;
+    qint64 m_channelDataReceived;
+    int m_requestFailuresReceived;
+    int m_keyExchangesCompleted;
+    int m_keepAlivesAnswered;
+};
+
+// Runs one round of the event loop. Returns false if the client has lost its connection.
+bool processEvents(const QSsh::Internal::SshConnectionPrivate &client);
+
+#endif // LOOPBACKSERVER_H
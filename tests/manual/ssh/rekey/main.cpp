@@ -0,0 +1,178 @@
+/**************************************************************************
+**
+** This file is part of Qt Creator
+**
+** Copyright (c) 2012 Nokia Corporation and/or its subsidiary(-ies).
+**
+** Contact: http://www.qt-project.org/
+**
+**
+** GNU Lesser General Public License Usage
+**
+** This file may be used under the terms of the GNU Lesser General Public
+** License version 2.1 as published by the Free Software Foundation and
+** appearing in the file LICENSE.LGPL included in the packaging of this file.
+** Please review the following information to ensure the GNU Lesser General
+** Public License version 2.1 requirements will be met:
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Nokia gives you certain additional
+** rights. These rights are described in the Nokia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** Other Usage
+**
+** Alternatively, this file may be used in accordance with the terms and
+** conditions contained in a signed written agreement between you and Nokia.
+**
+**
+**************************************************************************/
+
+#include "loopbackserver.h"
+
+#include "sshconnection_p.h"
+#include "sshremoteprocess.h"
+
+#include <QByteArray>
+#include <QCoreApplication>
+#include <QMetaObject>
+#include <QSharedPointer>
+
+#include <cstdlib>
+
+using namespace QSsh;
+using namespace QSsh::Internal;
+
+/*
+ * Runs key re-exchanges against the loopback server and checks that the
+ * connection survives them. The timers that normally drive the keep-alive
+ * and the re-exchange are bypassed by calling their slots directly, so that
+ * both can be made to coincide.
+ */
+
+namespace {
+
+// The initial key exchange plus the re-exchange the test has started.
+const int ExpectedKeyExchanges = 2;
+
+// Less than half the loopback server's window, so it does not send anything back.
+const qint64 UploadSize = 4 * 1024 * 1024;
+const quint64 RekeyAfterBytes = 1024 * 1024;
+
+bool waitForKeyReExchange(LoopbackSshServer &server, const SshConnectionPrivate &client)
+{
+    while (server.keyExchangesCompleted() < ExpectedKeyExchanges) {
+        if (!processEvents(client))
+            return false;
+    }
+    return true;
+}
+
+bool waitForKeepAliveAnswer(LoopbackSshServer &server, const SshConnectionPrivate &client)
+{
+    while (server.keepAlivesAnswered() == 0) {
+        if (!processEvents(client))
+            return false;
+    }
+    return true;
+}
+
+bool checkConnection(LoopbackSshServer &server, SshConnectionPrivate &client)
+{
+    if (!server.pingClient(client) || client.state() != ConnectionEstablished) {
+        qDebug("Error: The connection was lost: %s", qPrintable(client.errorString()));
+        return false;
+    }
+    return true;
+}
+
+bool testKeepAliveDueDuringReExchange()
+{
+    qDebug("Testing: Keep-alive becoming due during a key re-exchange");
+    LoopbackSshServer server;
+    if (!server.listen())
+        return false;
+    SshConnectionPrivate client(0, server.connectionParameters());
+    if (!server.connectClient(client))
+        return false;
+
+    QMetaObject::invokeMethod(&client, "handleRekeyTimeout");
+    QMetaObject::invokeMethod(&client, "sendKeepAlivePacket");
+    if (!waitForKeyReExchange(server, client) || !checkConnection(server, client))
+        return false;
+    if (server.keepAlivesAnswered() != 0) {
+        qDebug("Error: The keep-alive was sent during the key re-exchange.");
+        return false;
+    }
+
+    // The keep-alive timer has been restarted, so it becomes due again later.
+    QMetaObject::invokeMethod(&client, "sendKeepAlivePacket");
+    return waitForKeepAliveAnswer(server, client) && checkConnection(server, client);
+}
+
+bool testKeepAliveOutstandingDuringReExchange()
+{
+    qDebug("Testing: Keep-alive answered during a key re-exchange");
+    LoopbackSshServer server;
+    if (!server.listen())
+        return false;
+    SshConnectionPrivate client(0, server.connectionParameters());
+    if (!server.connectClient(client))
+        return false;
+
+    QMetaObject::invokeMethod(&client, "sendKeepAlivePacket");
+    QMetaObject::invokeMethod(&client, "handleRekeyTimeout");
+    return waitForKeyReExchange(server, client) && waitForKeepAliveAnswer(server, client)
+            && checkConnection(server, client);
+}
+
+bool testReExchangeTriggeredByUpload()
+{
+    qDebug("Testing: Key re-exchange triggered by outgoing data alone");
+    LoopbackSshServer server;
+    if (!server.listen())
+        return false;
+    SshConnectionParameters parameters = server.connectionParameters();
+    parameters.rekeyAfterBytes = RekeyAfterBytes;
+    SshConnectionPrivate client(0, parameters);
+    if (!server.connectClient(client))
+        return false;
+    const QList<QSharedPointer<SshRemoteProcess> > processes = server.startProcesses(client, 1);
+    if (processes.isEmpty())
+        return false;
+
+    const QByteArray data(64 * 1024, 'x');
+    for (qint64 written = 0; written < UploadSize; written += data.size())
+        processes.first()->write(data);
+    while (server.channelDataReceived() < UploadSize) {
+        if (!processEvents(client))
+            return false;
+    }
+    if (server.keyExchangesCompleted() < ExpectedKeyExchanges) {
+        qDebug("Error: No key re-exchange after %lld bytes sent.", UploadSize);
+        return false;
+    }
+    return checkConnection(server, client);
+}
+
+} // anonymous namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    typedef bool (*Test)();
+    const Test tests[] = {
+        &testKeepAliveDueDuringReExchange,
+        &testKeepAliveOutstandingDuringReExchange,
+        &testReExchangeTriggeredByUpload
+    };
+    for (size_t i = 0; i < sizeof tests / sizeof tests[0]; ++i) {
+        if (!tests[i]()) {
+            qDebug("Test failed.");
+            return EXIT_FAILURE;
+        }
+    }
+    qDebug("All tests finished successfully.");
+    return EXIT_SUCCESS;
+}
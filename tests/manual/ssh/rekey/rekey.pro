@@ -0,0 +1,4 @@
+include(../loopback/loopback.pri)
+
+TARGET=rekey
+SOURCES=main.cpp
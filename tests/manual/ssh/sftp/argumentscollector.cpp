@@ -51,6 +51,7 @@ Parameters ArgumentsCollector::collect(bool &success) const
         bool smallFileCountGiven = false;
         bool bigFileSizeGiven = false;
         bool proxySettingGiven = false;
+        bool compressionSettingGiven = false;
         int pos;
         int port;
         for (pos = 1; pos < m_arguments.count() - 1; ++pos) {
@@ -78,13 +79,17 @@ Parameters ArgumentsCollector::collect(bool &success) const
                 authTypeGiven = true;
                 continue;
             }
-            if (!checkForNoProxy(pos, parameters.sshParams.proxyType, proxySettingGiven))
+            if (!checkForNoProxy(pos, parameters.sshParams.proxyType, proxySettingGiven)
+                    && !checkForCompression(pos, parameters.sshParams.useCompression,
+                           compressionSettingGiven))
                 throw ArgumentErrorException(QLatin1String("unknown option ") + m_arguments.at(pos));
         }
 
         Q_ASSERT(pos <= m_arguments.count());
         if (pos == m_arguments.count() - 1) {
-            if (!checkForNoProxy(pos, parameters.sshParams.proxyType, proxySettingGiven))
+            if (!checkForNoProxy(pos, parameters.sshParams.proxyType, proxySettingGiven)
+                    && !checkForCompression(pos, parameters.sshParams.useCompression,
+                           compressionSettingGiven))
                 throw ArgumentErrorException(QLatin1String("unknown option ") + m_arguments.at(pos));
         }
 
@@ -117,7 +122,7 @@ void ArgumentsCollector::printUsage() const
         << " -h <host> -u <user> "
         << "-pwd <password> | -k <private key file> [ -p <port> ] "
         << "[ -t <timeout> ] [ -c <small file count> ] "
-        << "[ -s <big file size in MB> ] [ -no-proxy ]" << endl;
+        << "[ -s <big file size in MB> ] [ -no-proxy ] [ -compress ]" << endl;
 }
 
 bool ArgumentsCollector::checkAndSetStringArg(int &pos, QString &arg, const char *opt) const
@@ -167,3 +172,16 @@ bool ArgumentsCollector::checkForNoProxy(int &pos,
     }
     return false;
 }
+
+bool ArgumentsCollector::checkForCompression(int &pos, bool &useCompression,
+    bool &alreadyGiven) const
+{
+    if (m_arguments.at(pos) == QLatin1String("-compress")) {
+        if (alreadyGiven)
+            throw ArgumentErrorException(QLatin1String("compression setting given twice."));
+        useCompression = true;
+        alreadyGiven = true;
+        return true;
+    }
+    return false;
+}
@@ -53,6 +53,7 @@ private:
         const char *opt) const;
     bool checkForNoProxy(int &pos, QSsh::SshConnectionParameters::ProxyType &type,
         bool &alreadyGiven) const;
+    bool checkForCompression(int &pos, bool &useCompression, bool &alreadyGiven) const;
 
     const QStringList m_arguments;
 };